@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+// bench/NDVIAppBench.h
+//------------------------------------------------------------------------------
+
+#ifndef NDVIAPPBENCH_H
+#define NDVIAPPBENCH_H
+
+#include <QImage>
+#include <QPixmap>
+#include "NDVIApp.h"
+#include "Palette.h"
+
+/**
+ * @brief NDVIAppBench reaches the private per-frame paths of NDVIApp, so
+ * the benchmark and the end-to-end harness measure them exactly as the
+ * GUI runs them.
+ */
+struct NDVIAppBench
+{
+    static cv::Mat computeNDVI(NDVIApp &app, const cv::Mat &frame, cv::Mat &ndvi,
+                               cv::Mat &mask, NDVIStats &stats)
+    {
+        return app.computeNDVI(frame, cv::Mat(), 0.0f, 1.0f, paletteLUT("NDVI Classic"),
+                               ndvi, mask, stats);
+    }
+    static void drawOverlay(NDVIApp &app, cv::Mat &img, const cv::Mat &ndvi,
+                            const cv::Mat &mask, const NDVIStats &stats)
+    {
+        app.drawOverlay(img, ndvi, mask, stats);
+    }
+    static void setPixmap(NDVIApp &app, const cv::Mat &bgr) { app.setPixmap(app.m_procView, bgr); }
+    static void updatePreview(NDVIApp &app, const cv::Mat &ndvi, const cv::Mat &mask)
+    {
+        app.updatePreview(0.0f, 1.0f, ndvi, mask);
+    }
+    static void autoCalibrate(NDVIApp &app, const cv::Mat &ndvi, const cv::Mat &mask)
+    {
+        app.m_lastNDVI = ndvi;
+        app.m_lastMask = mask;
+        app.autoCalibrate();
+        app.m_logView->clear();
+    }
+
+    /**
+     * @brief processFrame runs the whole frame path; exact replays follow
+     * the recorded throttling, everything else is processed
+     */
+    static void processFrame(NDVIApp &app, const cv::Mat &frame, const cv::Mat &nir,
+                             const FrameMeta &meta, bool exactReplay = false)
+    {
+        app.m_unthrottled = !exactReplay;
+        app.m_replayExact = exactReplay;
+        app.processFrame(frame, nir, meta);
+    }
+    static void processFrame(NDVIApp &app, const cv::Mat &frame, const FrameMeta &meta)
+    {
+        processFrame(app, frame, cv::Mat(), meta);
+    }
+    static void applyParams(NDVIApp &app, const QJsonObject &params) { app.applyPipelineParams(params); }
+
+    /**
+     * @brief resetState restarts the stateful stages and hides the overlays
+     * that draw the clock, the frame rate or stage timings, so the display
+     * hash only depends on the input
+     */
+    static void resetState(NDVIApp &app)
+    {
+        app.m_telemChk->setChecked(false);
+        app.m_hudChk->setChecked(false);
+        app.resetPipelineState();
+    }
+    static const cv::Mat &lastNDVI(const NDVIApp &app) { return app.m_lastNDVI; }
+    static const cv::Mat &lastMask(const NDVIApp &app) { return app.m_lastMask; }
+    static QImage display(const NDVIApp &app) { return app.m_procView->pixmap(Qt::ReturnByValue).toImage(); }
+};
+
+#endif // NDVIAPPBENCH_H
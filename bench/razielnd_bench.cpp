@@ -0,0 +1,449 @@
+//------------------------------------------------------------------------------
+// bench/razielnd_bench.cpp
+//------------------------------------------------------------------------------
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <vector>
+#include "NDVIAppBench.h"
+#include "Palette.h"
+#include "PerfCounters.h"
+#include "StageProfiler.h"
+#include "SyntheticSource.h"
+#include "TraceRecorder.h"
+
+namespace {
+
+/**
+ * @brief BenchResult is the timing summary of one benchmark at one size.
+ */
+struct BenchResult
+{
+    QString  name;
+    cv::Size size;
+    int      reps = 0;
+    double   medianMs = 0.0;
+    double   p99Ms = 0.0;
+    double   meanMs = 0.0;
+    double   minMs = 0.0;
+    double   budgetMs = 0.0;  // target median, 0 = none
+
+    // Hardware counters per repetition and pixel, < 0 if not counted
+    double   ipc = -1.0;
+    double   cyclesPerPx = -1.0;
+    double   llcPerPx = -1.0;
+    double   branchPerPx = -1.0;
+};
+
+/**
+ * @brief counterJson adds the hardware counter rates that were measured.
+ */
+void counterJson(QJsonObject &o, double ipc, double cyclesPerPx, double llcPerPx,
+                 double branchPerPx)
+{
+    if (ipc >= 0.0) {
+        o["ipc"] = ipc;
+    }
+    if (cyclesPerPx >= 0.0) {
+        o["cycles_per_px"] = cyclesPerPx;
+    }
+    if (llcPerPx >= 0.0) {
+        o["llc_misses_per_px"] = llcPerPx;
+    }
+    if (branchPerPx >= 0.0) {
+        o["branch_misses_per_px"] = branchPerPx;
+    }
+}
+
+/**
+ * @brief The Bench class times callables with warm-up and repetitions.
+ * With hardware counters enabled, the timed repetitions are also counted
+ * on the calling thread and the OpenCV worker threads.
+ */
+class Bench
+{
+public:
+    Bench(int warmup, int reps, const QString &filter)
+        : m_warmup(warmup), m_reps(std::max(reps, 1)), m_filter(filter) {}
+
+    /**
+     * @brief run times fn; a budget is a target for the median, reported
+     * in the JSON and flagged on stdout when missed
+     */
+    void run(const QString &name, const cv::Size &size, const std::function<void()> &fn,
+             double budgetMs = 0.0)
+    {
+        if (!m_filter.isEmpty() && !name.contains(m_filter, Qt::CaseInsensitive)) {
+            return;
+        }
+        for (int i = 0; i < m_warmup; ++i) {
+            fn();
+        }
+        std::vector<double> ms(size_t(m_reps));
+        PerfCounters::Sample begin, end;
+        const bool counting = PerfCounters::isEnabled() && PerfCounters::readWithPool(begin);
+        for (double &t : ms) {
+            const auto t0 = std::chrono::steady_clock::now();
+            fn();
+            t = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        }
+        BenchResult r;
+        if (counting && PerfCounters::readWithPool(end)) {
+            const double pixels = double(size.area()) * m_reps;
+            auto delta = [&](PerfCounters::Event e) {
+                return double(end.value[e] - std::min(end.value[e], begin.value[e]));
+            };
+            const unsigned events = PerfCounters::events();
+            if (delta(PerfCounters::Cycles) > 0.0) {
+                r.ipc = delta(PerfCounters::Instructions) / delta(PerfCounters::Cycles);
+                r.cyclesPerPx = delta(PerfCounters::Cycles) / pixels;
+            }
+            if (events & (1u << PerfCounters::LlcMisses)) {
+                r.llcPerPx = delta(PerfCounters::LlcMisses) / pixels;
+            }
+            if (events & (1u << PerfCounters::BranchMisses)) {
+                r.branchPerPx = delta(PerfCounters::BranchMisses) / pixels;
+            }
+        }
+        r.name = name;
+        r.size = size;
+        r.reps = m_reps;
+        r.meanMs = std::accumulate(ms.begin(), ms.end(), 0.0) / ms.size();
+        std::sort(ms.begin(), ms.end());
+        r.minMs = ms.front();
+        r.medianMs = ms[ms.size() / 2];
+        r.p99Ms = ms[std::min(ms.size() - 1, size_t(std::ceil(0.99 * ms.size())) - 1)];
+        r.budgetMs = budgetMs;
+        m_results.push_back(r);
+
+        QTextStream(stdout) << QString("%1 %2x%3  median %4 ms  p99 %5 ms%6\n")
+                                   .arg(name, -36).arg(size.width).arg(size.height)
+                                   .arg(r.medianMs, 8, 'f', 3).arg(r.p99Ms, 8, 'f', 3)
+                                   .arg(budgetMs > 0.0 && r.medianMs > budgetMs
+                                        ? QString("  over %1 ms budget").arg(budgetMs) : QString());
+    }
+
+    /**
+     * @brief median returns the median of an earlier run, 0 if it did not run
+     */
+    double median(const QString &name, const cv::Size &size) const
+    {
+        for (const BenchResult &r : m_results) {
+            if (r.name == name && r.size == size) {
+                return r.medianMs;
+            }
+        }
+        return 0.0;
+    }
+
+    QJsonArray json() const
+    {
+        QJsonArray out;
+        for (const BenchResult &r : m_results) {
+            QJsonObject o;
+            o["name"] = r.name;
+            o["width"] = r.size.width;
+            o["height"] = r.size.height;
+            o["reps"] = r.reps;
+            o["median_ms"] = r.medianMs;
+            o["p99_ms"] = r.p99Ms;
+            o["mean_ms"] = r.meanMs;
+            o["min_ms"] = r.minMs;
+            o["mpix_per_s"] = r.medianMs > 0.0 ? r.size.area() / (r.medianMs * 1e3) : 0.0;
+            if (r.budgetMs > 0.0) {
+                o["budget_ms"] = r.budgetMs;
+                o["within_budget"] = r.medianMs <= r.budgetMs;
+            }
+            counterJson(o, r.ipc, r.cyclesPerPx, r.llcPerPx, r.branchPerPx);
+            out.append(o);
+        }
+        return out;
+    }
+
+private:
+    int                      m_warmup;
+    int                      m_reps;
+    QString                  m_filter;
+    std::vector<BenchResult> m_results;
+};
+
+/**
+ * @brief writeIntrinsics writes a mildly barrelled pinhole model for size.
+ */
+QString writeIntrinsics(const QTemporaryDir &dir, const cv::Size &size)
+{
+    const QString path = dir.filePath("intrinsics.yml");
+    cv::FileStorage fs(path.toStdString(), cv::FileStorage::WRITE);
+    const double f = 0.8 * size.width;
+    fs << "camera_matrix" << cv::Mat(cv::Matx33d(f, 0, size.width / 2.0, 0, f, size.height / 2.0, 0, 0, 1));
+    fs << "distortion_coefficients" << cv::Mat(cv::Matx<double, 1, 5>(-0.2, 0.05, 0, 0, 0));
+    fs << "image_width" << size.width << "image_height" << size.height;
+    return path;
+}
+
+/**
+ * @brief runSize runs every benchmark on synthetic frames of one size.
+ */
+void runSize(Bench &bench, NDVIApp &app, const cv::Size &size, const QTemporaryDir &tmp)
+{
+    SceneParams params;
+    params.width = size.width;
+    params.height = size.height;
+    params.poolSize = 2;
+    SyntheticSource source(params);
+    source.open();
+    cv::Mat frame, next;
+    FrameMeta meta;
+    source.read(frame, meta);
+    source.read(next, meta);
+
+    // Budgets from the feature requests are stated for 1080p
+    const bool fullHd = size == cv::Size(1920, 1080);
+
+    const cv::Mat lut = paletteLUT("NDVI Classic");
+    NDVIKernel kernel;
+    kernel.configure(0.0f, 1.0f);
+    cv::Mat coloured, ndvi, mask;
+    NDVIStats stats;
+    kernel.apply(frame, lut, coloured, ndvi, mask, &stats);
+
+    // Index kernels
+    bench.run("NDVIKernel::apply", size, [&]() {
+        kernel.apply(frame, lut, coloured, ndvi, mask, &stats);
+    });
+    bench.run("NDVIApp::computeNDVI", size, [&]() {
+        cv::Mat n, m;
+        NDVIStats s;
+        NDVIAppBench::computeNDVI(app, frame, n, m, s);
+    });
+    bench.run("NDVIKernel::colourise", size, [&]() {
+        cv::Mat c;
+        kernel.colourise(ndvi, mask, lut, c, &stats);
+    });
+    DualRegistration registration;
+    cv::Mat nir;
+    cv::resize(next, nir, cv::Size(size.width * 3 / 4, size.height * 3 / 4));
+    registration.prepare(size, nir, cv::Matx33d::eye());
+    bench.run("NDVIKernel::applyDual", size, [&]() {
+        cv::Mat c, n, m;
+        kernel.applyDual(frame, nir, registration.offsets(), registration.weights(), lut, c, n, m);
+    });
+
+    // Geometry: the zoom path, then undistortion folded into the same remap
+    GeometryRemap geometry;
+    bench.run("GeometryRemap::apply zoom", size, [&]() {
+        cv::Mat out;
+        geometry.apply(frame, out, 2.0, 0.1, -0.1);
+    });
+    geometry.loadIntrinsics(writeIntrinsics(tmp, size).toStdString());
+    geometry.setUndistort(true);
+    bench.run("GeometryRemap::apply undistort+zoom", size, [&]() {
+        cv::Mat out;
+        geometry.apply(frame, out, 2.0, 0.1, -0.1);
+    });
+
+    // NDVI-plane stages
+    // Temporal filter in place on one plane, so only the filter is timed
+    // (steady state: the motion test runs but resets no blocks); < 1 ms at 1080p
+    TemporalFilter temporal;
+    cv::Mat filtered = ndvi.clone();
+    temporal.setMode(TemporalFilter::EMA);
+    bench.run("TemporalFilter EMA", size, [&]() { temporal.apply(filtered); },
+              fullHd ? 1.0 : 0.0);
+    temporal.setMode(TemporalFilter::Box);
+    bench.run("TemporalFilter Box", size, [&]() { temporal.apply(filtered); },
+              fullHd ? 1.0 : 0.0);
+    GuidedFilter guided;
+    FramePyramid pyramid;
+    pyramid.reset(frame);
+    bench.run("GuidedFilter::apply", size, [&]() {
+        cv::Mat n = ndvi.clone();
+        guided.apply(pyramid.level(0), n, mask);
+    });
+    Compositor compositor;
+    compositor.setMode(Compositor::Max);
+    bench.run("Compositor::add Max", size, [&]() { compositor.add(ndvi, mask); });
+    compositor.setMode(Compositor::Percentile);
+    bench.run("Compositor::add Percentile", size, [&]() { compositor.add(ndvi, mask); });
+    IsolineExtractor isolines;
+    isolines.setLevels({ 0.2f, 0.4f, 0.6f });
+    bench.run("IsolineExtractor::extract", size, [&]() { isolines.extract(ndvi, mask); });
+
+    // Frame-level analysis
+    bench.run("FramePyramid::reset+level2", size, [&]() {
+        pyramid.reset(frame);
+        pyramid.level(2);
+    });
+    RoiTracker tracker;
+    FramePyramid pyrA, pyrB;
+    pyrA.reset(frame);
+    pyrB.reset(next);
+    tracker.start(pyrA, cv::Rect(size.width / 3, size.height / 3, size.width / 6, size.height / 6));
+    // Pyramid levels are shared with the other stages, so only the search
+    // is timed; < 2 ms per frame at any size
+    bench.run("RoiTracker::update", size, [&]() { tracker.update(pyrB); }, 2.0);
+    FrameQuality quality;
+    quality.setMode(FrameQuality::Flag);
+    bench.run("FrameQuality::assess", size, [&]() {
+        FrameMeta m;
+        quality.assess(frame, m);
+    });
+    KeyframeSelector keyframes;
+    bool flip = false;
+    bench.run("KeyframeSelector::update", size, [&]() {
+        keyframes.update((flip = !flip) ? pyrA : pyrB, true);
+    });
+
+    // GUI paths
+    bench.run("NDVIApp::drawOverlay", size, [&]() {
+        NDVIAppBench::drawOverlay(app, coloured, ndvi, mask, stats);
+    });
+    bench.run("NDVIApp::setPixmap", size, [&]() { NDVIAppBench::setPixmap(app, coloured); });
+    bench.run("NDVIApp::updatePreview", size, [&]() {
+        NDVIAppBench::updatePreview(app, ndvi, mask);
+    });
+    bench.run("NDVIApp::autoCalibrate", size, [&]() {
+        NDVIAppBench::autoCalibrate(app, ndvi, mask);
+    });
+    bench.run("NDVIApp::processFrame", size, [&]() {
+        NDVIAppBench::processFrame(app, frame, meta);
+    });
+    // The same path with the trace recorder on; its budget is the untraced
+    // median plus the 1% tracing target
+    if (TraceRecorder::available()) {
+        const double untraced = bench.median("NDVIApp::processFrame", size);
+        TraceRecorder::setEnabled(true);
+        bench.run("NDVIApp::processFrame traced", size, [&]() {
+            NDVIAppBench::processFrame(app, frame, meta);
+        }, untraced * 1.01);
+        TraceRecorder::setEnabled(false);
+    }
+    // Dual rig: registration, fused remap and index at the 30 fps camera rate
+    bench.run("NDVIApp::processFrame dual", size, [&]() {
+        NDVIAppBench::processFrame(app, frame, nir, meta);
+    }, fullHd ? 1000.0 / 30.0 : 0.0);
+}
+
+/**
+ * @brief stagesJson summarises the pipeline stages timed inside the
+ * benchmarks (mainly NDVIApp::processFrame), with counters when enabled.
+ */
+QJsonArray stagesJson(const StageProfiler::Snapshot &snap)
+{
+    QJsonArray out;
+    for (int s = 0; s < StageProfiler::STAGE_COUNT; ++s) {
+        const StageStats st = snap.stats(StageProfiler::Stage(s));
+        if (st.count == 0) {
+            continue;
+        }
+        QJsonObject o;
+        o["stage"] = StageProfiler::name(StageProfiler::Stage(s));
+        o["count"] = double(st.count);
+        o["p50_ms"] = st.p50Us / 1000.0;
+        o["p99_ms"] = st.p99Us / 1000.0;
+        o["mean_ms"] = st.meanUs / 1000.0;
+        counterJson(o, st.ipc, st.cyclesPerPx, st.llcPerPx, st.branchPerPx);
+        out.append(o);
+    }
+    return out;
+}
+
+} // namespace
+
+/**
+ * @brief main runs the microbenchmarks and writes the JSON report.
+ */
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", QByteArray("offscreen"));
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("razielnd_bench");
+    // Keep the user's settings out of the measurements
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks of the NDVI pipeline stages.");
+    parser.addHelpOption();
+    QCommandLineOption outOpt({"o", "output"}, "JSON report.", "file", "bench.json");
+    QCommandLineOption repsOpt("reps", "Timed repetitions.", "n", "50");
+    QCommandLineOption warmupOpt("warmup", "Untimed repetitions first.", "n", "5");
+    QCommandLineOption filterOpt("filter", "Only benchmarks whose name contains this.", "text");
+    QCommandLineOption sizesOpt("sizes", "Frame sizes.", "WxH,...", "640x480,1920x1080,3840x2160");
+    QCommandLineOption labelOpt("label", "Free-form run label, e.g. a commit id.", "text");
+    QCommandLineOption perfOpt("perf", "Count cycles, instructions, LLC and branch misses (Linux).");
+    parser.addOptions({outOpt, repsOpt, warmupOpt, filterOpt, sizesOpt, labelOpt, perfOpt});
+    parser.process(app);
+
+    QString counters = "off";
+    if (parser.isSet(perfOpt)) {
+        if (PerfCounters::setEnabled(true)) {
+            counters = "on";
+        } else {
+            counters = "unavailable: " + PerfCounters::unavailableReason();
+            QTextStream(stderr) << "Hardware counters " << counters << "\n";
+        }
+    }
+
+    std::vector<cv::Size> sizes;
+    for (const QString &s : parser.value(sizesOpt).split(',', Qt::SkipEmptyParts)) {
+        const QStringList wh = s.split('x');
+        if (wh.size() == 2 && wh[0].toInt() > 0 && wh[1].toInt() > 0) {
+            sizes.emplace_back(wh[0].toInt(), wh[1].toInt());
+        }
+    }
+    if (sizes.empty()) {
+        QTextStream(stderr) << "No valid --sizes\n";
+        return 2;
+    }
+
+    Bench bench(parser.value(warmupOpt).toInt(), parser.value(repsOpt).toInt(),
+                parser.value(filterOpt));
+    QTemporaryDir tmp;
+    NDVIApp window;
+
+    bench.run("makePaletteLUT", cv::Size(256, 1), []() {
+        makePaletteLUT(QColor(Qt::red), QColor(Qt::yellow), QColor(Qt::green));
+    });
+    for (const cv::Size &size : sizes) {
+        runSize(bench, window, size, tmp);
+    }
+
+    QJsonObject report;
+    report["label"] = parser.value(labelOpt);
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["host"] = QSysInfo::machineHostName();
+    report["cpu"] = QSysInfo::currentCpuArchitecture();
+    report["threads"] = QThread::idealThreadCount();
+    report["opencv"] = QString::fromStdString(cv::getVersionString());
+    report["perf_counters"] = counters;
+    if (PerfCounters::isEnabled()) {
+        report["perf_counters_scope"] = QString("calling thread + %1 OpenCV worker threads")
+                                            .arg(PerfCounters::poolThreads());
+    }
+    report["results"] = bench.json();
+    report["stages"] = stagesJson(StageProfiler::snapshot());
+    QFile file(parser.value(outOpt));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QTextStream(stderr) << "Cannot write " << file.fileName() << "\n";
+        return 1;
+    }
+    file.write(QJsonDocument(report).toJson());
+    return 0;
+}
@@ -0,0 +1,490 @@
+//------------------------------------------------------------------------------
+// bench/razielnd_e2e.cpp
+//------------------------------------------------------------------------------
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "BatchRunner.h"
+#include "NDVIAppBench.h"
+#include "RawDumpSource.h"
+#include "ReplaySource.h"
+#include "SyntheticSource.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Allocation counting. With glibc every heap allocation (operator new and
+// OpenCV's aligned buffers alike) goes through malloc, which this executable
+// interposes; elsewhere only operator new is counted.
+//------------------------------------------------------------------------------
+
+static std::atomic<long long> g_allocations(0);
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void *calloc(size_t n, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+void *realloc(void *ptr, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : 12;  // ENOMEM
+}
+}
+#else
+#include <new>
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+#endif
+
+namespace {
+
+/**
+ * @brief peakRssMb returns the peak resident set size of the process.
+ */
+double peakRssMb()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+    return usage.ru_maxrss / 1024.0;             // kilobytes
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+/**
+ * @brief percentile returns the p-th percentile of sorted values.
+ */
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const size_t i = size_t(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, i > 0 ? i - 1 : 0)];
+}
+
+/**
+ * @brief hashImage hashes the pixels of the processed view.
+ */
+QString hashImage(const QImage &image)
+{
+    const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (int y = 0; y < rgb.height(); ++y) {
+        hash.addData(reinterpret_cast<const char *>(rgb.constScanLine(y)), rgb.width() * 3);
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+/**
+ * @brief hashNdvi hashes the float NDVI plane.
+ */
+QString hashNdvi(const cv::Mat &ndvi)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (int y = 0; y < ndvi.rows; ++y) {
+        hash.addData(ndvi.ptr<const char>(y), int(ndvi.cols * ndvi.elemSize()));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+/**
+ * @brief readJson reads a JSON object file, empty on failure.
+ */
+QJsonObject readJson(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+/**
+ * @brief writeJson writes a JSON object file.
+ */
+bool writeJson(const QString &path, const QJsonObject &obj)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    file.write(QJsonDocument(obj).toJson());
+    return true;
+}
+
+/**
+ * @brief batchHashes runs the batch engine over a video and hashes the NDVI
+ * plane of every frame it wrote, keyed by frame name.
+ * @return false if the run failed; @p error says why
+ */
+bool batchHashes(const QString &video, const QString &outDir, int shards,
+                 QMap<QString, QString> &hashes, QString &error)
+{
+    BatchOptions options;
+    options.input = video;
+    options.outDir = outDir;
+    options.shards = shards;
+    options.writeNdvi = true;
+    options.writeColour = false;
+    BatchRunner runner(options);
+    if (!runner.run()) {
+        error = runner.error();
+        return false;
+    }
+    const QDir ndvi(QDir(outDir).filePath("ndvi"));
+    for (const QString &f : ndvi.entryList({"*.tiff"}, QDir::Files, QDir::Name)) {
+        hashes[f] = hashNdvi(cv::imread(ndvi.filePath(f).toStdString(), cv::IMREAD_UNCHANGED));
+    }
+    if (hashes.size() != runner.report().frames) {
+        error = QString("%1 frames reported, %2 written").arg(runner.report().frames).arg(hashes.size());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief shardCheck runs a video through the batch engine in one process
+ * and in shards, and compares the frame count and per-frame NDVI hashes.
+ */
+QJsonObject shardCheck(const QString &video, int shards)
+{
+    QJsonObject result;
+    result["shards"] = shards;
+    QTemporaryDir tmp;
+    QMap<QString, QString> single, sharded;
+    QString error;
+    if (!tmp.isValid()
+        || !batchHashes(video, tmp.filePath("single"), 1, single, error)
+        || !batchHashes(video, tmp.filePath("sharded"), shards, sharded, error)) {
+        result["error"] = tmp.isValid() ? error : QString("no temporary directory");
+        result["ok"] = false;
+        return result;
+    }
+    int mismatches = 0;
+    for (auto it = single.cbegin(); it != single.cend(); ++it) {
+        if (sharded.value(it.key()) != it.value()) {
+            ++mismatches;
+        }
+    }
+    result["frames"] = single.size();
+    result["sharded_frames"] = sharded.size();
+    result["hash_mismatches"] = mismatches;
+    result["ok"] = single.size() == sharded.size() && mismatches == 0;
+    return result;
+}
+
+} // namespace
+
+/**
+ * @brief main drives the pipeline from a replay or synthetic source,
+ * checks it against golden outputs and a metrics baseline.
+ * @return 0 pass, 1 golden mismatch or regression, 2 setup error
+ */
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", QByteArray("offscreen"));
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("razielnd_e2e");
+    QStandardPaths::setTestModeEnabled(true);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("End-to-end pipeline regression harness.");
+    parser.addHelpOption();
+    QCommandLineOption replayOpt("replay", "Video, image directory or .rzdump to replay.", "path");
+    QCommandLineOption syntheticOpt("synthetic", "Synthetic scene size (default source).", "WxH", "1280x720");
+    QCommandLineOption framesOpt("frames", "Frames to process.", "n", "300");
+    QCommandLineOption goldenOpt("golden", "Golden reference directory.", "dir");
+    QCommandLineOption writeGoldenOpt("write-golden", "Write the golden references instead of checking.");
+    QCommandLineOption everyOpt("golden-every", "Keep the NDVI plane of every Nth frame.", "n", "30");
+    QCommandLineOption tolOpt("ndvi-tol", "Largest NDVI difference allowed.", "value", "1e-4");
+    QCommandLineOption noHashOpt("no-hash", "Do not compare output hashes (cross-platform runs).");
+    QCommandLineOption baselineOpt("baseline", "Metrics baseline file.", "file");
+    QCommandLineOption writeBaselineOpt("write-baseline", "Write the baseline instead of checking.");
+    QCommandLineOption thresholdOpt("threshold", "Allowed regression as a fraction.", "value", "0.10");
+    QCommandLineOption reportOpt({"o", "output"}, "Metrics report.", "file", "e2e.json");
+    QCommandLineOption shardOpt("shard-check",
+                                "Also batch the replayed video in n shards and in one process "
+                                "and compare frame count and NDVI hashes.", "n");
+    parser.addOptions({replayOpt, syntheticOpt, framesOpt, goldenOpt, writeGoldenOpt, everyOpt,
+                       tolOpt, noHashOpt, baselineOpt, writeBaselineOpt, thresholdOpt, reportOpt,
+                       shardOpt});
+    parser.process(app);
+
+    // Source
+    std::unique_ptr<FrameSource> source;
+    SyntheticSource *synthetic = nullptr;
+    bool exact = false;
+    if (parser.isSet(replayOpt)) {
+        const QString path = parser.value(replayOpt);
+        exact = QFileInfo(path).suffix().compare("rzdump", Qt::CaseInsensitive) == 0;
+        if (exact) {
+            source = std::make_unique<RawDumpSource>(path);
+        } else {
+            source = std::make_unique<ReplaySource>(path);
+        }
+    } else {
+        const QStringList wh = parser.value(syntheticOpt).split('x');
+        SceneParams params;
+        params.width = wh.value(0).toInt();
+        params.height = wh.value(1).toInt();
+        auto s = std::make_unique<SyntheticSource>(params);
+        synthetic = s.get();
+        source = std::move(s);
+    }
+    if (!source->open()) {
+        err << "Source failed: " << source->error() << "\n";
+        return 2;
+    }
+
+    const int frames = std::max(1, parser.value(framesOpt).toInt());
+    const int every = std::max(1, parser.value(everyOpt).toInt());
+    const bool writeGolden = parser.isSet(writeGoldenOpt);
+    const QDir golden(parser.value(goldenOpt));
+    if (parser.isSet(goldenOpt) && writeGolden && !QDir().mkpath(golden.path())) {
+        err << "Cannot create " << golden.path() << "\n";
+        return 2;
+    }
+    const QJsonArray goldenFrames = parser.isSet(goldenOpt) && !writeGolden
+        ? readJson(golden.filePath("golden.json"))["frames"].toArray() : QJsonArray();
+    const double tol = parser.value(tolOpt).toDouble();
+
+    NDVIApp window;
+    NDVIAppBench::resetState(window);
+
+    // Drive the pipeline
+    std::vector<double> latencies;
+    latencies.reserve(size_t(frames));
+    QJsonArray frameRecords;
+    int hashMismatches = 0, ndviMismatches = 0, processed = 0;
+    double worstNdvi = 0.0, truthError = 0.0;
+    long long truthPixels = 0;
+    long long allocStart = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        if (i == 1) {
+            // First-frame table and buffer setup is not steady state
+            allocStart = g_allocations.load();
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        cv::Mat frame, nir;
+        FrameMeta meta;
+        if (!source->readDual(frame, nir, meta)) {
+            break;
+        }
+        QJsonObject params;
+        if (source->takeParams(params)) {
+            NDVIAppBench::applyParams(window, params);
+        }
+        NDVIAppBench::processFrame(window, frame, nir, meta, exact);
+        latencies.push_back(std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - t0).count());
+        ++processed;
+
+        // Output checks
+        const cv::Mat &ndvi = NDVIAppBench::lastNDVI(window);
+        QJsonObject rec;
+        rec["sequence"] = double(meta.sequence);
+        rec["display"] = hashImage(NDVIAppBench::display(window));
+        rec["ndvi"] = hashNdvi(ndvi);
+        const QString tiff = golden.filePath(QString("ndvi_%1.tiff").arg(i, 6, 10, QChar('0')));
+        if (writeGolden && i % every == 0) {
+            cv::imwrite(tiff.toStdString(), ndvi);
+        } else if (!goldenFrames.isEmpty()) {
+            const QJsonObject ref = goldenFrames.at(i).toObject();
+            if (!parser.isSet(noHashOpt)
+                && (ref["display"].toString() != rec["display"].toString()
+                    || ref["ndvi"].toString() != rec["ndvi"].toString())) {
+                ++hashMismatches;
+            }
+            if (i % every == 0) {
+                const cv::Mat refNdvi = cv::imread(tiff.toStdString(), cv::IMREAD_UNCHANGED);
+                double diff = std::numeric_limits<double>::infinity();
+                if (refNdvi.size() == ndvi.size() && refNdvi.type() == ndvi.type()) {
+                    diff = cv::norm(refNdvi, ndvi, cv::NORM_INF);
+                }
+                worstNdvi = std::max(worstNdvi, diff);
+                if (diff > tol) {
+                    ++ndviMismatches;
+                }
+            }
+        }
+        frameRecords.append(rec);
+
+        // Accuracy against the synthetic ground truth (valid in both)
+        if (synthetic && ndvi.size() == frame.size()) {
+            cv::Mat truth, truthMask;
+            synthetic->truth(meta.sequence, truth, truthMask);
+            const cv::Mat valid = (truthMask == 0) & (NDVIAppBench::lastMask(window) == 0);
+            cv::Mat diff;
+            cv::absdiff(truth, ndvi, diff);
+            truthError += cv::sum(diff.setTo(0.0f, valid == 0))[0];
+            truthPixels += cv::countNonZero(valid);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const long long allocations = g_allocations.load() - allocStart;
+
+    // Metrics
+    std::sort(latencies.begin(), latencies.end());
+    QJsonObject metrics;
+    metrics["fps"] = seconds > 0.0 ? processed / seconds : 0.0;
+    metrics["p50_ms"] = percentile(latencies, 50.0);
+    metrics["p99_ms"] = percentile(latencies, 99.0);
+    metrics["peak_rss_mb"] = peakRssMb();
+    metrics["allocs_per_frame"] = processed > 1 ? double(allocations) / (processed - 1) : 0.0;
+    QJsonObject report;
+    report["source"] = source->description();
+    report["frames"] = processed;
+    report["metrics"] = metrics;
+    if (truthPixels > 0) {
+        report["truth_mae"] = truthError / double(truthPixels);
+    }
+    if (!goldenFrames.isEmpty()) {
+        report["hash_mismatches"] = hashMismatches;
+        report["ndvi_mismatches"] = ndviMismatches;
+        report["ndvi_max_diff"] = worstNdvi;
+    }
+
+    out << QString("%1 frames, %2 fps, p50 %3 ms, p99 %4 ms, peak RSS %5 MB, %6 allocs/frame\n")
+               .arg(processed).arg(metrics["fps"].toDouble(), 0, 'f', 1)
+               .arg(metrics["p50_ms"].toDouble(), 0, 'f', 2).arg(metrics["p99_ms"].toDouble(), 0, 'f', 2)
+               .arg(metrics["peak_rss_mb"].toDouble(), 0, 'f', 1)
+               .arg(metrics["allocs_per_frame"].toDouble(), 0, 'f', 1);
+
+    bool failed = false;
+    if (writeGolden) {
+        QJsonObject g;
+        g["source"] = source->description();
+        g["frames"] = frameRecords;
+        if (!writeJson(golden.filePath("golden.json"), g)) {
+            err << "Cannot write golden.json\n";
+            return 2;
+        }
+        out << "Golden references written to " << golden.path() << "\n";
+    } else if (parser.isSet(goldenOpt)) {
+        if (goldenFrames.isEmpty()) {
+            err << "No golden.json in " << golden.path() << "\n";
+            return 2;
+        }
+        if (goldenFrames.size() != frameRecords.size()) {
+            err << "Golden has " << goldenFrames.size() << " frames, run has " << frameRecords.size() << "\n";
+            failed = true;
+        }
+        if (hashMismatches > 0 || ndviMismatches > 0) {
+            err << QString("Golden mismatch: %1 hash, %2 NDVI (max diff %3)\n")
+                       .arg(hashMismatches).arg(ndviMismatches).arg(worstNdvi);
+            failed = true;
+        }
+    }
+
+    // Sharded batch against a single-process batch of the same video
+    if (parser.isSet(shardOpt)) {
+        const QString video = parser.value(replayOpt);
+        if (video.isEmpty() || exact || QFileInfo(video).isDir()) {
+            err << "--shard-check needs --replay with a video file\n";
+            return 2;
+        }
+        const QJsonObject check = shardCheck(video, std::max(2, parser.value(shardOpt).toInt()));
+        report["shard_check"] = check;
+        if (!check["ok"].toBool()) {
+            err << QString("Shard mismatch: %1 frames single, %2 sharded, %3 hash%4\n")
+                       .arg(check["frames"].toInt()).arg(check["sharded_frames"].toInt())
+                       .arg(check["hash_mismatches"].toInt())
+                       .arg(check.contains("error") ? ", " + check["error"].toString() : QString());
+            failed = true;
+        }
+    }
+
+    // Baseline: throughput may not drop, the rest may not grow, past the threshold
+    if (parser.isSet(baselineOpt)) {
+        if (parser.isSet(writeBaselineOpt)) {
+            if (!writeJson(parser.value(baselineOpt), metrics)) {
+                err << "Cannot write the baseline\n";
+                return 2;
+            }
+        } else {
+            const QJsonObject base = readJson(parser.value(baselineOpt));
+            if (base.isEmpty()) {
+                err << "Cannot read the baseline\n";
+                return 2;
+            }
+            const double t = parser.value(thresholdOpt).toDouble();
+            QJsonArray regressions;
+            for (const QString &key : metrics.keys()) {
+                const double now = metrics[key].toDouble();
+                const double then = base[key].toDouble();
+                if (then <= 0.0) {
+                    continue;
+                }
+                const bool worse = key == "fps" ? now < then * (1.0 - t) : now > then * (1.0 + t);
+                if (worse) {
+                    err << QString("Regression: %1 %2 → %3\n").arg(key).arg(then).arg(now);
+                    regressions.append(key);
+                }
+            }
+            report["regressions"] = regressions;
+            failed = failed || !regressions.isEmpty();
+        }
+    }
+
+    writeJson(parser.value(reportOpt), report);
+    return failed ? 1 : 0;
+}
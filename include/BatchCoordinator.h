@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+// include/BatchCoordinator.h
+//------------------------------------------------------------------------------
+
+#ifndef BATCHCOORDINATOR_H
+#define BATCHCOORDINATOR_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QList>
+#include "BatchRunner.h"
+#include "WorkQueue.h"
+
+/**
+ * @brief The BatchCoordinator class distributes a job manifest over worker
+ * processes through a WorkQueue directory and merges their results.
+ *
+ * The manifest lists one input per line, optionally followed by a first and
+ * last frame. The coordinator starts N local workers (this executable with
+ * --batch --worker), restarts any that exit while work remains, and
+ * requeues the claims of dead workers and claims with stale heartbeats.
+ * Workers on other nodes join by running --worker on the same queue
+ * directory over shared storage. When no item is pending or claimed, the
+ * per-item stats are merged in manifest order, so the merged output is
+ * the same whichever worker ran what.
+ */
+class BatchCoordinator : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief BatchCoordinator constructor
+     * @param options engine options shared by all items (input is ignored)
+     * @param queueDir queue directory (shared storage for multi-node runs)
+     * @param processes local worker processes to start
+     */
+    BatchCoordinator(const BatchOptions &options, const QString &queueDir,
+                     int processes, QObject *parent = nullptr);
+
+    /**
+     * @brief setMaxAttempts sets how many times an item is tried
+     */
+    void setMaxAttempts(int attempts) { m_maxAttempts = attempts; }
+
+    /**
+     * @brief setStaleMs sets the heartbeat age after which a claim is requeued
+     */
+    void setStaleMs(qint64 ms) { m_staleMs = ms; }
+
+    /**
+     * @brief start enqueues the manifest and starts the workers
+     * @return false if the manifest or the queue cannot be set up
+     */
+    bool start(const QString &manifest);
+
+    /**
+     * @brief error describes the last failure
+     */
+    QString error() const { return m_error; }
+
+    /**
+     * @brief runWorker claims and processes items until the queue is empty
+     * @param queueDir queue directory
+     * @return process exit code
+     */
+    static int runWorker(const QString &queueDir);
+
+signals:
+    /**
+     * @brief finished emitted after the merge
+     * @param ok true if every item succeeded and the merge was written
+     */
+    void finished(bool ok);
+
+private slots:
+    void poll();
+    void onWorkerFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    void spawnWorker();
+    bool merge();
+
+    BatchOptions      m_options;
+    WorkQueue         m_queue;
+    QString           m_queueDir;
+    int               m_processes;    // local worker processes to keep running
+    int               m_maxAttempts;
+    qint64            m_staleMs;
+    QList<QProcess *> m_workers;
+    QTimer            m_timer;        // queue poll
+    QString           m_error;
+};
+
+#endif // BATCHCOORDINATOR_H
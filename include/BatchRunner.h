@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------
+// include/BatchRunner.h
+//------------------------------------------------------------------------------
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QJsonObject>
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include "NDVIKernel.h"
+
+/**
+ * @brief BatchOptions configures a headless run.
+ */
+struct BatchOptions
+{
+    QString   input;                    // video file, image directory or ENVI header
+    QString   outDir;                   // output directory
+    QString   palette     = "NDVI Classic";
+    float     vmin        = 0.0f;       // palette window
+    float     vmax        = 1.0f;
+    BandGains gains;                    // radiometric band gains
+    int       satLevel    = 255;        // mask thresholds
+    int       minSignal   = 8;
+    bool      writeColour = true;       // coloured output (video or PNG)
+    bool      writeNdvi   = false;      // float NDVI .tiff per frame
+    bool      smooth      = false;      // guided-filter smoothing
+    int       decoders    = 0;          // decoder threads, 0 = auto
+    int       workers     = 0;          // processing threads, 0 = auto
+    int       queueDepth  = 16;         // frames in flight
+    int       shards      = 1;          // video shards decoded in parallel, 0 = auto
+    qint64    firstFrame  = 0;          // first frame (or image) to process
+    qint64    lastFrame   = -1;         // last frame, -1 = to the end
+
+    QJsonObject toJson() const;
+    static BatchOptions fromJson(const QJsonObject &obj);
+};
+
+/**
+ * @brief BatchReport summarises a finished run.
+ */
+struct BatchReport
+{
+    qint64 frames  = 0;    // frames written
+    qint64 failed  = 0;    // frames that could not be decoded
+    qint64 pixels  = 0;    // pixels processed
+    double ndviSum = 0.0;  // NDVI summed over valid pixels, in frame order
+    qint64 valid   = 0;    // valid pixels
+    double seconds = 0.0;  // wall time
+
+    double fps() const { return seconds > 0.0 ? frames / seconds : 0.0; }
+    double pixelsPerSecond() const { return seconds > 0.0 ? pixels / seconds : 0.0; }
+};
+
+/**
+ * @brief The BatchRunner class runs the NDVI engine without a GUI over a
+ * video file or an image directory (ENVI rasters go to TiledBatchProcessor).
+ *
+ * Decoder threads (one per image for directories; one multithreaded
+ * decoder for video) feed a bounded queue; worker threads run the fused
+ * kernel and optional smoothing; the calling thread writes results in
+ * frame order: coloured output, float NDVI and a per-frame stats CSV.
+ * At most queueDepth frames are in flight. Slots are handed out in frame
+ * order, so the writer can never wait on a frame that has no slot.
+ *
+ * With shards != 1 a video is first indexed (VideoIndex) and cut into
+ * GOP-aligned frame ranges. Each range runs in its own BatchRunner with
+ * its own decoder; the results are stitched in frame order.
+ */
+class BatchRunner
+{
+public:
+    /**
+     * @brief BatchRunner constructor
+     */
+    explicit BatchRunner(const BatchOptions &options);
+
+    /**
+     * @brief setProgress sets a callback run on the calling thread after
+     * each written frame
+     */
+    void setProgress(std::function<void(qint64 frames)> progress);
+
+    /**
+     * @brief run processes the input
+     * @return false on a setup or write error
+     */
+    bool run();
+
+    /**
+     * @brief error describes the last failure
+     */
+    QString error() const { return m_error; }
+
+    /**
+     * @brief report returns the counters of the last run
+     */
+    const BatchReport &report() const { return m_report; }
+
+private:
+    bool runTiled(const cv::Mat &lut);
+    bool runSharded(int shards);
+
+    BatchOptions m_options;
+    std::function<void(qint64)> m_progress;
+    QString      m_error;
+    BatchReport  m_report;
+};
+
+#endif // BATCHRUNNER_H
@@ -9,11 +9,18 @@
 #include <QObject>
 #include <opencv2/opencv.hpp>
 #include <QMetaType>
+#include <QSemaphore>
+#include <memory>
+#include "FrameMeta.h"
+#include "FrameSource.h"
 Q_DECLARE_METATYPE(cv::Mat)
 
 /**
  * @brief The CaptureThread class reads frames from a camera index
  * in a separate thread and emits the raw BGR cv::Mat frames.
+ * With a second (NIR) camera index it captures both devices and emits
+ * timestamp-matched pairs instead. Constructed with a FrameSource it
+ * plays recorded or generated frames through the same signal instead.
  */
 class CaptureThread : public QThread
 {
@@ -22,10 +29,52 @@ class CaptureThread : public QThread
 public:
     /**
      * @brief CaptureThread constructor
-     * @param camIndex index of the camera to open
+     * @param camIndex index of the camera to open (RGB camera on a dual rig)
+     * @param nirIndex index of the NIR camera on a dual rig, -1 for single camera
      * @param parent optional parent QObject
      */
-    explicit CaptureThread(int camIndex, QObject *parent = nullptr);
+    explicit CaptureThread(int camIndex, int nirIndex = -1, QObject *parent = nullptr);
+
+    /**
+     * @brief Pacing selects how a FrameSource is played
+     */
+    enum Pacing {
+        RealTime,   // follow the recorded timestamps
+        FixedRate,  // a constant rate, see setPacing()
+        MaxSpeed    // as fast as the consumer takes frames
+    };
+
+    /**
+     * @brief CaptureThread constructor for a non-camera source
+     * @param source frame source, owned by the thread
+     * @param parent optional parent QObject
+     */
+    explicit CaptureThread(std::unique_ptr<FrameSource> source, QObject *parent = nullptr);
+
+    /**
+     * @brief setPacing sets the playback pacing of a FrameSource
+     * @param pacing pacing mode
+     * @param rate frames/s for FixedRate, 0 = the source's own frameRate()
+     */
+    void setPacing(Pacing pacing, double rate = 0.0);
+
+    /**
+     * @brief setLoop restarts the source when it ends
+     */
+    void setLoop(bool loop) { m_loop = loop; }
+
+    /**
+     * @brief frameConsumed returns a credit once a source frame has been
+     * processed; source playback holds at most SOURCE_CREDITS frames in flight
+     */
+    void frameConsumed() { m_credits.release(); }
+
+    /**
+     * @brief isSource returns true when playing a FrameSource
+     */
+    bool isSource() const { return m_source != nullptr; }
+
+    static constexpr int SOURCE_CREDITS = 2;
 
     /**
      * @brief stop stops the capture loop and releases the camera
@@ -36,8 +85,31 @@ signals:
     /**
      * @brief frameReady signal emitted when a new BGR frame is available
      * @param frame the captured frame as cv::Mat
+     * @param meta capture sequence and timestamp
+     */
+    void frameReady(const cv::Mat &frame, const FrameMeta &meta);
+
+    /**
+     * @brief dualFrameReady signal emitted with a matched RGB/NIR pair
+     * @param rgb frame from the visible camera
+     * @param nir frame from the NIR camera
+     * @param meta sequence, RGB timestamp and pair skew
+     */
+    void dualFrameReady(const cv::Mat &rgb, const cv::Mat &nir, const FrameMeta &meta);
+
+    /**
+     * @brief sourceParams signal emitted before a source frame that was
+     * recorded with new pipeline parameters
+     * @param params parameter snapshot
+     */
+    void sourceParams(const QJsonObject &params);
+
+    /**
+     * @brief sourceFailed signal emitted when the FrameSource cannot be
+     * opened or stops on a read error
+     * @param error the source's error()
      */
-    void frameReady(const cv::Mat &frame);
+    void sourceFailed(const QString &error);
 
 protected:
     /**
@@ -53,9 +125,31 @@ private:
      */
     static cv::VideoCapture openCamera(int index);
 
-    int m_camIndex;             // camera index
-    bool m_running;             // flag indicating capture loop
-    cv::VideoCapture m_capture; // OpenCV capture object
+    /**
+     * @brief grabPair grabs both cameras, re-grabbing the lagging one
+     * until the timestamps agree within m_maxSkewUs
+     * @param tRgb receives the RGB grab time (microseconds)
+     * @param tNir receives the NIR grab time (microseconds)
+     * @return false if either device stopped delivering frames
+     */
+    bool grabPair(qint64 &tRgb, qint64 &tNir);
+
+    void runSingle();
+    void runDual();
+    void runSource();
+
+    int m_camIndex;                // camera index
+    int m_nirIndex;                // NIR camera index, -1 if single camera
+    bool m_running;                // flag indicating capture loop
+    cv::VideoCapture m_capture;    // OpenCV capture object
+    cv::VideoCapture m_nirCapture; // NIR capture object on dual rigs
+    qint64 m_sequence;             // next frame sequence number
+    qint64 m_maxSkewUs;            // largest accepted RGB/NIR skew
+    std::unique_ptr<FrameSource> m_source;  // replay or synthetic input, null for cameras
+    Pacing m_pacing;               // FrameSource playback pacing
+    double m_rate;                 // FixedRate frames/s, 0 = the source's rate
+    bool m_loop;                   // restart the source at its end
+    QSemaphore m_credits;          // frames the consumer will still accept
 };
 
-#endif // CAPTURETHREAD_H
\ No newline at end of file
+#endif // CAPTURETHREAD_H
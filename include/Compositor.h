@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// include/Compositor.h
+//------------------------------------------------------------------------------
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief The Compositor class builds per-pixel temporal composites of the
+ * NDVI plane (max NDVI, median, percentile) over a sliding window of
+ * frames or a whole pass.
+ *
+ * NDVI is quantised to int8 (v * 127). For Median and Percentile each
+ * pixel keeps a 32-bin uint16 histogram of those values (one cache line
+ * per pixel), from which the median/percentile is read by interpolating
+ * inside the target bin. A sliding window additionally keeps a ring of
+ * the last N int8 planes so frames leaving the window can be subtracted
+ * again. Max needs no histograms: whole-pass max is a float running
+ * maximum, windowed max a scan of the ring.
+ */
+class Compositor
+{
+public:
+    enum Mode
+    {
+        Off,         // not accumulating
+        Max,         // per-pixel maximum NDVI
+        Median,      // per-pixel median
+        Percentile   // per-pixel percentile (see setPercentile)
+    };
+
+    /**
+     * @brief Compositor constructor, starts disabled over a whole pass
+     */
+    Compositor();
+
+    /**
+     * @brief setMode selects the composite; the accumulated state is kept
+     * between Median and Percentile and when switching to Max. Switching
+     * from Max to a histogram mode starts a new pass.
+     */
+    void setMode(Mode mode);
+
+    /**
+     * @brief mode returns the selected composite
+     */
+    Mode mode() const { return m_mode; }
+
+    /**
+     * @brief setWindow sets the window length and resets the state
+     * @param frames number of frames, 0 for the whole pass
+     */
+    void setWindow(int frames);
+
+    /**
+     * @brief setPercentile sets the percentile used by Percentile mode
+     * @param p percentile in [0, 100]
+     */
+    void setPercentile(float p);
+
+    /**
+     * @brief reset starts a new pass
+     */
+    void reset();
+
+    /**
+     * @brief add accumulates one NDVI frame; masked pixels are skipped
+     * @param ndvi CV_32F NDVI plane
+     * @param mask validity flags (CV_8U, 0 = valid)
+     */
+    void add(const cv::Mat &ndvi, const cv::Mat &mask);
+
+    /**
+     * @brief frames returns the number of frames currently composited
+     */
+    int frames() const { return m_frames; }
+
+    /**
+     * @brief composite evaluates the selected composite
+     * @param ndvi output CV_32F composite NDVI plane
+     * @param mask output flags, MASK_LOW_SIGNAL where no valid sample exists
+     * @return false if nothing has been accumulated yet
+     */
+    bool composite(cv::Mat &ndvi, cv::Mat &mask) const;
+
+private:
+    void initialise(const cv::Size &size);
+    static bool usesHistograms(Mode mode) { return mode == Median || mode == Percentile; }
+
+    Mode                 m_mode;        // selected composite
+    int                  m_window;      // frames in the window, 0 = whole pass
+    float                m_percentile;  // Percentile mode target (0..100)
+    cv::Mat              m_hist;        // rows x (cols * BINS) CV_16U histograms, Median/Percentile only
+    cv::Mat              m_count;       // CV_16U valid samples per pixel
+    cv::Mat              m_max;         // CV_32F whole-pass running maximum
+    std::vector<cv::Mat> m_ring;        // CV_8S quantised planes (window only)
+    int                  m_head;        // next ring slot to overwrite
+    int                  m_frames;      // frames accumulated
+};
+
+#endif // COMPOSITOR_H
@@ -0,0 +1,107 @@
+//------------------------------------------------------------------------------
+// include/DualRegistration.h
+//------------------------------------------------------------------------------
+
+#ifndef DUALREGISTRATION_H
+#define DUALREGISTRATION_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+/**
+ * @brief The DualRegistration class registers the NIR camera of a dual rig
+ * onto the RGB camera.
+ *
+ * The NIR→RGB homography is estimated once (chessboard, falling back to
+ * ORB features) and cached on disk. From it a fixed-point sample map is
+ * precomputed: for every output pixel, the byte offset of the NIR sample
+ * and 8-bit bilinear weights, consumed directly by NDVIKernel::applyDual.
+ */
+class DualRegistration
+{
+public:
+    /**
+     * @brief DualRegistration constructor, starts uncalibrated (pure scaling)
+     */
+    DualRegistration();
+
+    /**
+     * @brief estimate solves the NIR→RGB homography from one frame pair
+     * @param rgb RGB camera frame
+     * @param nir NIR camera frame
+     * @param pattern inner corner count of the chessboard target
+     * @return true if a homography was found
+     */
+    bool estimate(const cv::Mat &rgb, const cv::Mat &nir,
+                  const cv::Size &pattern = cv::Size(9, 6));
+
+    /**
+     * @brief load reads a cached homography
+     * @param path OpenCV FileStorage file
+     * @return true if a homography was read
+     */
+    bool load(const std::string &path);
+
+    /**
+     * @brief save writes the homography cache
+     * @param path OpenCV FileStorage file
+     * @return true on success
+     */
+    bool save(const std::string &path) const;
+
+    /**
+     * @brief isCalibrated returns true once a homography is estimated or loaded
+     */
+    bool isCalibrated() const { return m_calibrated; }
+
+    /**
+     * @brief homography returns the NIR→RGB homography (identity if uncalibrated)
+     */
+    const cv::Matx33d &homography() const { return m_homography; }
+
+    /**
+     * @brief setHomography sets the homography directly (a raw dump replay)
+     */
+    void setHomography(const cv::Matx33d &H);
+
+    /**
+     * @brief clear returns to the uncalibrated state
+     */
+    void clear();
+
+    /**
+     * @brief prepare rebuilds the sample map if any input changed
+     * @param outSize size of the output (RGB view) grid
+     * @param nir NIR frame the map will sample (size and row step are keyed)
+     * @param outToRgb transform from output pixels to RGB frame pixels (zoom/pan)
+     */
+    void prepare(const cv::Size &outSize, const cv::Mat &nir, const cv::Matx33d &outToRgb);
+
+    /**
+     * @brief offsets returns the CV_32S map of NIR byte offsets (-1 = outside)
+     */
+    const cv::Mat &offsets() const { return m_offsets; }
+
+    /**
+     * @brief weights returns the CV_16U map of packed x (low byte) / y (high byte) weights
+     */
+    const cv::Mat &weights() const { return m_weights; }
+
+private:
+    bool estimateChessboard(const cv::Mat &rgbGray, const cv::Mat &nirGray,
+                            const cv::Size &pattern, cv::Mat &H) const;
+    bool estimateFeatures(const cv::Mat &rgbGray, const cv::Mat &nirGray, cv::Mat &H) const;
+
+    cv::Matx33d m_homography;  // maps NIR pixels onto RGB pixels
+    bool        m_calibrated;  // m_homography was estimated or loaded
+
+    cv::Mat     m_offsets;     // NIR byte offset per output pixel
+    cv::Mat     m_weights;     // packed bilinear weights per output pixel
+    cv::Size    m_mapOutSize;  // output size the map was built for
+    cv::Size    m_mapNirSize;  // NIR size the map was built for
+    size_t      m_mapNirStep;  // NIR row step the map was built for
+    cv::Matx33d m_mapView;     // outToRgb the map was built for
+    bool        m_mapDirty;    // homography changed since last build
+};
+
+#endif // DUALREGISTRATION_H
@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+// include/EnviRaster.h
+//------------------------------------------------------------------------------
+
+#ifndef ENVIRASTER_H
+#define ENVIRASTER_H
+
+#include <QFile>
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief The EnviRaster class reads windows of a multiband ENVI raw raster
+ * (text .hdr + binary data) without loading the image.
+ *
+ * BSQ, BIL and BIP interleaves with 8-bit or 16-bit unsigned samples in
+ * either byte order are supported. A window is read with one positioned
+ * read per row and band (one per row for BIP), so memory is bounded by the
+ * window, not the image.
+ */
+class EnviRaster
+{
+public:
+    enum Interleave { BSQ, BIL, BIP };
+
+    /**
+     * @brief EnviRaster constructor, starts closed
+     */
+    EnviRaster();
+
+    /**
+     * @brief open parses the header and opens the data file
+     * @param path the .hdr file or the data file next to it
+     * @return false on a missing or unsupported header or data file
+     */
+    bool open(const QString &path);
+
+    /**
+     * @brief close closes the data file
+     */
+    void close();
+
+    /**
+     * @brief error describes the last failure
+     */
+    QString error() const { return m_error; }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int bands() const { return m_bands; }
+    int bytesPerSample() const { return m_bytes; }
+
+    /**
+     * @brief readTile reads a window as the 8-bit BGR layout of the NDVI
+     * kernel: NIR in R, the visible band in B, G = visible
+     * @param rect window in pixels (clipped to the image)
+     * @param nirBand zero-based NIR band
+     * @param visBand zero-based visible (red) band
+     * @param shift right shift applied to 16-bit samples before clamping to 8 bits
+     * @param bgr receives the CV_8UC3 window
+     * @return false on a read error
+     */
+    bool readTile(const cv::Rect &rect, int nirBand, int visBand, int shift, cv::Mat &bgr);
+
+private:
+    bool readSpan(qint64 sampleIndex, int count, std::vector<uchar> &buf);
+    void convertSpan(const uchar *src, int count, int stride, uchar *dst, int shift) const;
+
+    QFile              m_file;        // data file
+    QString            m_error;
+    int                m_width;       // samples
+    int                m_height;      // lines
+    int                m_bands;
+    int                m_bytes;       // bytes per sample (1 or 2)
+    bool               m_bigEndian;   // byte order = 1
+    qint64             m_offset;      // header offset in bytes
+    Interleave         m_interleave;
+    std::vector<uchar> m_row;         // read scratch
+};
+
+#endif // ENVIRASTER_H
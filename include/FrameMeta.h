@@ -0,0 +1,42 @@
+//------------------------------------------------------------------------------
+// include/FrameMeta.h
+//------------------------------------------------------------------------------
+
+#ifndef FRAMEMETA_H
+#define FRAMEMETA_H
+
+#include <QMetaType>
+#include <QtGlobal>
+#include <chrono>
+
+/**
+ * @brief FrameMeta carries per-frame capture metadata alongside the pixels.
+ */
+struct FrameMeta
+{
+    qint64 sequence    = 0;  // capture sequence number
+    qint64 timestampUs = 0;  // capture time, steady clock microseconds
+    qint64 pairSkewUs  = 0;  // dual rig: |t_rgb - t_nir| of the matched pair
+    qint64 arrivalUs   = 0;  // steady clock time the capture thread emitted the frame
+
+    // Quality gate scores (see FrameQuality), sharpness < 0 if not scored
+    float  sharpness      = -1.0f;  // Laplacian variance of the subsampled luma
+    float  darkFraction   = 0.0f;   // fraction of samples at or below the dark level
+    float  brightFraction = 0.0f;   // fraction of samples at or above the clip level
+    quint8 qualityFlags   = 0;      // FrameQuality::Flag bits, 0 = passed
+    bool   keyframe       = false;  // selected by KeyframeSelector
+    bool   throttled      = false;  // raw dump replay: not processed when recorded
+};
+Q_DECLARE_METATYPE(FrameMeta)
+
+/**
+ * @brief steadyMicros returns the monotonic clock in microseconds, the
+ * time base of FrameMeta::timestampUs.
+ */
+inline qint64 steadyMicros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // FRAMEMETA_H
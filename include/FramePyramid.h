@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// include/FramePyramid.h
+//------------------------------------------------------------------------------
+
+#ifndef FRAMEPYRAMID_H
+#define FRAMEPYRAMID_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief The FramePyramid class holds the grey image pyramid of the frame
+ * being processed, shared by every stage that needs luminance.
+ *
+ * Levels are built on demand with pyrDown, so a frame only pays for the
+ * levels some stage actually reads, and the buffers are reused between
+ * frames of the same size.
+ */
+class FramePyramid
+{
+public:
+    static constexpr int MAX_LEVELS = 6;
+
+    /**
+     * @brief FramePyramid constructor, starts empty
+     */
+    FramePyramid();
+
+    /**
+     * @brief reset points the pyramid at a new frame and drops built levels
+     * @param bgr 8-bit BGR frame (referenced, not copied)
+     */
+    void reset(const cv::Mat &bgr);
+
+    /**
+     * @brief level returns grey level i (0 = full resolution), building it
+     * and any missing finer levels first
+     */
+    const cv::Mat &level(int i);
+
+    /**
+     * @brief levelSize returns the size of level i without building it
+     */
+    cv::Size levelSize(int i) const;
+
+    /**
+     * @brief size returns the full-resolution frame size
+     */
+    cv::Size size() const { return m_source.size(); }
+
+    /**
+     * @brief empty returns true before the first reset
+     */
+    bool empty() const { return m_source.empty(); }
+
+private:
+    cv::Mat              m_source;  // BGR frame of the current pyramid
+    std::vector<cv::Mat> m_levels;  // grey levels, reused between frames
+    int                  m_built;   // number of valid levels
+};
+
+#endif // FRAMEPYRAMID_H
@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------------
+// include/FrameQuality.h
+//------------------------------------------------------------------------------
+
+#ifndef FRAMEQUALITY_H
+#define FRAMEQUALITY_H
+
+#include <opencv2/opencv.hpp>
+#include "FrameMeta.h"
+
+/**
+ * @brief The FrameQuality class scores sharpness and exposure of a raw frame
+ * so that blurred or badly exposed frames can be dropped or flagged before
+ * the NDVI pass.
+ *
+ * Only every 4th pixel of every 4th row is read. Luma is approximated as
+ * (B + 2G + R) / 4; sharpness is the variance of the 4-neighbour Laplacian
+ * over that grid, exposure the fraction of samples in the dark and clipped
+ * histogram tails. Blur is judged relative to a running mean of the
+ * sharpness of passed frames, so the gate adapts to the scene's texture;
+ * a long run of blurred frames re-seeds the mean from the current frame,
+ * so a cut to a less textured scene does not block the gate for good.
+ */
+class FrameQuality
+{
+public:
+    enum Mode
+    {
+        Off,   // no scoring
+        Flag,  // score and tag, keep processing
+        Drop   // score and skip failing frames
+    };
+
+    enum Flag : quint8
+    {
+        QUALITY_BLUR   = 1,  // sharpness below blurRatio * running mean
+        QUALITY_DARK   = 2,  // too many samples in the dark tail
+        QUALITY_BRIGHT = 4   // too many clipped samples
+    };
+
+    /**
+     * @brief FrameQuality constructor, starts disabled
+     */
+    FrameQuality();
+
+    /**
+     * @brief setMode selects the gate behaviour and resets the sharpness mean
+     */
+    void setMode(Mode mode);
+
+    /**
+     * @brief mode returns the gate behaviour
+     */
+    Mode mode() const { return m_mode; }
+
+    /**
+     * @brief setBlurRatio sets the fraction of the running sharpness mean
+     * below which a frame counts as blurred
+     */
+    void setBlurRatio(float ratio);
+    float blurRatio() const { return m_blurRatio; }
+
+    /**
+     * @brief setMaxDark sets the largest allowed fraction of dark samples
+     */
+    void setMaxDark(float fraction);
+    float maxDark() const { return m_maxDark; }
+
+    /**
+     * @brief setMaxBright sets the largest allowed fraction of clipped samples
+     */
+    void setMaxBright(float fraction);
+    float maxBright() const { return m_maxBright; }
+
+    /**
+     * @brief reset forgets the running sharpness mean
+     */
+    void reset();
+
+    /**
+     * @brief assess scores a frame and records the result in meta
+     * @param bgr 8-bit BGR frame
+     * @param meta receives sharpness, exposure fractions and flags
+     * @return true if the frame passes (always true when Off)
+     */
+    bool assess(const cv::Mat &bgr, FrameMeta &meta);
+
+private:
+    Mode  m_mode;
+    float m_blurRatio;     // blur threshold relative to the running mean
+    float m_maxDark;       // dark tail limit
+    float m_maxBright;     // clipped tail limit
+    float m_meanSharp;     // running mean of passed-frame sharpness, < 0 = none
+    int   m_blurRun;       // consecutive frames flagged blurred
+    cv::Mat m_luma;        // subsampled luma grid
+};
+
+#endif // FRAMEQUALITY_H
@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+// include/FrameSource.h
+//------------------------------------------------------------------------------
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QJsonObject>
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include "FrameMeta.h"
+
+/**
+ * @brief The FrameSource class is a non-camera input for CaptureThread:
+ * recordings, dumps or generated scenes fed through the same pipeline.
+ *
+ * read() fills the recorded metadata: sequence and timestampUs on the
+ * source's own clock, which CaptureThread uses to pace real-time replay.
+ */
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    /**
+     * @brief open prepares the source
+     * @return false on failure, with error() set
+     */
+    virtual bool open() = 0;
+
+    /**
+     * @brief read returns the next frame
+     * @return false at the end of the source
+     */
+    virtual bool read(cv::Mat &frame, FrameMeta &meta) = 0;
+
+    /**
+     * @brief readDual returns the next frame and, for a dual-rig source,
+     * its NIR frame (left empty otherwise)
+     * @return false at the end of the source
+     */
+    virtual bool readDual(cv::Mat &rgb, cv::Mat &nir, FrameMeta &meta)
+    {
+        nir.release();
+        return read(rgb, meta);
+    }
+
+    /**
+     * @brief takeParams returns a pipeline parameter snapshot recorded
+     * ahead of the frame just read, once
+     * @return false if there is none
+     */
+    virtual bool takeParams(QJsonObject &params) { Q_UNUSED(params); return false; }
+
+    /**
+     * @brief rewind restarts the source from its first frame
+     * @return false if the source cannot restart
+     */
+    virtual bool rewind() = 0;
+
+    /**
+     * @brief frameRate returns the nominal rate (frames/s), 0 if unknown
+     */
+    virtual double frameRate() const { return 0.0; }
+
+    /**
+     * @brief description names the source for the log
+     */
+    virtual QString description() const = 0;
+
+    /**
+     * @brief error describes the last failure
+     */
+    QString error() const { return m_error; }
+
+protected:
+    QString m_error;
+};
+
+#endif // FRAMESOURCE_H
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+// include/GeometryRemap.h
+//------------------------------------------------------------------------------
+
+#ifndef GEOMETRYREMAP_H
+#define GEOMETRYREMAP_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+/**
+ * @brief The GeometryRemap class applies lens undistortion, digital zoom and
+ * pan to a frame as a single fixed-point remap.
+ *
+ * The remap table is cached and only rebuilt when the frame size, zoom,
+ * pan or intrinsics change.
+ */
+class GeometryRemap
+{
+public:
+    /**
+     * @brief GeometryRemap constructor, starts without intrinsics
+     */
+    GeometryRemap();
+
+    /**
+     * @brief loadIntrinsics reads camera intrinsics from an OpenCV YAML/XML file
+     * with "camera_matrix", "distortion_coefficients" and optionally
+     * "image_width"/"image_height" (the calibration resolution)
+     * @param path file to read
+     * @return true if a valid camera matrix was loaded
+     */
+    bool loadIntrinsics(const std::string &path);
+
+    /**
+     * @brief setIntrinsics sets the intrinsics directly (a raw dump replay)
+     * @param cameraMatrix 3x3 camera matrix
+     * @param distCoeffs distortion coefficients, empty for none
+     * @param calibSize calibration resolution, empty if unknown
+     * @return false if the camera matrix is not 3x3; nothing changes then
+     */
+    bool setIntrinsics(const cv::Mat &cameraMatrix, const cv::Mat &distCoeffs,
+                       const cv::Size &calibSize);
+
+    /**
+     * @brief clearIntrinsics drops the intrinsics, leaving zoom/pan only
+     */
+    void clearIntrinsics();
+
+    /**
+     * @brief hasIntrinsics returns true once intrinsics are loaded
+     */
+    bool hasIntrinsics() const { return !m_cameraMatrix.empty(); }
+
+    const cv::Mat &cameraMatrix() const { return m_cameraMatrix; }
+    const cv::Mat &distCoeffs() const { return m_distCoeffs; }
+    cv::Size calibSize() const { return m_calibSize; }
+
+    /**
+     * @brief setUndistort enables or disables lens undistortion
+     */
+    void setUndistort(bool enabled);
+
+    /**
+     * @brief apply resamples src into dst with undistortion, zoom and pan
+     * @param src input frame
+     * @param dst output frame, same size as src
+     * @param zoom zoom factor (>= 1)
+     * @param panX horizontal pan in [-1, 1] of the available travel
+     * @param panY vertical pan in [-1, 1] of the available travel
+     */
+    void apply(const cv::Mat &src, cv::Mat &dst, double zoom, double panX, double panY);
+
+    /**
+     * @brief viewTransform returns the distortion-free output→source pixel
+     * transform for a zoom/pan setting (the map used without intrinsics)
+     * @param size frame size
+     * @param zoom zoom factor (>= 1)
+     * @param panX horizontal pan in [-1, 1]
+     * @param panY vertical pan in [-1, 1]
+     */
+    static cv::Matx33d viewTransform(const cv::Size &size, double zoom, double panX, double panY);
+
+private:
+    void rebuild(const cv::Size &size, double zoom, double panX, double panY);
+
+    cv::Mat  m_cameraMatrix;  // 3x3 CV_64F intrinsics at m_calibSize
+    cv::Mat  m_distCoeffs;    // distortion coefficients
+    cv::Size m_calibSize;     // resolution the intrinsics were estimated at
+    bool     m_undistort;     // apply distortion model when intrinsics exist
+
+    cv::Mat  m_map1;          // CV_16SC2 integer source coordinates
+    cv::Mat  m_map2;          // CV_16UC1 interpolation table indices
+    cv::Size m_mapSize;       // frame size the maps were built for
+    double   m_mapZoom;       // zoom the maps were built for
+    double   m_mapPanX;       // pan the maps were built for
+    double   m_mapPanY;
+    bool     m_mapUndistort;  // undistortion state the maps were built for
+    bool     m_dirty;         // intrinsics changed since last build
+};
+
+#endif // GEOMETRYREMAP_H
@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+// include/GuidedFilter.h
+//------------------------------------------------------------------------------
+
+#ifndef GUIDEDFILTER_H
+#define GUIDEDFILTER_H
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief The GuidedFilter class smooths the float NDVI plane while keeping
+ * the edges present in a guide image (the raw luminance).
+ *
+ * Every mean in the guided filter is a box filter computed with running
+ * sums (a row pass, then a column pass over vertical strips), so the cost
+ * per pixel does not depend on the radius. All passes run multithreaded,
+ * and the intermediate planes are kept between frames.
+ *
+ * With a validity mask the means become normalised convolutions over the
+ * valid pixels only, so masked or unregistered NDVI never leaks into its
+ * neighbours; masked pixels are left as they were.
+ */
+class GuidedFilter
+{
+public:
+    /**
+     * @brief GuidedFilter constructor
+     * @param radius box radius in pixels
+     * @param eps regularisation (guide variance units, guide in [0, 1])
+     */
+    explicit GuidedFilter(int radius = 8, float eps = 1e-3f);
+
+    /**
+     * @brief setRadius sets the box radius in pixels
+     */
+    void setRadius(int radius);
+    int radius() const { return m_radius; }
+
+    /**
+     * @brief setEps sets the edge-preservation regularisation
+     */
+    void setEps(float eps);
+    float eps() const { return m_eps; }
+
+    /**
+     * @brief apply filters the NDVI plane in place
+     * @param guide 8-bit BGR frame the NDVI was computed from, or its grey
+     *        level (e.g. FramePyramid level 0)
+     * @param ndvi CV_32F NDVI plane, replaced by the filtered plane
+     * @param mask optional validity flags (CV_8U, 0 = valid)
+     */
+    void apply(const cv::Mat &guide, cv::Mat &ndvi, const cv::Mat &mask = cv::Mat());
+
+    /**
+     * @brief boxFilter computes the normalised box mean with running sums;
+     * the window is clipped at the borders
+     * @param src CV_32F input plane
+     * @param dst CV_32F output plane (must not alias src)
+     * @param radius box radius in pixels
+     * @param tmp CV_32F scratch plane
+     */
+    static void boxFilter(const cv::Mat &src, cv::Mat &dst, int radius, cv::Mat &tmp);
+
+private:
+    void applyMasked(cv::Mat &ndvi, const cv::Mat &mask);
+
+    int     m_radius;  // box radius
+    float   m_eps;     // regularisation
+    cv::Mat m_I;       // guide luminance, [0, 1]
+    cv::Mat m_meanI, m_meanP, m_corrI, m_corrIP;
+    cv::Mat m_a, m_b, m_meanA, m_meanB;
+    cv::Mat m_prod;    // product scratch plane
+    cv::Mat m_tmp;     // box filter scratch plane
+    cv::Mat m_W, m_meanW, m_meanWk;  // masked: validity and its window means
+};
+
+#endif // GUIDEDFILTER_H
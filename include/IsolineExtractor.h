@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// include/IsolineExtractor.h
+//------------------------------------------------------------------------------
+
+#ifndef ISOLINEEXTRACTOR_H
+#define ISOLINEEXTRACTOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief Isoline is one NDVI contour polyline in full-resolution pixels.
+ */
+struct Isoline
+{
+    float                    level;   // NDVI level of the contour
+    std::vector<cv::Point2f> points;  // polyline vertices
+    bool                     closed;  // true if the polyline is a loop
+};
+
+/**
+ * @brief The IsolineExtractor class extracts NDVI contour lines at several
+ * levels with a single parallel marching-squares sweep over a downsampled
+ * NDVI plane.
+ *
+ * Each row stripe of cells emits segments for every level at once; the
+ * segment ends are keyed by the cell edge they lie on, which is then used
+ * to join the segments of each level into polylines. Cells touching a
+ * masked pixel emit nothing, so lines end at invalid regions instead of
+ * tracing them.
+ */
+class IsolineExtractor
+{
+public:
+    /**
+     * @brief IsolineExtractor constructor
+     * @param downsample integer downsampling factor applied before the sweep
+     */
+    explicit IsolineExtractor(int downsample = 4);
+
+    /**
+     * @brief setLevels sets the NDVI levels to extract
+     */
+    void setLevels(const std::vector<float> &levels);
+
+    /**
+     * @brief levels returns the NDVI levels extracted
+     */
+    const std::vector<float> &levels() const { return m_levels; }
+
+    /**
+     * @brief setDownsample sets the downsampling factor (>= 1)
+     */
+    void setDownsample(int factor);
+    int downsample() const { return m_downsample; }
+
+    /**
+     * @brief extract computes the contour polylines of all levels
+     * @param ndvi CV_32F NDVI plane
+     * @param mask optional validity flags (CV_8U, 0 = valid)
+     * @return polylines in ndvi pixel coordinates
+     */
+    std::vector<Isoline> extract(const cv::Mat &ndvi, const cv::Mat &mask = cv::Mat());
+
+private:
+    std::vector<float> m_levels;      // NDVI levels
+    int                m_downsample;  // downsampling factor
+    cv::Mat            m_small;       // downsampled NDVI plane
+    cv::Mat            m_smallMask;   // downsampled mask, nonzero = any pixel masked
+};
+
+#endif // ISOLINEEXTRACTOR_H
@@ -0,0 +1,122 @@
+//------------------------------------------------------------------------------
+// include/KeyframeSelector.h
+//------------------------------------------------------------------------------
+
+#ifndef KEYFRAMESELECTOR_H
+#define KEYFRAMESELECTOR_H
+
+#include <QtGlobal>
+#include <opencv2/opencv.hpp>
+#include "FramePyramid.h"
+
+/**
+ * @brief The KeyframeSelector class picks the frames worth keeping on a
+ * mapping run: one each time the view has moved far enough that the
+ * overlap with the last keyframe drops to the configured fraction.
+ *
+ * The shift between consecutive frames is measured with Hanning-windowed
+ * phase correlation on the first pyramid level narrower than about twice
+ * the working width, and summed since the last keyframe. A correlation
+ * peak too weak to trust means the scene changed more than can be
+ * measured, and the frame is taken as a keyframe; its keyShift() then
+ * misses the unmeasured motion and keyTrusted() reports false.
+ */
+class KeyframeSelector
+{
+public:
+    /**
+     * @brief KeyframeSelector constructor
+     * @param overlap overlap fraction with the last keyframe that triggers a new one
+     * @param workWidth approximate width of the correlated frames
+     */
+    explicit KeyframeSelector(float overlap = 0.7f, int workWidth = 128);
+
+    /**
+     * @brief setOverlap sets the overlap fraction in [0, 0.95]
+     */
+    void setOverlap(float overlap);
+
+    /**
+     * @brief overlap returns the overlap fraction
+     */
+    float overlap() const { return m_overlap; }
+
+    /**
+     * @brief setMinResponse sets the phase correlation peak below which the
+     * shift is not trusted
+     */
+    void setMinResponse(double response);
+
+    /**
+     * @brief reset forgets the previous frame; the next one is a keyframe
+     */
+    void reset();
+
+    /**
+     * @brief update measures the shift to the previous frame
+     * @param pyramid grey pyramid of the current frame
+     * @param eligible false to track motion without declaring a keyframe
+     * @return true if this frame is a keyframe
+     */
+    bool update(FramePyramid &pyramid, bool eligible = true);
+
+    /**
+     * @brief displacement returns the motion since the last keyframe, in
+     * full-resolution pixels
+     */
+    cv::Point2d displacement() const { return m_accum; }
+
+    /**
+     * @brief keyShift returns the displacement between the last two
+     * keyframes, full resolution
+     */
+    cv::Point2d keyShift() const { return m_keyShift; }
+
+    /**
+     * @brief keyTrusted returns false if the motion leading to the last
+     * keyframe was not fully measured (weak peak or new geometry), so
+     * keyShift() does not place it relative to the one before
+     */
+    bool keyTrusted() const { return m_keyTrusted; }
+
+    /**
+     * @brief lastShift returns the last inter-frame shift, full resolution
+     */
+    cv::Point2d lastShift() const { return m_shift; }
+
+    /**
+     * @brief response returns the last phase correlation peak
+     */
+    double response() const { return m_response; }
+
+    /**
+     * @brief frames returns the frames seen since reset
+     */
+    qint64 frames() const { return m_frames; }
+
+    /**
+     * @brief keyframes returns the keyframes selected since reset
+     */
+    qint64 keyframes() const { return m_keyframes; }
+
+private:
+    float       m_overlap;      // overlap fraction that triggers a keyframe
+    int         m_workWidth;    // target correlation width
+    double      m_minResponse;  // trusted peak threshold
+    int         m_level;        // pyramid level correlated
+    cv::Size    m_frameSize;    // full-resolution size of m_prev
+    cv::Mat     m_prev;         // previous correlated frame, CV_32F
+    cv::Mat     m_curr;         // current correlated frame, CV_32F
+    cv::Mat     m_window;       // Hanning window
+    cv::Point2d m_accum;        // displacement since the last keyframe
+    cv::Point2d m_keyShift;     // displacement between the last two keyframes
+    cv::Point2d m_shift;        // last inter-frame shift
+    double      m_response;     // last peak value
+    bool        m_pending;      // a keyframe is due once eligible
+    bool        m_lost;         // motion went unmeasured since the last keyframe
+    bool        m_keyTrusted;   // keyShift covers all motion to the last keyframe
+    qint64      m_frames;
+    qint64      m_keyframes;
+};
+
+#endif // KEYFRAMESELECTOR_H
@@ -0,0 +1,156 @@
+//------------------------------------------------------------------------------
+// include/LatencyProbe.h
+//------------------------------------------------------------------------------
+
+#ifndef LATENCYPROBE_H
+#define LATENCYPROBE_H
+
+#include <QString>
+#include <QStringList>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "FrameMeta.h"
+
+/**
+ * @brief The LatencyProbe class measures glass-to-glass latency: from an
+ * event in front of the lens to the NDVI view (and the recording) showing
+ * the frame that saw it, with a timestamp at every pipeline stage.
+ *
+ * Two event sources:
+ * - Flash: the GUI turns an on-screen marker bright and calls flash(); the
+ *   first incoming frame whose region brightness rises past the midpoint
+ *   of its recent range has seen it.
+ * - Stamp: the frame carries its generation time as a pixel code written
+ *   by stamp() (SyntheticSource with SceneParams::stamp), read back from
+ *   each incoming frame.
+ *
+ * inspect() runs on every incoming frame before throttling; the next
+ * processed frame after an event is traced: beginFrame(), mark() after
+ * each stage, endFrame().
+ */
+class LatencyProbe
+{
+public:
+    enum Mode { Off, Flash, Stamp };
+
+    enum Mark {
+        Event,     // flash or stamp time
+        Capture,   // frame left the capture thread
+        Receive,   // processFrame entry
+        Remap,
+        Index,
+        Refine,    // temporal/guided and re-colour, when enabled
+        Overlay,   // blend and overlays
+        Scale,
+        Paint,     // processed view holds the frame
+        Encode,    // recording written, when recording
+        MARK_COUNT
+    };
+
+    /**
+     * @brief LatencyProbe constructor
+     */
+    LatencyProbe();
+
+    /**
+     * @brief start clears the samples and starts measuring
+     */
+    void start(Mode mode);
+
+    /**
+     * @brief stop stops measuring; the samples stay for report()
+     */
+    void stop();
+
+    Mode mode() const { return m_mode; }
+
+    /**
+     * @brief flash records that the marker has just turned bright
+     */
+    void flash(qint64 tUs);
+
+    /**
+     * @brief unflash records that the marker turned dark; an undetected
+     * flash counts as missed
+     */
+    void unflash();
+
+    /**
+     * @brief inspect looks for the event in an incoming frame
+     * @param frame incoming BGR frame
+     * @param region flash detection region of frame
+     */
+    void inspect(const cv::Mat &frame, const cv::Rect &region);
+
+    /**
+     * @brief beginFrame starts tracing a processed frame if an event is pending
+     */
+    void beginFrame(const FrameMeta &meta);
+
+    /**
+     * @brief mark timestamps a stage of the traced frame
+     */
+    void mark(Mark m)
+    {
+        if (m_active) {
+            m_marks[m] = steadyMicros();
+        }
+    }
+
+    /**
+     * @brief endFrame stores the traced frame
+     */
+    void endFrame();
+
+    qint64 samples() const { return qint64(m_records.size()); }
+    qint64 missed() const { return m_missed; }
+
+    /**
+     * @brief report formats the latency distributions and the median of
+     * each stage-to-stage segment
+     */
+    QStringList report() const;
+
+    /**
+     * @brief writeCsv writes one row per traced frame, marks in microseconds
+     * after the event
+     * @return false if the file cannot be written
+     */
+    bool writeCsv(const QString &path) const;
+
+    /**
+     * @brief stamp writes a 32-bit value as a row of black and white cells
+     * (value bits, then an XOR check byte) along the top of a BGR frame
+     * @return false if the frame is too narrow
+     */
+    static bool stamp(cv::Mat &frame, quint32 value);
+
+    /**
+     * @brief readStamp decodes a stamp() code
+     * @return false if there is no valid code
+     */
+    static bool readStamp(const cv::Mat &frame, quint32 &value);
+
+    static const char *name(Mark m);
+
+private:
+    struct Record
+    {
+        qint64 sequence;
+        qint64 marks[MARK_COUNT];
+    };
+
+    Mode   m_mode;
+    bool   m_active;             // tracing the current frame
+    qint64 m_marks[MARK_COUNT];  // marks of the current frame, -1 = not reached
+    qint64 m_pendingEventUs;     // detected event awaiting a processed frame
+    qint64 m_receiveUs;          // entry time of the current frame
+    qint64 m_flashUs;            // undetected flash, -1 = none
+    std::vector<float> m_luma;   // recent region brightness
+    size_t m_lumaNext;
+    float  m_lastLuma;
+    qint64 m_missed;
+    std::vector<Record> m_records;
+};
+
+#endif // LATENCYPROBE_H
@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+// include/MosaicCanvas.h
+//------------------------------------------------------------------------------
+
+#ifndef MOSAICCANVAS_H
+#define MOSAICCANVAS_H
+
+#include <QFile>
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include <list>
+#include <unordered_map>
+
+/**
+ * @brief The MosaicCanvas class blends registered NDVI keyframes into an
+ * unbounded canvas of fixed-size tiles stored in a memory-mapped file.
+ *
+ * Each tile holds, per pixel, the feather-weighted NDVI sum and the weight
+ * sum, so blending is order independent and the mosaic value is their
+ * ratio. Tiles get a slot in the backing file the first time they are
+ * written; only the most recently used ones stay mapped, up to the
+ * resident budget, and the rest are unmapped and left to the page cache.
+ * The canvas can therefore grow far beyond RAM while a viewport is
+ * rendered at display resolution by point sampling the tiles it covers.
+ */
+class MosaicCanvas
+{
+public:
+    static constexpr int TILE = 256;  // tile side in canvas pixels
+
+    /**
+     * @brief MosaicCanvas constructor, starts closed
+     */
+    MosaicCanvas();
+
+    /**
+     * @brief Destructor, unmaps all tiles and closes the backing file
+     */
+    ~MosaicCanvas();
+
+    /**
+     * @brief open creates (truncates) the backing file and empties the canvas
+     * @param path backing file path
+     * @param residentTiles mapped tile budget (512 KiB per tile)
+     * @return false if the file cannot be created
+     */
+    bool open(const QString &path, int residentTiles = 256);
+
+    /**
+     * @brief close unmaps all tiles and closes the backing file
+     */
+    void close();
+
+    /**
+     * @brief isOpen returns true while a backing file is open
+     */
+    bool isOpen() const { return m_file.isOpen(); }
+
+    /**
+     * @brief blend adds an NDVI frame at a canvas position
+     * @param ndvi CV_32F NDVI plane
+     * @param mask CV_8U validity flags (0 = valid); flagged pixels are skipped
+     * @param origin canvas position of the frame's top-left pixel
+     */
+    void blend(const cv::Mat &ndvi, const cv::Mat &mask, const cv::Point &origin);
+
+    /**
+     * @brief render samples a canvas rectangle into an output plane
+     * @param view canvas rectangle to show
+     * @param outSize output size
+     * @param ndvi receives the CV_32F mosaic NDVI
+     * @param mask receives MASK_UNREGISTERED where nothing was blended
+     */
+    void render(const cv::Rect &view, const cv::Size &outSize, cv::Mat &ndvi, cv::Mat &mask);
+
+    /**
+     * @brief bounds returns the canvas rectangle written so far
+     */
+    cv::Rect bounds() const { return m_bounds; }
+
+    /**
+     * @brief tileCount returns the number of tiles in the backing file
+     */
+    qint64 tileCount() const { return m_slots; }
+
+    /**
+     * @brief residentCount returns the number of mapped tiles
+     */
+    int residentCount() const { return int(m_lru.size()); }
+
+private:
+    struct Tile
+    {
+        qint64 slot;                         // tile index in the backing file
+        float *data;                         // mapped (sum, weight) pairs, or null
+        std::list<long long>::iterator lru;  // position in m_lru while mapped
+    };
+
+    float *acquire(int tx, int ty, bool create);
+    void evict();
+    const cv::Mat &feather(const cv::Size &size);
+
+    QFile                           m_file;      // backing store
+    std::unordered_map<long long, Tile> m_tiles; // (tx, ty) → tile
+    std::list<long long>            m_lru;       // mapped tiles, most recent first
+    int                             m_budget;    // resident tile budget
+    qint64                          m_slots;     // tiles allocated in the file
+    qint64                          m_capacity;  // tiles the file is sized for
+    cv::Rect                        m_bounds;    // written canvas area
+    cv::Mat                         m_feather;   // per-pixel blend weight
+};
+
+#endif // MOSAICCANVAS_H
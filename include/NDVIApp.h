@@ -15,8 +15,30 @@
 #include <QSlider>
 #include <QCheckBox>
 #include <QTextEdit>
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QFile>
+#include <QThread>
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include "CaptureThread.h"
+#include "NDVIKernel.h"
+#include "GeometryRemap.h"
+#include "DualRegistration.h"
+#include "TemporalFilter.h"
+#include "Compositor.h"
+#include "GuidedFilter.h"
+#include "IsolineExtractor.h"
+#include "FramePyramid.h"
+#include "RoiTracker.h"
+#include "FrameQuality.h"
+#include "KeyframeSelector.h"
+#include "MosaicCanvas.h"
+#include "TiledBatchProcessor.h"
+#include "SyntheticSource.h"
+#include "RawDumpWriter.h"
+#include "StageProfiler.h"
+#include "LatencyProbe.h"
 
 /**
  * @brief The NDVIApp class defines main window for RAZIEL NDVI Console
@@ -24,6 +46,7 @@
 class NDVIApp : public QWidget
 {
     Q_OBJECT
+    friend struct NDVIAppBench;  // bench/ drives the private frame path
 
 public:
     /**
@@ -47,29 +70,60 @@ protected:
 private slots:
     // UI control slots
     void startCamera();
+    void startReplay();
     void stopCamera();
-    void onFrameReady(const cv::Mat &frame);
+    void onFrameReady(const cv::Mat &frame, const FrameMeta &meta);
+    void onDualFrameReady(const cv::Mat &rgb, const cv::Mat &nir, const FrameMeta &meta);
     void onCaptureStopped();
     void onPreviewTimer();
+    void onProfileTimer();
     void changePalette(const QString &name);
     void takeSnapshot();
     void toggleRecording(bool checked);
+    void toggleRawDump(bool checked);
+    void toggleTrace(bool checked);
+    void toggleLatency(bool checked);
+    void togglePerfCounters(bool checked);
+    void onFlashTimer();
+    void applyPipelineParams(const QJsonObject &params);
     void autoCalibrate();
+    void calibratePanel();
+    void resetPanelCalibration();
     void chooseCrossColor();
     void chooseRoiColor();
     void onZoomChanged(int value);
+    void loadIntrinsics();
+    void registerDual();
+    void changeTemporalMode(int index);
+    void changeGateMode(int index);
+    void changeCompositeMode(int index);
+    void exportComposite();
+    void toggleContourStream(bool checked);
+    void toggleKeyframeMode(bool checked);
+    void toggleMosaic(bool checked);
+    void processOrthomosaic();
     void logMessage(const QString &msg);
 
 private:
     // Setup and helper methods
     void setupUI();
+    void startCapture(CaptureThread *thread);
+    QJsonObject pipelineParams() const;
+    void resetPipelineState();
     void applyStyle();
     void restoreSettings();
     void saveSettings();
-    cv::Mat makeLUT(const QColor &c1, const QColor &c2, const QColor &c3);
-    cv::Mat computeNDVI(const cv::Mat &frame, float vmin, float vmax, const cv::Mat &lut, cv::Mat &ndviOut);
-    void updatePreview(float vmin, float vmax, const cv::Mat &ndvi);
-    void drawOverlay(cv::Mat &img, const cv::Mat &ndvi);
+    void processFrame(const cv::Mat &frame, const cv::Mat &nir, const FrameMeta &meta);
+    cv::Mat computeNDVI(const cv::Mat &frame, const cv::Mat &nir, float vmin, float vmax,
+                        const cv::Mat &lut, cv::Mat &ndviOut, cv::Mat &maskOut, NDVIStats &stats);
+    void updatePreview(float vmin, float vmax, const cv::Mat &ndvi, const cv::Mat &mask);
+    void drawOverlay(cv::Mat &img, const cv::Mat &ndvi, const cv::Mat &mask, const NDVIStats &stats);
+    void writeContours(const FrameMeta &meta);
+    void renderMosaic(const cv::Size &frameSize, const cv::Size &outSize, cv::Mat &display);
+    cv::Rect roiRect(const cv::Size &size) const;
+    cv::Rect sliderRoiRect(const cv::Size &size) const;
+    void updateRoiTracking();
+    static QString qualityTag(quint8 flags);
     void setPixmap(QLabel *label, const cv::Mat &bgr);
     QString timestampedFilename(const QString &prefix, const QString &ext);
 
@@ -77,6 +131,11 @@ private:
     QLabel      *m_procView;
     QLabel      *m_rawView;
     QComboBox   *m_camBox;
+    QComboBox   *m_nirBox;
+    QPushButton *m_registerBtn;
+    QPushButton *m_replayBtn;
+    QComboBox   *m_pacingBox;
+    QCheckBox   *m_loopChk;
     QPushButton *m_quitBtn;    
     QPushButton *m_startBtn;
     QPushButton *m_abortBtn;
@@ -85,21 +144,47 @@ private:
     QComboBox   *m_paletteBox;
     QPushButton *m_recordBtn;
     QPushButton *m_snapshotBtn;
+    QPushButton *m_dumpBtn;
+    QPushButton *m_traceBtn;
+    QPushButton *m_latencyBtn;
+    QComboBox   *m_compositeBox;
+    QSpinBox    *m_compWindowSpin;
+    QPushButton *m_compExportBtn;
+    QPushButton *m_contourRecBtn;
+    QPushButton *m_keyframeBtn;
+    QPushButton *m_mosaicBtn;
+    QPushButton *m_orthoBtn;
     QSlider     *m_zoomSlider;
     QLabel      *m_zoomLabel;
+    QSlider     *m_panXSlider;
+    QSlider     *m_panYSlider;
+    QCheckBox   *m_undistortChk;
+    QPushButton *m_lensBtn;
     QCheckBox   *m_gridChk;
     QCheckBox   *m_crossChk;
     QPushButton *m_crossColorBtn;
     QCheckBox   *m_telemChk;
+    QCheckBox   *m_hudChk;
+    QCheckBox   *m_perfChk;
     QCheckBox   *m_blendChk;
     QSlider     *m_alphaSlider;
+    QComboBox   *m_temporalBox;
+    QCheckBox   *m_guidedChk;
+    QCheckBox   *m_contourChk;
+    QSpinBox    *m_satSpin;
+    QSpinBox    *m_minSignalSpin;
+    QComboBox   *m_gateBox;
     QCheckBox   *m_roiToggle;
     QPushButton *m_roiColorBtn;
+    QCheckBox   *m_trackChk;
     QSlider     *m_roiLeft;
     QSlider     *m_roiRight;
     QSlider     *m_roiTop;
     QSlider     *m_roiBottom;
     QPushButton *m_autoCalibBtn;
+    QDoubleSpinBox *m_panelSpin;
+    QPushButton *m_panelCalBtn;
+    QPushButton *m_panelResetBtn;
     QLabel      *m_colorbarLabel;
     QLabel      *m_histogramLabel;
     QTextEdit   *m_logView;
@@ -107,16 +192,66 @@ private:
     // Runtime state
     CaptureThread *m_captureThread;
     cv::Mat        m_lut;
-    float          m_lastTime;
-    float          m_fps;
+    double         m_lastTime;    // processing time of the previous frame
+    float          m_fps;         // smoothed processed-frame rate
     QColor         m_crosshairColor;
     QColor         m_roiColor;
     cv::Mat        m_lastNDVI;
+    cv::Mat        m_lastFrame;   // raw frame behind m_lastNDVI
+    cv::Mat        m_lastNir;     // NIR frame behind m_lastFrame on a dual rig, else empty
+    cv::Mat        m_lastMask;    // validity flags for m_lastNDVI (0 = valid)
+    NDVIKernel     m_kernel;      // fused index/colour kernel with band gains
+    GeometryRemap  m_geometry;    // undistort + zoom + pan remap
+    TemporalFilter m_temporal;    // temporal NDVI denoising
+    Compositor     m_compositor;  // max/median/percentile composites
+    GuidedFilter   m_guided;      // edge-preserving NDVI smoothing
+    IsolineExtractor m_isolines;  // NDVI contour extraction
+    std::vector<Isoline> m_lastIsolines;
+    FramePyramid   m_pyramid;     // grey pyramid of the processed frame
+    RoiTracker     m_tracker;     // template-tracked ROI
+    bool           m_trackSeed;   // re-seed the tracker from the sliders
+    FrameQuality   m_quality;     // blur/exposure gate
+    quint8         m_lastQualityFlags;  // FrameQuality flags of the shown frame
+    qint64         m_droppedFrames;     // frames rejected by the gate
+    qint64         m_dropRun;           // consecutive frames rejected by the gate
+    KeyframeSelector m_keyframes; // overlap-based keyframe selection
+    bool           m_lastKeyframe;      // shown frame was a keyframe
+    MosaicCanvas   m_mosaic;      // tiled, memory-mapped keyframe mosaic
+    cv::Point2d    m_mosaicOrigin;      // canvas position of the last keyframe
+    QString        m_mosaicPath;
+    QThread       *m_orthoThread;  // out-of-core orthomosaic job, null when idle
+    std::shared_ptr<TiledBatchProcessor> m_orthoJob;
+    int            m_orthoTileSize;
+    int            m_orthoNirBand;
+    int            m_orthoVisBand;
+    int            m_orthoShift;
+    QFile          m_contourFile; // GeoJSON-lines contour stream
+    QString        m_intrinsicsPath;
+    DualRegistration m_registration;  // NIR→RGB homography and sample map
+    QString        m_homographyPath;
+    cv::Mat        m_lastRawRgb;   // last unprocessed dual-rig pair
+    cv::Mat        m_lastRawNir;
     cv::VideoWriter m_videoWriter;
+    RawDumpWriter   m_dump;          // raw camera dump for exact replay
+    QJsonObject     m_dumpParams;    // last snapshot written to m_dump
+    bool            m_replayExact;   // raw dump replay: follow recorded throttling
+    LatencyProbe    m_probe;         // glass-to-glass latency measurement
+    QLabel         *m_flashWindow;   // flash marker for the camera, null until used
+    QTimer         *m_flashTimer;
+    bool            m_flashBright;
+    int             m_flashPeriodMs; // mean marker period, jittered ±30%
+    bool            m_feedStamped;   // synthetic feed carries LatencyProbe stamps
 
     QTimer         *m_previewTimer;
-    float           m_processInterval;
-    float           m_lastProcessTime;
+    QTimer         *m_profileTimer;
+    StageProfiler::Snapshot m_profileSnap;     // start of the HUD window
+    StageProfiler::Snapshot m_profileLogSnap;  // start of the log window
+    int             m_profileLogInterval;      // seconds between log dumps, 0 = off
+    std::vector<std::string> m_hudLines;       // profiler HUD text
+    double          m_processInterval;  // s between processed frames, 0 = every frame
+    double          m_lastProcessTime;
+    bool            m_unthrottled;   // process every frame (paced replay, dual rig)
+    SceneParams     m_sceneParams;   // synthetic source scene
     QString         m_settingsPath;
 };
 
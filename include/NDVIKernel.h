@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+// include/NDVIKernel.h
+//------------------------------------------------------------------------------
+
+#ifndef NDVIKERNEL_H
+#define NDVIKERNEL_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief BandGains holds the per-band radiometric gains applied to the
+ * NIR (red channel) and visible (blue channel) digital numbers.
+ */
+struct BandGains
+{
+    float red  = 1.0f;  // gain applied to the R (NIR) channel
+    float blue = 1.0f;  // gain applied to the B (visible) channel
+};
+
+/**
+ * @brief Validity flags written to the kernel mask; 0 means the pixel is valid.
+ */
+enum NDVIMaskFlag : uchar
+{
+    MASK_SATURATED  = 0x01,  // R or B at/above the saturation level
+    MASK_LOW_SIGNAL = 0x02,  // R + B below the minimum signal level
+    MASK_UNREGISTERED = 0x04 // dual rig: no NIR sample maps onto the pixel
+};
+
+/**
+ * @brief NDVIStats accumulates NDVI over valid pixels during the kernel pass.
+ */
+struct NDVIStats
+{
+    double    sum   = 0.0;  // sum of NDVI over valid pixels
+    long long valid = 0;    // number of valid pixels
+    long long total = 0;    // number of processed pixels (64-bit for batch totals)
+
+    double mean() const { return valid > 0 ? sum / valid : 0.0; }
+    double maskedFraction() const { return total > 0 ? 1.0 - double(valid) / total : 0.0; }
+};
+
+/**
+ * @brief The NDVIKernel class computes the NDVI plane and the coloured frame
+ * in a single parallel pass over an 8-bit BGR frame.
+ *
+ * NDVI only depends on the 8-bit (R,B) pair, so the index (with the band
+ * gains folded in) is tabulated once in a 256x256 table, together with the
+ * matching palette index for the current min/max window and the validity
+ * flags for the current saturation/low-signal thresholds.
+ */
+class NDVIKernel
+{
+public:
+    /**
+     * @brief NDVIKernel constructor builds the tables for unit gains
+     */
+    NDVIKernel();
+
+    /**
+     * @brief setGains replaces the band gains and rebuilds the tables
+     * @param gains new per-band gains
+     */
+    void setGains(const BandGains &gains);
+
+    /**
+     * @brief gains returns the band gains currently folded into the tables
+     */
+    const BandGains &gains() const { return m_gains; }
+
+    /**
+     * @brief configure sets the NDVI window mapped onto the palette
+     * @param vmin NDVI value mapped to palette index 0
+     * @param vmax NDVI value mapped to palette index 255
+     */
+    void configure(float vmin, float vmax);
+
+    /**
+     * @brief setMaskThresholds sets the levels used to flag invalid pixels
+     * @param saturation R or B at/above this level is flagged saturated
+     * @param minSignal R + B below this level is flagged low-signal
+     */
+    void setMaskThresholds(int saturation, int minSignal);
+
+    /**
+     * @brief apply runs the fused index + colourise + mask kernel
+     * @param frame 8-bit BGR input frame
+     * @param lut 256x1 CV_8UC3 palette
+     * @param coloured output coloured frame (CV_8UC3)
+     * @param ndviOut output NDVI plane (CV_32F)
+     * @param maskOut output validity flags (CV_8U, 0 = valid)
+     * @param stats optional NDVI statistics over valid pixels
+     */
+    void apply(const cv::Mat &frame, const cv::Mat &lut,
+               cv::Mat &coloured, cv::Mat &ndviOut,
+               cv::Mat &maskOut, NDVIStats *stats = nullptr) const;
+
+    /**
+     * @brief applyDual runs the fused kernel for a dual-camera rig, sampling
+     * the NIR band from a second frame through a precomputed fixed-point map
+     * @param rgb 8-bit BGR frame from the visible camera (visible band = R)
+     * @param nir 8-bit BGR frame from the NIR camera (NIR band = R)
+     * @param nirOffsets CV_32S byte offsets into nir per rgb pixel, -1 outside
+     * @param nirWeights CV_16U packed 8-bit x/y bilinear weights per rgb pixel
+     * @param lut 256x1 CV_8UC3 palette
+     * @param coloured output coloured frame (CV_8UC3)
+     * @param ndviOut output NDVI plane (CV_32F)
+     * @param maskOut output validity flags (CV_8U, 0 = valid)
+     * @param stats optional NDVI statistics over valid pixels
+     */
+    void applyDual(const cv::Mat &rgb, const cv::Mat &nir,
+                   const cv::Mat &nirOffsets, const cv::Mat &nirWeights,
+                   const cv::Mat &lut, cv::Mat &coloured, cv::Mat &ndviOut,
+                   cv::Mat &maskOut, NDVIStats *stats = nullptr) const;
+
+    /**
+     * @brief colourise maps an (already filtered) NDVI plane through the
+     * palette for the current window and recomputes the valid-pixel stats
+     * @param ndvi CV_32F NDVI plane
+     * @param mask validity flags (CV_8U, 0 = valid)
+     * @param lut 256x1 CV_8UC3 palette
+     * @param coloured output coloured frame (CV_8UC3)
+     * @param stats optional NDVI statistics over valid pixels
+     */
+    void colourise(const cv::Mat &ndvi, const cv::Mat &mask, const cv::Mat &lut,
+                   cv::Mat &coloured, NDVIStats *stats = nullptr) const;
+
+    /**
+     * @brief solveGains derives band gains from a reference panel region
+     * @param panel BGR pixels covering the reflectance panel
+     * @param reflectance known panel reflectance (0..1), same in both bands
+     * @param gains receives the solved gains on success
+     * @return false if the panel is too dark or mostly saturated
+     */
+    static bool solveGains(const cv::Mat &panel, float reflectance, BandGains &gains);
+
+    /**
+     * @brief solveGainsDual derives band gains for a dual-camera rig: the
+     * NIR mean from the NIR frame through the registration map, the visible
+     * mean from the RGB frame's R channel (the bands applyDual combines)
+     * @param rgb BGR frame from the visible camera
+     * @param nir BGR frame from the NIR camera
+     * @param nirOffsets registration offsets for rgb, as for applyDual
+     * @param nirWeights registration weights for rgb, as for applyDual
+     * @param roi panel region in rgb pixels
+     * @param reflectance known panel reflectance (0..1)
+     * @param gains receives the solved gains on success
+     * @return false if the panel is too dark, saturated or mostly unregistered
+     */
+    static bool solveGainsDual(const cv::Mat &rgb, const cv::Mat &nir,
+                               const cv::Mat &nirOffsets, const cv::Mat &nirWeights,
+                               const cv::Rect &roi, float reflectance, BandGains &gains);
+
+private:
+    void rebuildTables();
+
+    template <typename BandFetch>
+    void run(const cv::Mat &frame, const cv::Mat &lut, cv::Mat &coloured,
+             cv::Mat &ndviOut, cv::Mat &maskOut, NDVIStats *stats,
+             BandFetch fetch) const;
+
+    BandGains          m_gains;       // gains folded into m_ndviTable
+    float              m_vmin;        // window low edge for m_indexTable
+    float              m_vmax;        // window high edge for m_indexTable
+    int                m_saturation;  // saturation level for m_flagTable
+    int                m_minSignal;   // minimum R + B for m_flagTable
+    std::vector<float> m_ndviTable;   // NDVI indexed by (R << 8) | B
+    std::vector<uchar> m_indexTable;  // palette index indexed by (R << 8) | B
+    std::vector<uchar> m_flagTable;   // NDVIMaskFlag bits indexed by (R << 8) | B
+};
+
+#endif // NDVIKERNEL_H
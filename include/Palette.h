@@ -0,0 +1,33 @@
+//------------------------------------------------------------------------------
+// include/Palette.h
+//------------------------------------------------------------------------------
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <QColor>
+#include <QString>
+#include <QStringList>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief makePaletteLUT builds a 256×1×3 CV_8UC3 lookup table from three colors.
+ * @param c1 colour at index 0
+ * @param c2 colour at index 128
+ * @param c3 colour at index 255
+ */
+cv::Mat makePaletteLUT(const QColor &c1, const QColor &c2, const QColor &c3);
+
+/**
+ * @brief paletteLUT returns a named palette
+ * @param name one of paletteNames()
+ * @return the lookup table, or an empty matrix for an unknown name
+ */
+cv::Mat paletteLUT(const QString &name);
+
+/**
+ * @brief paletteNames lists the named palettes, default first
+ */
+QStringList paletteNames();
+
+#endif // PALETTE_H
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+// include/PerfCounters.h
+//------------------------------------------------------------------------------
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief The PerfCounters class reads hardware performance counters of the
+ * calling thread: cycles, instructions, last-level cache misses and branch
+ * misses, counted in user space only.
+ *
+ * Linux only, through perf_event_open. Every thread opens its own counter
+ * group on its first read() and keeps it until it exits; a read is one
+ * syscall. Enabling also opens the groups of the OpenCV worker threads, so
+ * readWithPool() can count the parallel_for_ work a stage hands to them
+ * (one more syscall per worker). OpenCV runs one parallel job at a time
+ * and a concurrent caller's job serially on that caller, so the worker
+ * counts of a stage belong to it unless another thread's job overlaps.
+ *
+ * Where the kernel refuses (perf_event_paranoid, containers, virtual
+ * machines without a PMU, other platforms) setEnabled() fails with a
+ * reason and read() returns false, so callers fall back to wall-clock
+ * timing. The cache and branch events are optional; events() tells which
+ * ones are counted.
+ */
+class PerfCounters
+{
+public:
+    enum Event { Cycles, Instructions, LlcMisses, BranchMisses, EVENT_COUNT };
+
+    /**
+     * @brief Sample holds running totals of the calling thread.
+     */
+    struct Sample
+    {
+        quint64 value[EVENT_COUNT] = {};
+    };
+
+    /**
+     * @brief setEnabled turns counting on or off, process wide. Turning it
+     * on opens the calling thread's counters to check they work.
+     * @return false if counters are unavailable; see unavailableReason()
+     */
+    static bool setEnabled(bool on);
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief read samples the calling thread's counters, opening them first
+     * if needed; totals are scaled up if the kernel multiplexed the group
+     * @return false if the thread has no counters
+     */
+    static bool read(Sample &sample);
+
+    /**
+     * @brief readWithPool samples the calling thread's counters plus those
+     * of the OpenCV worker threads listed when counting was enabled
+     * @return false if the calling thread has no counters
+     */
+    static bool readWithPool(Sample &sample);
+
+    /**
+     * @brief poolThreads returns the number of OpenCV workers counted by
+     * readWithPool()
+     */
+    static int poolThreads();
+
+    /**
+     * @brief events returns a bit per counted Event
+     */
+    static unsigned events() { return s_events.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief unavailableReason describes why the last open failed
+     */
+    static QString unavailableReason();
+
+    static const char *name(Event event);
+
+private:
+    static inline std::atomic<bool> s_enabled{false};
+    static inline std::atomic<unsigned> s_events{0};
+    static inline std::atomic<int> s_error{0};  // errno of the last failed open
+};
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,43 @@
+//------------------------------------------------------------------------------
+// include/RawDumpSource.h
+//------------------------------------------------------------------------------
+
+#ifndef RAWDUMPSOURCE_H
+#define RAWDUMPSOURCE_H
+
+#include <QFile>
+#include <QJsonObject>
+#include "FrameSource.h"
+
+/**
+ * @brief The RawDumpSource class replays a RawDumpWriter file: the exact
+ * camera frames (and NIR frames of a dual rig) with their recorded
+ * metadata, and the parameter snapshots in the order they were taken.
+ */
+class RawDumpSource : public FrameSource
+{
+public:
+    /**
+     * @brief RawDumpSource constructor
+     * @param path dump file
+     */
+    explicit RawDumpSource(const QString &path);
+
+    bool open() override;
+    bool read(cv::Mat &frame, FrameMeta &meta) override;
+    bool readDual(cv::Mat &rgb, cv::Mat &nir, FrameMeta &meta) override;
+    bool takeParams(QJsonObject &params) override;
+    bool rewind() override;
+    QString description() const override;
+
+private:
+    bool readImage(cv::Mat &img);
+
+    QString     m_path;
+    QFile       m_file;
+    qint64      m_dataStart;  // offset of the first record
+    QJsonObject m_params;     // snapshot read since the last takeParams()
+    bool        m_hasParams;
+};
+
+#endif // RAWDUMPSOURCE_H
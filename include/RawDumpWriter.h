@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+// include/RawDumpWriter.h
+//------------------------------------------------------------------------------
+
+#ifndef RAWDUMPWRITER_H
+#define RAWDUMPWRITER_H
+
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameMeta.h"
+
+/**
+ * @brief Raw dump file layout (native byte order): a DumpFileHeader, then
+ * records of a DumpRecordHeader and its payload. A frame payload is a
+ * DumpFrameHeader followed, per image, by a DumpImageHeader and the packed
+ * pixel rows. A params payload is compact JSON. Zero bytes after the last
+ * record (an unused preallocated extent) read as the end of the file.
+ */
+namespace RawDump {
+
+static constexpr char    MAGIC[8] = { 'R', 'Z', 'D', 'U', 'M', 'P', '0', '1' };
+static constexpr quint32 VERSION  = 1;
+
+enum RecordType : quint32 {
+    RECORD_END    = 0,
+    RECORD_FRAME  = 1,
+    RECORD_PARAMS = 2
+};
+
+enum FrameFlag : quint32 {
+    FRAME_THROTTLED = 0x01  // the session did not process this frame
+};
+
+struct DumpFileHeader {
+    char    magic[8];
+    quint32 version;
+    quint32 reserved;
+};
+
+struct DumpRecordHeader {
+    quint32 type;
+    quint32 reserved;
+    quint64 size;   // payload bytes
+};
+
+struct DumpFrameHeader {
+    qint64  sequence;
+    qint64  timestampUs;
+    qint64  pairSkewUs;
+    quint32 flags;   // FrameFlag bits
+    quint32 images;  // 1, or 2 for an RGB/NIR pair
+};
+
+struct DumpImageHeader {
+    qint32 rows;
+    qint32 cols;
+    qint32 type;     // OpenCV type
+    qint32 reserved;
+};
+
+} // namespace RawDump
+
+/**
+ * @brief The RawDumpWriter class appends camera frames, their metadata and
+ * parameter snapshots to a raw dump for exact replay (see RawDumpSource).
+ *
+ * Producers only queue references to the frames; a dedicated I/O thread
+ * packs the records into a large staging buffer and writes it out in big
+ * sequential writes, reserving the file in preallocated extents so the
+ * filesystem does not fragment it. When more than the queue budget is
+ * waiting, frames are dropped and counted rather than stalling capture.
+ */
+class RawDumpWriter
+{
+public:
+    RawDumpWriter();
+    ~RawDumpWriter();
+
+    /**
+     * @brief open creates the dump and starts the I/O thread
+     * @param path output file
+     * @return false if the file cannot be created
+     */
+    bool open(const QString &path);
+
+    /**
+     * @brief close drains the queue, trims the unused extent and closes
+     */
+    void close();
+
+    /**
+     * @brief isOpen returns true while dumping
+     */
+    bool isOpen() const { return m_thread.joinable(); }
+
+    /**
+     * @brief writeFrame queues a frame (and the NIR frame of a dual rig);
+     * the frames must not be modified afterwards
+     * @param throttled the frame was not processed in this session
+     * @return false if the frame was dropped
+     */
+    bool writeFrame(const cv::Mat &frame, const cv::Mat &nir, const FrameMeta &meta, bool throttled);
+
+    /**
+     * @brief writeParams queues a parameter snapshot, applied from the next frame on
+     */
+    void writeParams(const QJsonObject &params);
+
+    /**
+     * @brief setExtent sets the preallocation step in bytes
+     */
+    void setExtent(qint64 bytes) { m_extent = bytes; }
+
+    /**
+     * @brief setQueueBudget sets the bytes allowed to wait for the I/O thread
+     */
+    void setQueueBudget(qint64 bytes) { m_budget = bytes; }
+
+    qint64 bytesWritten() const { return m_written; }
+    qint64 framesWritten() const { return m_frames; }
+    qint64 dropped() const { return m_dropped; }
+    QString error() const;
+
+private:
+    struct Record
+    {
+        quint32    type = RawDump::RECORD_END;
+        QByteArray head;  // DumpFrameHeader or JSON
+        cv::Mat    images[2];
+        qint64     bytes = 0;
+    };
+
+    void ioLoop();
+    void pack(const Record &record);
+    void append(const void *data, size_t size);
+    void flush();
+    void reserve(qint64 end);
+
+    QFile                   m_file;
+    std::thread             m_thread;
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_ready;
+    std::deque<Record>      m_queue;
+    qint64                  m_queued;     // bytes waiting in m_queue
+    qint64                  m_budget;
+    bool                    m_stop;
+    std::vector<char>       m_staging;    // I/O thread only
+    size_t                  m_fill;
+    qint64                  m_extent;
+    qint64                  m_allocated;  // bytes reserved on disk
+    std::atomic<qint64>     m_written;
+    std::atomic<qint64>     m_frames;
+    std::atomic<qint64>     m_dropped;
+    QString                 m_error;
+};
+
+#endif // RAWDUMPWRITER_H
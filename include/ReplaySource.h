@@ -0,0 +1,42 @@
+//------------------------------------------------------------------------------
+// include/ReplaySource.h
+//------------------------------------------------------------------------------
+
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QStringList>
+#include "FrameSource.h"
+
+/**
+ * @brief The ReplaySource class plays a video file or an image sequence
+ * (a directory of frames in name order) as a FrameSource.
+ *
+ * Video timestamps come from the container (CAP_PROP_POS_MSEC); image
+ * sequences are stamped at the nominal frame rate.
+ */
+class ReplaySource : public FrameSource
+{
+public:
+    /**
+     * @brief ReplaySource constructor
+     * @param path video file or image directory
+     * @param frameRate rate assumed for image sequences and streams without one
+     */
+    explicit ReplaySource(const QString &path, double frameRate = 30.0);
+
+    bool open() override;
+    bool read(cv::Mat &frame, FrameMeta &meta) override;
+    bool rewind() override;
+    double frameRate() const override { return m_frameRate; }
+    QString description() const override;
+
+private:
+    QString          m_path;
+    double           m_frameRate;
+    QStringList      m_images;   // image sequence, empty for video
+    cv::VideoCapture m_video;
+    qint64           m_next;     // index of the next frame
+};
+
+#endif // REPLAYSOURCE_H
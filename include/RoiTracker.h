@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------------
+// include/RoiTracker.h
+//------------------------------------------------------------------------------
+
+#ifndef ROITRACKER_H
+#define ROITRACKER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "FramePyramid.h"
+
+/**
+ * @brief The RoiTracker class follows a rectangular ROI from frame to frame
+ * by template matching on the shared grey pyramid.
+ *
+ * The template is cut from the seed frame at a few pyramid levels. Each
+ * update searches a window around the previous position with normalised
+ * cross-correlation at the coarsest level, then refines the match by a
+ * couple of pixels per finer level. The finest level used is the one where
+ * the template is at most 64 pixels across, which bounds the cost whatever
+ * the ROI size. A match below the score threshold marks the track lost;
+ * the box is held and the next search window is doubled.
+ */
+class RoiTracker
+{
+public:
+    /**
+     * @brief RoiTracker constructor
+     * @param searchRadius search half-window in full-resolution pixels
+     */
+    explicit RoiTracker(int searchRadius = 32);
+
+    /**
+     * @brief setSearchRadius sets the search half-window in pixels
+     */
+    void setSearchRadius(int radius);
+    int searchRadius() const { return m_radius; }
+
+    /**
+     * @brief setMinScore sets the NCC score below which the track is lost
+     */
+    void setMinScore(float score);
+    float minScore() const { return m_minScore; }
+
+    /**
+     * @brief start seeds the tracker with a box in the pyramid's frame
+     * @return false if the box is too small to track
+     */
+    bool start(FramePyramid &pyramid, const cv::Rect &roi);
+
+    /**
+     * @brief update searches for the box in a new frame
+     * @return true if the box was found; false if lost or not tracking
+     */
+    bool update(FramePyramid &pyramid);
+
+    /**
+     * @brief stop drops the template
+     */
+    void stop();
+
+    /**
+     * @brief isTracking returns true while a template is held
+     */
+    bool isTracking() const { return m_tracking; }
+
+    /**
+     * @brief isLost returns true if the last update found no match
+     */
+    bool isLost() const { return m_lost; }
+
+    /**
+     * @brief rect returns the tracked box in full-resolution pixels
+     */
+    cv::Rect rect() const;
+
+    /**
+     * @brief frameSize returns the frame size the box refers to
+     */
+    cv::Size frameSize() const { return m_frameSize; }
+
+    /**
+     * @brief score returns the NCC score of the last update
+     */
+    float score() const { return m_score; }
+
+private:
+    bool match(const cv::Mat &image, const cv::Mat &templ, cv::Point &tl,
+               int radius, float &score, cv::Point2f *subpixel);
+
+    std::vector<cv::Mat> m_templates;  // template per level, index = level
+    int         m_fine;        // finest level searched
+    int         m_coarse;      // coarsest level searched
+    cv::Point2f m_pos;         // box top-left, full resolution
+    cv::Size    m_roiSize;     // box size, full resolution
+    cv::Size    m_frameSize;   // frame the box refers to
+    int         m_radius;      // search half-window, full resolution
+    float       m_minScore;    // lost threshold
+    float       m_score;       // last NCC score
+    bool        m_tracking;
+    bool        m_lost;
+    cv::Mat     m_response;    // matchTemplate scratch
+};
+
+#endif // ROITRACKER_H
@@ -0,0 +1,217 @@
+//------------------------------------------------------------------------------
+// include/StageProfiler.h
+//------------------------------------------------------------------------------
+
+#ifndef STAGEPROFILER_H
+#define STAGEPROFILER_H
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <chrono>
+#include <vector>
+#include "PerfCounters.h"
+#include "TraceRecorder.h"
+
+/**
+ * @brief StageStats summarises one stage over a snapshot window.
+ */
+struct StageStats
+{
+    quint64 count  = 0;    // samples in the window
+    double  meanUs = 0.0;
+    double  p50Us  = 0.0;
+    double  p95Us  = 0.0;
+    double  p99Us  = 0.0;
+    double  maxUs  = 0.0;  // upper edge of the highest occupied bucket
+    double  fps    = 0.0;  // samples per second of window
+
+    // Hardware counters (PerfCounters), < 0 where not counted
+    quint64 counted     = 0;     // samples with counters
+    double  ipc         = -1.0;  // instructions per cycle
+    double  cyclesPerPx = -1.0;
+    double  llcPerPx    = -1.0;  // last-level cache misses per pixel
+    double  branchPerPx = -1.0;  // branch misses per pixel
+};
+
+/**
+ * @brief The StageProfiler class keeps a latency histogram per pipeline
+ * stage, process wide.
+ *
+ * Every thread records into its own block of log-linear (HDR-style)
+ * histograms: 16 sub-buckets per power of two of nanoseconds, so any
+ * reported percentile is within 1/16 of the true value from 1 ns up to
+ * about 18 minutes. Only the owning thread writes a block, with relaxed
+ * atomic stores and no read-modify-write, so recording is a clock read and
+ * two stores. Readers sum the blocks into a Snapshot; counts only ever
+ * grow, and the difference of two snapshots gives the stats of the window
+ * between them. Blocks of exited threads are recycled with their counts.
+ *
+ * While PerfCounters is enabled, StageTimer also adds the counter deltas
+ * of the thread and the OpenCV workers (PerfCounters::readWithPool) and
+ * the pixels it processed to the stage, giving IPC and misses per pixel
+ * alongside the latencies.
+ */
+class StageProfiler
+{
+public:
+    enum Stage {
+        Capture,    // camera grab or source read
+        Decode,     // camera retrieve or batch decode
+        Remap,      // undistort/zoom/pan, dual registration, pyramid
+        Index,      // fused NDVI index + LUT kernel
+        Colourise,  // temporal/guided refinement and re-colouring
+        Blend,      // colour over the frame
+        Overlay,    // contours, telemetry, HUD
+        Scale,      // resize or mosaic render to the view
+        Paint,      // processed view conversion and paint
+        Encode,     // recording and batch output
+        STAGE_COUNT
+    };
+
+    static constexpr int SUB_BITS = 4;                 // 16 sub-buckets per octave
+    static constexpr int MAX_EXPONENT = 40;            // 2^40 ns
+    static constexpr int BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) << SUB_BITS;
+    // Per stage counter totals: samples, pixels, then one per PerfCounters::Event
+    static constexpr int COUNTER_FIELDS = 2 + PerfCounters::EVENT_COUNT;
+
+    /**
+     * @brief Snapshot holds the summed counts of all threads.
+     */
+    class Snapshot
+    {
+    public:
+        Snapshot();
+
+        /**
+         * @brief since returns the counts recorded after earlier was taken
+         */
+        Snapshot since(const Snapshot &earlier) const;
+
+        /**
+         * @brief stats summarises a stage; fps is over the window since the
+         * earlier snapshot (or since the first sample for a plain snapshot)
+         */
+        StageStats stats(Stage stage) const;
+
+        /**
+         * @brief report formats one line per stage that has samples
+         */
+        QStringList report() const;
+
+        qint64 takenUs() const { return m_takenUs; }
+
+    private:
+        friend class StageProfiler;
+        std::vector<quint64> m_counts;  // STAGE_COUNT x BUCKETS
+        std::vector<quint64> m_totalNs; // per stage
+        std::vector<quint64> m_perf;    // STAGE_COUNT x COUNTER_FIELDS
+        qint64 m_takenUs;
+        qint64 m_sinceUs;
+    };
+
+    /**
+     * @brief record adds one sample to the calling thread's histogram
+     * @param stage pipeline stage
+     * @param ns duration in nanoseconds
+     */
+    static void record(Stage stage, qint64 ns);
+
+    /**
+     * @brief recordCounters adds counter deltas to the calling thread's stage
+     * @param stage pipeline stage
+     * @param begin counters at the start of the stage
+     * @param end counters at the end of the stage
+     * @param pixels pixels processed, 0 if not per-pixel work
+     */
+    static void recordCounters(Stage stage, const PerfCounters::Sample &begin,
+                               const PerfCounters::Sample &end, qint64 pixels);
+
+    /**
+     * @brief snapshot sums the histograms of all threads
+     */
+    static Snapshot snapshot();
+
+    /**
+     * @brief name returns the display name of a stage
+     */
+    static const char *name(Stage stage);
+
+    /**
+     * @brief bucket maps nanoseconds to a histogram bucket
+     */
+    static int bucket(quint64 ns);
+
+    /**
+     * @brief bucketUpperNs returns the largest value of a bucket
+     */
+    static quint64 bucketUpperNs(int bucket);
+};
+
+/**
+ * @brief StageTimer records the time from construction to destruction (or
+ * stop()) into a stage, and into the trace while one is recording. While
+ * hardware counters are enabled it also records their deltas; the counter
+ * reads sit outside the timed span.
+ */
+class StageTimer
+{
+public:
+    /**
+     * @param stage pipeline stage
+     * @param pixels pixels the stage processes, for per-pixel counter rates
+     */
+    explicit StageTimer(StageProfiler::Stage stage, qint64 pixels = 0)
+        : m_stage(stage)
+        , m_pixels(pixels)
+        , m_counters()
+        , m_counting(PerfCounters::isEnabled() && PerfCounters::readWithPool(m_counters))
+        , m_start(std::chrono::steady_clock::now())
+        , m_running(true)
+    {}
+    ~StageTimer() { stop(); }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+    /**
+     * @brief setPixels sets the pixel count once known, e.g. after a decode
+     */
+    void setPixels(qint64 pixels) { m_pixels = pixels; }
+
+    /**
+     * @brief stop records the sample now; later calls do nothing
+     */
+    void stop()
+    {
+        if (m_running) {
+            using namespace std::chrono;
+            m_running = false;
+            const steady_clock::time_point end = steady_clock::now();
+            StageProfiler::record(m_stage, duration_cast<nanoseconds>(end - m_start).count());
+            if (m_counting) {
+                PerfCounters::Sample counters;
+                if (PerfCounters::readWithPool(counters)) {
+                    StageProfiler::recordCounters(m_stage, m_counters, counters, m_pixels);
+                }
+            }
+#if RAZIEL_TRACING
+            if (TraceRecorder::isEnabled()) {
+                TraceRecorder::complete(StageProfiler::name(m_stage),
+                                        duration_cast<nanoseconds>(m_start.time_since_epoch()).count(),
+                                        duration_cast<nanoseconds>(end.time_since_epoch()).count());
+            }
+#endif
+        }
+    }
+
+private:
+    StageProfiler::Stage m_stage;
+    qint64 m_pixels;
+    PerfCounters::Sample m_counters;  // at construction
+    bool m_counting;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_running;
+};
+
+#endif // STAGEPROFILER_H
@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------------
+// include/SyntheticSource.h
+//------------------------------------------------------------------------------
+
+#ifndef SYNTHETICSOURCE_H
+#define SYNTHETICSOURCE_H
+
+#include <QJsonObject>
+#include <vector>
+#include "FrameSource.h"
+
+/**
+ * @brief SceneParams describes a synthetic scene.
+ */
+struct SceneParams
+{
+    int         width      = 1280;
+    int         height     = 720;
+    double      frameRate  = 30.0;
+    int         patches    = 24;      // vegetation patches
+    float       gradient   = 0.3f;    // left-to-right illumination change (fraction)
+    float       noise      = 2.0f;    // Gaussian sensor noise sigma (DN)
+    float       saturation = 0.01f;   // area fraction of clipped highlights
+    cv::Point2f motion     = { 2.0f, 0.5f };  // scene motion (pixels/frame)
+    int         poolSize   = 16;      // pregenerated frames
+    int         seed       = 1;
+    bool        stamp      = false;   // embed the read time for LatencyProbe
+
+    QJsonObject toJson() const;
+    static SceneParams fromJson(const QJsonObject &obj);
+};
+
+/**
+ * @brief The SyntheticSource class generates BGR scenes with a known NDVI:
+ * soil under an illumination gradient, vegetation patches of known NIR and
+ * visible reflectance, clipped highlights, sensor noise and motion.
+ *
+ * Scenes follow the converted-sensor layout of the kernel (NIR in R,
+ * visible in B). The scene is rendered once, larger than the frame; the
+ * pool holds poolSize noisy, shifted frames, and read() hands them out in
+ * turn without copying, so generation is never the bottleneck. The motion
+ * therefore repeats every poolSize frames. Frames are shared: consumers
+ * must treat them as read-only, as the pipeline already does.
+ *
+ * With stamp set, each frame is copied and carries its read time as a
+ * LatencyProbe code along the top rows.
+ *
+ * truth() returns the NDVI of the noise-free 8-bit frame, which is what the
+ * kernel reports at unit gains and zero noise, with MASK_SATURATED set on
+ * the clipped highlights.
+ */
+class SyntheticSource : public FrameSource
+{
+public:
+    /**
+     * @brief SyntheticSource constructor
+     */
+    explicit SyntheticSource(const SceneParams &params = SceneParams());
+
+    bool open() override;
+    bool read(cv::Mat &frame, FrameMeta &meta) override;
+    bool rewind() override;
+    double frameRate() const override { return m_params.frameRate; }
+    QString description() const override;
+
+    /**
+     * @brief truth returns the expected NDVI and mask of a frame
+     * @param sequence FrameMeta::sequence of the frame
+     * @param ndvi receives the CV_32F NDVI (a view, do not modify)
+     * @param mask receives the CV_8U mask flags (a view, do not modify)
+     */
+    void truth(qint64 sequence, cv::Mat &ndvi, cv::Mat &mask) const;
+
+    /**
+     * @brief params returns the scene parameters
+     */
+    const SceneParams &params() const { return m_params; }
+
+private:
+    cv::Point offset(int slot) const;
+
+    SceneParams          m_params;
+    cv::Mat              m_scene;      // noise-free BGR scene, larger than a frame
+    cv::Mat              m_truth;      // NDVI of m_scene
+    cv::Mat              m_truthMask;  // mask flags of m_scene
+    std::vector<cv::Mat> m_pool;       // noisy shifted frames
+    qint64               m_next;       // next sequence number
+};
+
+#endif // SYNTHETICSOURCE_H
@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+// include/TemporalFilter.h
+//------------------------------------------------------------------------------
+
+#ifndef TEMPORALFILTER_H
+#define TEMPORALFILTER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief The TemporalFilter class denoises the float NDVI plane over time.
+ *
+ * State is kept in a persistent accumulator (EMA) or a ring of the last N
+ * planes plus their running sum (box). Work is done per 16x16 block: the
+ * block's mean absolute difference to the current estimate is measured
+ * first, and blocks above the motion threshold are reset to the incoming
+ * values so moving objects do not smear.
+ *
+ * With a validity mask, masked pixels hold their history and stay out of
+ * the motion test, so the zeros written for saturated or unregistered
+ * pixels never blend back in once the pixels are valid again; a pixel
+ * with no valid sample yet is seeded from its first one. The box running
+ * sum is rebuilt from the ring every RESUM_WRAPS passes so float rounding
+ * does not accumulate.
+ */
+class TemporalFilter
+{
+public:
+    enum Mode
+    {
+        Off,  // pass-through
+        EMA,  // exponential moving average
+        Box   // N-frame box average
+    };
+
+    /**
+     * @brief TemporalFilter constructor, starts disabled
+     */
+    TemporalFilter();
+
+    /**
+     * @brief setMode selects the filter and resets its state
+     */
+    void setMode(Mode mode);
+
+    /**
+     * @brief mode returns the active filter
+     */
+    Mode mode() const { return m_mode; }
+
+    /**
+     * @brief setAlpha sets the EMA weight of the incoming frame (0..1]
+     */
+    void setAlpha(float alpha);
+    float alpha() const { return m_alpha; }
+
+    /**
+     * @brief setWindow sets the box length in frames and resets the state
+     */
+    void setWindow(int frames);
+    int window() const { return m_window; }
+
+    /**
+     * @brief setMotionThreshold sets the block mean |ΔNDVI| that triggers a reset
+     */
+    void setMotionThreshold(float threshold);
+    float motionThreshold() const { return m_motion; }
+
+    /**
+     * @brief reset drops the accumulated state
+     */
+    void reset();
+
+    /**
+     * @brief apply filters the NDVI plane in place
+     * @param ndvi CV_32F NDVI plane, replaced by the filtered estimate
+     * @param mask optional validity flags (CV_8U, 0 = valid); masked pixels
+     * are left as they were
+     */
+    void apply(cv::Mat &ndvi, const cv::Mat &mask = cv::Mat());
+
+private:
+    static constexpr int RESUM_WRAPS = 16;  // ring passes between box re-sums
+
+    void initialise(const cv::Mat &ndvi, const cv::Mat &mask);
+    bool plainBlock(const cv::Mat &mask, int y0, int y1, int x0, int n) const;
+    void applyEMA(cv::Mat &ndvi, const cv::Mat &mask);
+    void applyBox(cv::Mat &ndvi, const cv::Mat &mask);
+    void resum();
+
+    Mode                 m_mode;       // active filter
+    float                m_alpha;      // EMA weight of the new frame
+    int                  m_window;     // box length in frames
+    float                m_motion;     // block reset threshold
+    cv::Mat              m_acc;        // EMA estimate or box running sum
+    std::vector<cv::Mat> m_history;    // box ring of past planes
+    int                  m_head;       // next ring slot to overwrite
+    int                  m_wraps;      // ring passes since the last re-sum
+    cv::Mat              m_seen;       // CV_8U, 255 where the state holds a valid sample
+};
+
+#endif // TEMPORALFILTER_H
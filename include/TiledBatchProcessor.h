@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+// include/TiledBatchProcessor.h
+//------------------------------------------------------------------------------
+
+#ifndef TILEDBATCHPROCESSOR_H
+#define TILEDBATCHPROCESSOR_H
+
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "NDVIKernel.h"
+
+/**
+ * @brief TileStats summarises one tile or a whole run.
+ */
+struct TileStats
+{
+    NDVIStats           ndvi;       // valid-pixel NDVI statistics
+    std::vector<qint64> histogram;  // valid NDVI over [-1, 1], HIST_BINS bins
+};
+
+/**
+ * @brief The TiledBatchProcessor class runs the NDVI kernel, palette and
+ * histogram over an ENVI raster far larger than RAM, one tile at a time.
+ *
+ * A reader thread fills a bounded queue with tiles ahead of compute; worker
+ * threads take tiles from it, run the fused kernel and the histogram, and
+ * write each tile's float NDVI (.tiff) and coloured (.png) output with an
+ * index file. Memory is bounded by (prefetch + workers) tiles whatever the
+ * image size. Per-tile stats are reduced in tile order at the end, so the
+ * totals do not depend on thread timing.
+ */
+class TiledBatchProcessor
+{
+public:
+    static constexpr int HIST_BINS = 256;
+
+    /**
+     * @brief TiledBatchProcessor constructor
+     * @param kernel configured kernel (copied: gains, window, thresholds)
+     * @param lut 256x1 CV_8UC3 palette
+     */
+    TiledBatchProcessor(const NDVIKernel &kernel, const cv::Mat &lut);
+
+    /**
+     * @brief setTileSize sets the tile side in pixels
+     */
+    void setTileSize(int size);
+
+    /**
+     * @brief setPrefetch sets the number of tiles read ahead of compute
+     */
+    void setPrefetch(int tiles);
+
+    /**
+     * @brief setWorkers sets the number of compute threads (0 = auto)
+     */
+    void setWorkers(int workers);
+
+    /**
+     * @brief setBands selects the zero-based NIR and visible bands
+     */
+    void setBands(int nirBand, int visBand);
+
+    /**
+     * @brief setShift sets the right shift bringing 16-bit samples to 8 bits
+     */
+    void setShift(int shift);
+
+    /**
+     * @brief setOutputs selects which tile images are written; the index
+     * and its stats are always written
+     */
+    void setOutputs(bool colour, bool ndvi);
+
+    /**
+     * @brief setProgress sets a callback run on a worker thread after each tile
+     */
+    void setProgress(std::function<void(int done, int total)> progress);
+
+    /**
+     * @brief run processes a raster into an output directory
+     * @param input ENVI header or data path
+     * @param outDir output directory (created if missing)
+     * @return false on an I/O error or cancellation
+     */
+    bool run(const QString &input, const QString &outDir);
+
+    /**
+     * @brief cancel asks a running job to stop after the tiles in flight
+     */
+    void cancel() { m_cancel = true; }
+
+    /**
+     * @brief error describes the last failure
+     */
+    QString error() const { return m_error; }
+
+    /**
+     * @brief totals returns the stats of the last run
+     */
+    const TileStats &totals() const { return m_totals; }
+
+    /**
+     * @brief seconds returns the wall time of the last run
+     */
+    double seconds() const { return m_seconds; }
+
+private:
+    NDVIKernel        m_kernel;
+    cv::Mat           m_lut;
+    int               m_tileSize;
+    int               m_prefetch;
+    int               m_workers;
+    int               m_nirBand;
+    int               m_visBand;
+    int               m_shift;
+    bool              m_writeColour;
+    bool              m_writeNdvi;
+    std::function<void(int, int)> m_progress;
+    std::atomic<bool> m_cancel;
+    QString           m_error;
+    TileStats         m_totals;
+    double            m_seconds;
+};
+
+#endif // TILEDBATCHPROCESSOR_H
@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+// include/TraceRecorder.h
+//------------------------------------------------------------------------------
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+
+#ifndef RAZIEL_TRACING
+#define RAZIEL_TRACING 0
+#endif
+
+/**
+ * @brief The TraceRecorder class records pipeline execution timelines and
+ * writes them as Chrome trace-event JSON (Perfetto, chrome://tracing).
+ *
+ * Each thread appends to its own ring of the last RING_EVENTS events, so
+ * recording is lock-free and a long session keeps only the recent past.
+ * Rings of exited threads are reused by new threads once dumped.
+ * An event is a complete slice (begin and end in one record), or one end
+ * of a flow arrow that links a frame from the capture thread to the GUI.
+ * Events carry the frame the thread was last told it is working on.
+ *
+ * Recording is off until setEnabled(true); the hooks then cost a flag
+ * test. Built with RAZIEL_TRACING=0 the RAZIEL_TRACE_* macros and the
+ * StageTimer hook compile to nothing.
+ */
+class TraceRecorder
+{
+public:
+    enum Kind { Complete, FlowStart, FlowEnd };
+
+    static constexpr int RING_EVENTS = 1 << 15;  // per thread
+
+    /**
+     * @brief available returns true if the trace hooks are compiled in
+     */
+    static constexpr bool available() { return RAZIEL_TRACING != 0; }
+
+    /**
+     * @brief setEnabled starts a fresh trace, or stops recording (the
+     * events stay until the next start)
+     */
+    static void setEnabled(bool on);
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief setThreadName names the calling thread in the trace
+     * @param name string literal
+     */
+    static void setThreadName(const char *name);
+
+    /**
+     * @brief setFrame sets the frame the calling thread works on
+     */
+    static void setFrame(qint64 frame);
+
+    /**
+     * @brief complete records a slice on the calling thread
+     * @param name string literal
+     * @param beginNs steady clock nanoseconds
+     * @param endNs steady clock nanoseconds
+     */
+    static void complete(const char *name, qint64 beginNs, qint64 endNs);
+
+    /**
+     * @brief flow records one end of a flow arrow, bound to the enclosing slice
+     */
+    static void flow(Kind kind, const char *name, qint64 id);
+
+    /**
+     * @brief dump writes the recorded events of all threads
+     * @return false if the file cannot be written
+     */
+    static bool dump(const QString &path);
+
+    /**
+     * @brief nowNs returns the steady clock in nanoseconds
+     */
+    static qint64 nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static void record(Kind kind, const char *name, qint64 beginNs, qint64 endNs);
+
+    static inline std::atomic<bool> s_enabled{false};
+};
+
+/**
+ * @brief TraceScope records a slice from construction to destruction.
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name)
+        , m_beginNs(TraceRecorder::isEnabled() ? TraceRecorder::nowNs() : -1)
+    {}
+    ~TraceScope()
+    {
+        if (m_beginNs >= 0) {
+            TraceRecorder::complete(m_name, m_beginNs, TraceRecorder::nowNs());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    qint64 m_beginNs;
+};
+
+#define RAZIEL_TRACE_CONCAT2(a, b) a##b
+#define RAZIEL_TRACE_CONCAT(a, b) RAZIEL_TRACE_CONCAT2(a, b)
+
+#if RAZIEL_TRACING
+#define RAZIEL_TRACE_SCOPE(name) TraceScope RAZIEL_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define RAZIEL_TRACE_THREAD(name) TraceRecorder::setThreadName(name)
+#define RAZIEL_TRACE_FRAME(frame) TraceRecorder::setFrame(frame)
+#define RAZIEL_TRACE_FLOW_BEGIN(name, id) \
+    do { if (TraceRecorder::isEnabled()) TraceRecorder::flow(TraceRecorder::FlowStart, name, id); } while (0)
+#define RAZIEL_TRACE_FLOW_END(name, id) \
+    do { if (TraceRecorder::isEnabled()) TraceRecorder::flow(TraceRecorder::FlowEnd, name, id); } while (0)
+#else
+#define RAZIEL_TRACE_SCOPE(name) do {} while (0)
+#define RAZIEL_TRACE_THREAD(name) do {} while (0)
+#define RAZIEL_TRACE_FRAME(frame) do {} while (0)
+#define RAZIEL_TRACE_FLOW_BEGIN(name, id) do {} while (0)
+#define RAZIEL_TRACE_FLOW_END(name, id) do {} while (0)
+#endif
+
+#endif // TRACERECORDER_H
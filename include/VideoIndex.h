@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+// include/VideoIndex.h
+//------------------------------------------------------------------------------
+
+#ifndef VIDEOINDEX_H
+#define VIDEOINDEX_H
+
+#include <QString>
+#include <QtGlobal>
+#include <opencv2/videoio.hpp>
+#include <vector>
+
+/**
+ * @brief VideoShard is a contiguous frame range of a video file.
+ */
+struct VideoShard
+{
+    qint64 first = 0;  // first frame
+    qint64 last  = 0;  // last frame, inclusive, -1 = to the end of the stream
+};
+
+/**
+ * @brief The VideoIndex class lists the keyframes of a video file so that it
+ * can be cut into GOP-aligned shards that decode independently.
+ *
+ * The index is built from a demux-only pass (raw packets, no decoding).
+ * Backends that cannot return raw packets leave the keyframe list empty,
+ * and shards fall back to even splits of the reported frame count; seeking
+ * then decodes forward from the preceding keyframe, which is still exact
+ * but costs part of a GOP per shard. The reported count is only an
+ * estimate from the container, so the last shard then reads to the end of
+ * the stream instead of stopping at it. Shards must be decoded with the
+ * backend the index used (BACKEND) for frame numbers to agree.
+ */
+class VideoIndex
+{
+public:
+    static constexpr int BACKEND = cv::CAP_FFMPEG;
+
+    /**
+     * @brief build indexes a video file
+     * @return false if the file cannot be opened or reports no frames
+     */
+    bool build(const QString &path);
+
+    /**
+     * @brief frameCount returns the number of frames
+     */
+    qint64 frameCount() const { return m_frames; }
+
+    /**
+     * @brief exact tells whether frameCount() was counted packet by packet
+     * rather than taken from the container
+     */
+    bool exact() const { return m_exact; }
+
+    /**
+     * @brief keyframes returns the sorted keyframe indices (empty if unknown)
+     */
+    const std::vector<qint64> &keyframes() const { return m_keyframes; }
+
+    /**
+     * @brief shards splits [first, last] into at most count ranges starting
+     * on keyframes, as close to equal length as the GOPs allow
+     * @param last last frame, -1 = to the end
+     */
+    std::vector<VideoShard> shards(int count, qint64 first = 0, qint64 last = -1) const;
+
+    /**
+     * @brief error describes the last failure
+     */
+    QString error() const { return m_error; }
+
+private:
+    std::vector<qint64> m_keyframes;
+    qint64              m_frames = 0;
+    bool                m_exact = false;
+    QString             m_error;
+};
+
+#endif // VIDEOINDEX_H
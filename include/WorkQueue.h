@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------
+// include/WorkQueue.h
+//------------------------------------------------------------------------------
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <QDir>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief WorkItem is one unit of a distributed batch job: an input and an
+ * optional frame range.
+ */
+struct WorkItem
+{
+    QString id;            // zero-padded manifest position, also the sort key
+    QString input;         // video file or image directory
+    qint64  first = 0;     // first frame
+    qint64  last  = -1;    // last frame, -1 = to the end
+    int     attempts = 0;  // claims so far
+    QString worker;        // "host:pid" of the current claimant
+
+    QJsonObject toJson() const;
+    static WorkItem fromJson(const QJsonObject &obj);
+};
+
+/**
+ * @brief The WorkQueue class is a work queue kept as a directory, so that
+ * worker processes on this machine or on other nodes sharing the storage
+ * can take part.
+ *
+ * Items move between pending/, claimed/, done/ and failed/ by rename under
+ * a QLockFile. A worker refreshes the modification time of its claimed
+ * file as a heartbeat; claims whose heartbeat goes stale, or whose worker
+ * is known to have died, go back to pending/ until the retry limit.
+ */
+class WorkQueue
+{
+public:
+    /**
+     * @brief WorkQueue constructor
+     * @param dir queue directory
+     */
+    explicit WorkQueue(const QString &dir);
+
+    /**
+     * @brief create empties the queue and enqueues the items with the job options
+     * @return false if the directory cannot be written
+     */
+    bool create(const QList<WorkItem> &items, const QJsonObject &job);
+
+    /**
+     * @brief job returns the job options written by create()
+     */
+    QJsonObject job() const;
+
+    /**
+     * @brief claim moves the first pending item to claimed/
+     * @param worker claimant id, "host:pid"
+     * @param item receives the claimed item
+     * @return false if nothing is pending
+     */
+    bool claim(const QString &worker, WorkItem &item);
+
+    /**
+     * @brief heartbeat refreshes the claim's modification time
+     */
+    void heartbeat(const WorkItem &item);
+
+    /**
+     * @brief complete records a finished item
+     * @param item the claimed item
+     * @param ok true on success; on failure the item is retried until maxAttempts
+     * @param result summary stored with the item
+     * @param maxAttempts retry limit
+     */
+    void complete(const WorkItem &item, bool ok, const QJsonObject &result, int maxAttempts);
+
+    /**
+     * @brief requeue returns stale claims, or all claims of a dead worker, to pending
+     * @param staleMs heartbeat age that counts as stale
+     * @param deadWorker worker known to have exited, empty for none
+     * @param maxAttempts retry limit, beyond which the item fails
+     * @return number of claims released
+     */
+    int requeue(qint64 staleMs, const QString &deadWorker, int maxAttempts);
+
+    /**
+     * @brief count returns the number of items in a state directory
+     * ("pending", "claimed", "done" or "failed")
+     */
+    int count(const QString &state) const;
+
+    /**
+     * @brief ids returns the sorted item ids in a state directory
+     */
+    QStringList ids(const QString &state) const;
+
+    /**
+     * @brief result returns the stored summary of a done item
+     */
+    QJsonObject result(const QString &id) const;
+
+    /**
+     * @brief workerId returns "host:pid" for this process
+     */
+    static QString workerId();
+
+private:
+    static bool writeJson(const QString &path, const QJsonObject &obj);
+    static QJsonObject readJson(const QString &path);
+    QString path(const QString &state, const QString &id) const;
+
+    QDir m_dir;
+};
+
+#endif // WORKQUEUE_H
@@ -0,0 +1,290 @@
+//------------------------------------------------------------------------------
+// src/BatchCoordinator.cpp
+//------------------------------------------------------------------------------
+
+#include "BatchCoordinator.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static constexpr int POLL_MS = 1000;       // queue poll interval
+static constexpr int HEARTBEAT_MS = 1000;  // worker heartbeat interval
+
+/**
+ * @brief BatchCoordinator constructor.
+ */
+BatchCoordinator::BatchCoordinator(const BatchOptions &options, const QString &queueDir,
+                                   int processes, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_queue(queueDir)
+    , m_queueDir(queueDir)
+    , m_processes(std::max(processes, 0))
+    , m_maxAttempts(3)
+    , m_staleMs(60000)
+    , m_workers()
+    , m_timer()
+    , m_error()
+{
+    connect(&m_timer, &QTimer::timeout, this, &BatchCoordinator::poll);
+}
+
+/**
+ * @brief start parses the manifest ("input [first last]" per line, '#'
+ * comments, paths relative to the manifest), fills the queue and starts
+ * the local workers.
+ */
+bool BatchCoordinator::start(const QString &manifest)
+{
+    QFile file(manifest);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_error = QString("cannot open manifest %1").arg(manifest);
+        return false;
+    }
+    const QDir base = QFileInfo(manifest).absoluteDir();
+    static const QRegularExpression ranged("^(.*\\S)\\s+(\\d+)\\s+(-?\\d+)$");
+    QList<WorkItem> items;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        WorkItem item;
+        item.id = QString("%1").arg(items.size(), 6, 10, QChar('0'));
+        QRegularExpressionMatch m = ranged.match(line);
+        item.input = m.hasMatch() ? m.captured(1) : line;
+        if (m.hasMatch()) {
+            item.first = m.captured(2).toLongLong();
+            item.last = m.captured(3).toLongLong();
+        }
+        item.input = base.absoluteFilePath(item.input);
+        items.append(item);
+    }
+    if (items.isEmpty()) {
+        m_error = "manifest lists no inputs";
+        return false;
+    }
+
+    // Share the cores between the local workers unless told otherwise
+    if (m_options.workers == 0 && m_processes > 0) {
+        m_options.workers = std::max(1, QThread::idealThreadCount() / m_processes);
+    }
+    QJsonObject job = m_options.toJson();
+    job["outDir"] = QDir(m_options.outDir).absolutePath();
+    job["maxAttempts"] = m_maxAttempts;
+    if (!QDir().mkpath(m_options.outDir) || !m_queue.create(items, job)) {
+        m_error = QString("cannot create queue in %1").arg(m_queueDir);
+        return false;
+    }
+    for (int i = 0; i < m_processes; ++i) {
+        spawnWorker();
+    }
+    m_timer.start(POLL_MS);
+    return true;
+}
+
+/**
+ * @brief spawnWorker starts one local worker process.
+ */
+void BatchCoordinator::spawnWorker()
+{
+    QProcess *proc = new QProcess(this);
+    proc->setProcessChannelMode(QProcess::ForwardedChannels);
+    connect(proc, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &BatchCoordinator::onWorkerFinished);
+    proc->start(QCoreApplication::applicationFilePath(),
+                {"--batch", "--worker", "--queue", m_queueDir});
+    if (!proc->waitForStarted(5000)) {
+        proc->deleteLater();
+        return;
+    }
+    proc->setProperty("workerId", QString("%1:%2").arg(QSysInfo::machineHostName())
+                                                  .arg(proc->processId()));
+    m_workers.append(proc);
+}
+
+/**
+ * @brief onWorkerFinished requeues the claims of a worker that crashed or
+ * failed, then re-checks the queue.
+ */
+void BatchCoordinator::onWorkerFinished(int exitCode, QProcess::ExitStatus status)
+{
+    QProcess *proc = qobject_cast<QProcess *>(sender());
+    if (!proc) {
+        return;
+    }
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        m_queue.requeue(m_staleMs, proc->property("workerId").toString(), m_maxAttempts);
+    }
+    m_workers.removeAll(proc);
+    proc->deleteLater();
+    poll();
+}
+
+/**
+ * @brief poll requeues stale claims, keeps the local workers topped up and
+ * merges once nothing is pending or claimed.
+ */
+void BatchCoordinator::poll()
+{
+    if (!m_timer.isActive()) {
+        return;
+    }
+    m_queue.requeue(m_staleMs, QString(), m_maxAttempts);
+    const int pending = m_queue.count("pending");
+    const int claimed = m_queue.count("claimed");
+    if (pending == 0 && claimed == 0) {
+        m_timer.stop();
+        for (QProcess *proc : m_workers) {
+            proc->waitForFinished(10000);
+        }
+        const bool ok = merge();
+        emit finished(ok);
+        return;
+    }
+    while (pending > 0 && m_workers.size() < std::min(m_processes, pending + claimed)) {
+        spawnWorker();
+    }
+}
+
+/**
+ * @brief merge concatenates the per-item stats in manifest order and
+ * reduces the totals in the same order.
+ */
+bool BatchCoordinator::merge()
+{
+    const QDir out(m_options.outDir);
+    QFile merged(out.filePath("stats.csv"));
+    if (!merged.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_error = "cannot write merged stats.csv";
+        return false;
+    }
+    QTextStream csv(&merged);
+    csv << "item,input,frame,name,mean,valid,masked,ms\n";
+
+    qint64 frames = 0, failedFrames = 0, pixels = 0, valid = 0;
+    double ndviSum = 0.0, seconds = 0.0;
+    for (const QString &id : m_queue.ids("done")) {
+        const QJsonObject r = m_queue.result(id);
+        frames += qint64(r["frames"].toDouble());
+        failedFrames += qint64(r["failed"].toDouble());
+        pixels += qint64(r["pixels"].toDouble());
+        valid += qint64(r["valid"].toDouble());
+        ndviSum += r["ndviSum"].toDouble();
+        seconds += r["seconds"].toDouble();
+
+        QFile part(out.filePath("items/" + id + "/stats.csv"));
+        if (part.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream in(&part);
+            in.readLine();  // header
+            while (!in.atEnd()) {
+                csv << id << ',' << r["input"].toString() << ',' << in.readLine() << '\n';
+            }
+        }
+    }
+
+    QJsonArray failedItems;
+    for (const QString &id : m_queue.ids("failed")) {
+        failedItems.append(id);
+    }
+    QJsonObject summary;
+    summary["items"] = m_queue.count("done") + failedItems.size();
+    summary["failedItems"] = failedItems;
+    summary["frames"] = frames;
+    summary["failedFrames"] = failedFrames;
+    summary["pixels"] = pixels;
+    summary["mean"] = valid > 0 ? ndviSum / valid : 0.0;
+    summary["workerSeconds"] = seconds;
+    QFile file(out.filePath("summary.json"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_error = "cannot write summary.json";
+        return false;
+    }
+    file.write(QJsonDocument(summary).toJson());
+    if (!failedItems.isEmpty()) {
+        m_error = QString("%1 item(s) failed").arg(failedItems.size());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief runWorker claims items one at a time, runs the batch engine on
+ * each and records the outcome. A side thread beats the claim while the
+ * item runs, so steps without frame progress (indexing a long video, a
+ * tiled raster) do not look stale; a crashed or lost node stops beating.
+ */
+int BatchCoordinator::runWorker(const QString &queueDir)
+{
+    QTextStream out(stdout);
+    WorkQueue queue(queueDir);
+    const QJsonObject job = queue.job();
+    if (job.isEmpty()) {
+        out << "No job in " << queueDir << "\n";
+        return 2;
+    }
+    const BatchOptions base = BatchOptions::fromJson(job);
+    const QDir outDir(job["outDir"].toString());
+    const int maxAttempts = job["maxAttempts"].toInt(3);
+    const QString id = WorkQueue::workerId();
+
+    WorkItem item;
+    while (queue.claim(id, item)) {
+        BatchOptions options = base;
+        options.input = item.input;
+        options.outDir = outDir.filePath("items/" + item.id);
+        options.firstFrame = item.first;
+        options.lastFrame = item.last;
+
+        std::mutex beatMutex;
+        std::condition_variable beatStop;
+        bool running = true;
+        std::thread beat([&]() {
+            std::unique_lock<std::mutex> lock(beatMutex);
+            while (!beatStop.wait_for(lock, std::chrono::milliseconds(HEARTBEAT_MS),
+                                      [&]() { return !running; })) {
+                queue.heartbeat(item);
+            }
+        });
+        BatchRunner runner(options);
+        const bool ok = runner.run();
+        {
+            std::lock_guard<std::mutex> lock(beatMutex);
+            running = false;
+        }
+        beatStop.notify_one();
+        beat.join();
+        const BatchReport &r = runner.report();
+        QJsonObject result;
+        result["input"] = item.input;
+        result["frames"] = r.frames;
+        result["failed"] = r.failed;
+        result["pixels"] = r.pixels;
+        result["valid"] = r.valid;
+        result["ndviSum"] = r.ndviSum;
+        result["seconds"] = r.seconds;
+        if (!ok) {
+            result["error"] = runner.error();
+        }
+        queue.complete(item, ok, result, maxAttempts);
+        out << QString("[%1] item %2: %3 frames, %4 frames/s%5\n")
+                   .arg(id, item.id).arg(r.frames).arg(r.fps(), 0, 'f', 1)
+                   .arg(ok ? QString() : " FAILED: " + runner.error());
+        out.flush();
+    }
+    return 0;
+}
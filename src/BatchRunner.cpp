@@ -0,0 +1,579 @@
+//------------------------------------------------------------------------------
+// src/BatchRunner.cpp
+//------------------------------------------------------------------------------
+
+#include "BatchRunner.h"
+#include "GuidedFilter.h"
+#include "Palette.h"
+#include "StageProfiler.h"
+#include "TiledBatchProcessor.h"
+#include "VideoIndex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Decoded is a frame between a decoder and a worker.
+ */
+struct Decoded
+{
+    qint64  index;
+    QString name;   // output base name
+    cv::Mat frame;  // empty if decoding failed
+};
+
+/**
+ * @brief Result is a processed frame waiting for the ordered writer.
+ */
+struct Result
+{
+    QString   name;
+    cv::Mat   coloured;
+    cv::Mat   ndvi;
+    NDVIStats stats;
+    double    ms = 0.0;  // kernel + smoothing time
+    bool      ok = false;
+};
+
+} // namespace
+
+/**
+ * @brief toJson serialises the engine options (not input/output or range).
+ */
+QJsonObject BatchOptions::toJson() const
+{
+    QJsonObject obj;
+    obj["palette"] = palette;
+    obj["vmin"] = vmin;
+    obj["vmax"] = vmax;
+    obj["gainRed"] = gains.red;
+    obj["gainBlue"] = gains.blue;
+    obj["satLevel"] = satLevel;
+    obj["minSignal"] = minSignal;
+    obj["writeColour"] = writeColour;
+    obj["writeNdvi"] = writeNdvi;
+    obj["smooth"] = smooth;
+    obj["decoders"] = decoders;
+    obj["workers"] = workers;
+    obj["queueDepth"] = queueDepth;
+    obj["shards"] = shards;
+    return obj;
+}
+
+/**
+ * @brief fromJson parses engine options, keeping defaults for missing keys.
+ */
+BatchOptions BatchOptions::fromJson(const QJsonObject &obj)
+{
+    BatchOptions o;
+    o.palette = obj["palette"].toString(o.palette);
+    o.vmin = float(obj["vmin"].toDouble(o.vmin));
+    o.vmax = float(obj["vmax"].toDouble(o.vmax));
+    o.gains.red = float(obj["gainRed"].toDouble(o.gains.red));
+    o.gains.blue = float(obj["gainBlue"].toDouble(o.gains.blue));
+    o.satLevel = obj["satLevel"].toInt(o.satLevel);
+    o.minSignal = obj["minSignal"].toInt(o.minSignal);
+    o.writeColour = obj["writeColour"].toBool(o.writeColour);
+    o.writeNdvi = obj["writeNdvi"].toBool(o.writeNdvi);
+    o.smooth = obj["smooth"].toBool(o.smooth);
+    o.decoders = obj["decoders"].toInt(o.decoders);
+    o.workers = obj["workers"].toInt(o.workers);
+    o.queueDepth = obj["queueDepth"].toInt(o.queueDepth);
+    o.shards = obj["shards"].toInt(o.shards);
+    return o;
+}
+
+/**
+ * @brief BatchRunner constructor.
+ */
+BatchRunner::BatchRunner(const BatchOptions &options)
+    : m_options(options)
+    , m_progress()
+    , m_error()
+    , m_report()
+{}
+
+/**
+ * @brief setProgress sets the per-frame callback.
+ */
+void BatchRunner::setProgress(std::function<void(qint64)> progress)
+{
+    m_progress = std::move(progress);
+}
+
+/**
+ * @brief runTiled hands an ENVI raster to the out-of-core tile engine.
+ * Smoothing is rejected: the guided filter would seam at tile borders.
+ */
+bool BatchRunner::runTiled(const cv::Mat &lut)
+{
+    if (m_options.smooth) {
+        m_error = "smoothing is not supported for tiled rasters";
+        return false;
+    }
+    NDVIKernel kernel;
+    kernel.setGains(m_options.gains);
+    kernel.configure(m_options.vmin, m_options.vmax);
+    kernel.setMaskThresholds(m_options.satLevel, m_options.minSignal);
+    TiledBatchProcessor tiles(kernel, lut);
+    tiles.setWorkers(m_options.workers);
+    tiles.setOutputs(m_options.writeColour, m_options.writeNdvi);
+    if (!tiles.run(m_options.input, m_options.outDir)) {
+        m_error = tiles.error();
+        return false;
+    }
+    m_report.frames = 1;
+    m_report.pixels = tiles.totals().ndvi.total;
+    m_report.ndviSum = tiles.totals().ndvi.sum;
+    m_report.valid = tiles.totals().ndvi.valid;
+    m_report.seconds = tiles.seconds();
+    return true;
+}
+
+/**
+ * @brief runSharded processes GOP-aligned ranges of a video in parallel,
+ * then stitches them: stats.csv is concatenated in shard order, NDVI
+ * frames move into ndvi/, and colour.ffconcat lists the colour segments
+ * (FFmpeg's concat demuxer plays them as one stream, no re-encode).
+ */
+bool BatchRunner::runSharded(int shards)
+{
+    VideoIndex index;
+    if (!index.build(m_options.input)) {
+        m_error = index.error();
+        return false;
+    }
+    const std::vector<VideoShard> ranges =
+        index.shards(shards, m_options.firstFrame, m_options.lastFrame);
+    if (ranges.empty()) {
+        m_error = QString("empty frame range for %1").arg(m_options.input);
+        return false;
+    }
+
+    const int cores = std::max(1, QThread::idealThreadCount());
+    const int n = int(ranges.size());
+    const QDir out(m_options.outDir);
+    if (!out.mkpath("shards") || (m_options.writeNdvi && !out.mkpath("ndvi"))) {
+        m_error = QString("cannot create %1").arg(m_options.outDir);
+        return false;
+    }
+
+    const int64 start = cv::getTickCount();
+    std::vector<BatchRunner> runners;
+    runners.reserve(size_t(n));
+    std::vector<std::atomic<qint64>> done(size_t(n));
+    for (int i = 0; i < n; ++i) {
+        BatchOptions o = m_options;
+        o.shards = 1;
+        o.outDir = out.filePath(QString("shards/%1").arg(i, 3, 10, QChar('0')));
+        o.firstFrame = ranges[size_t(i)].first;
+        o.lastFrame = ranges[size_t(i)].last;
+        o.decoders = 1;
+        o.workers = m_options.workers > 0 ? m_options.workers : std::max(1, cores / n - 1);
+        runners.emplace_back(o);
+        done[size_t(i)] = 0;
+        std::atomic<qint64> *counter = &done[size_t(i)];
+        runners.back().setProgress([counter](qint64 frames) { *counter = frames; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    int running = n;
+    std::vector<char> ok(size_t(n), 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i) {
+        threads.emplace_back([&, i]() {
+            ok[size_t(i)] = runners[size_t(i)].run();
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            finished.notify_all();
+        });
+    }
+
+    // Report combined progress on the calling thread while the shards run
+    qint64 reported = 0;
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        const bool last = finished.wait_for(lock, std::chrono::milliseconds(100),
+                                            [&]() { return running == 0; });
+        lock.unlock();
+        qint64 total = 0;
+        for (const std::atomic<qint64> &d : done) {
+            total += d;
+        }
+        if (m_progress && total != reported) {
+            m_progress(total);
+            reported = total;
+        }
+        if (last) {
+            break;
+        }
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    // Stitch in shard order
+    QFile statsFile(out.filePath("stats.csv"));
+    if (!statsFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_error = "cannot write stats.csv";
+        return false;
+    }
+    QTextStream stats(&statsFile);
+    stats << "frame,name,mean,valid,masked,ms\n";
+    QFile concatFile(out.filePath("colour.ffconcat"));
+    QTextStream concat(&concatFile);
+    if (m_options.writeColour) {
+        if (!concatFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            m_error = "cannot write colour.ffconcat";
+            return false;
+        }
+        concat << "ffconcat version 1.0\n";
+    }
+
+    bool allOk = true;
+    for (int i = 0; i < n; ++i) {
+        const BatchRunner &r = runners[size_t(i)];
+        if (!ok[size_t(i)] && allOk) {
+            m_error = r.error();
+            allOk = false;
+        }
+        m_report.frames += r.report().frames;
+        m_report.failed += r.report().failed;
+        m_report.pixels += r.report().pixels;
+        m_report.ndviSum += r.report().ndviSum;
+        m_report.valid += r.report().valid;
+
+        const QString dir = QString("shards/%1").arg(i, 3, 10, QChar('0'));
+        QFile part(out.filePath(dir + "/stats.csv"));
+        if (part.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream in(&part);
+            in.readLine();  // header
+            while (!in.atEnd()) {
+                stats << in.readLine() << '\n';
+            }
+            part.close();
+            part.remove();
+        }
+        if (m_options.writeNdvi) {
+            QDir ndvi(out.filePath(dir + "/ndvi"));
+            for (const QString &f : ndvi.entryList({"*.tiff"}, QDir::Files, QDir::Name)) {
+                const QString target = out.filePath("ndvi/" + f);
+                QFile::remove(target);
+                QFile::rename(ndvi.filePath(f), target);
+            }
+            ndvi.removeRecursively();
+        }
+        if (m_options.writeColour && QFileInfo::exists(out.filePath(dir + "/colour.avi"))) {
+            concat << "file '" << dir << "/colour.avi'\n";
+        }
+    }
+    m_report.seconds = double(cv::getTickCount() - start) / cv::getTickFrequency();
+    return allOk;
+}
+
+/**
+ * @brief run wires decoders → workers → ordered writer.
+ */
+bool BatchRunner::run()
+{
+    m_report = BatchReport();
+    m_error.clear();
+    const QFileInfo info(m_options.input);
+    const cv::Mat lut = paletteLUT(m_options.palette);
+    if (lut.empty()) {
+        m_error = QString("unknown palette %1").arg(m_options.palette);
+        return false;
+    }
+    if (info.suffix().compare("hdr", Qt::CaseInsensitive) == 0) {
+        return runTiled(lut);
+    }
+    if (!info.isDir() && m_options.shards != 1) {
+        const int shards = m_options.shards > 0
+            ? m_options.shards : std::max(1, QThread::idealThreadCount() / 2);
+        if (shards > 1) {
+            return runSharded(shards);
+        }
+    }
+    const QDir out(m_options.outDir);
+    if (!QDir().mkpath(m_options.outDir)
+        || (m_options.writeNdvi && !out.mkpath("ndvi"))
+        || (m_options.writeColour && info.isDir() && !out.mkpath("colour"))) {
+        m_error = QString("cannot create %1").arg(m_options.outDir);
+        return false;
+    }
+
+    // Input: sorted image list, or one video decoder
+    QStringList images;
+    cv::VideoCapture video;
+    const int cores = std::max(1, QThread::idealThreadCount());
+    const int decoders = m_options.decoders > 0 ? m_options.decoders : std::max(1, cores / 4);
+    const int workers = m_options.workers > 0 ? m_options.workers : std::max(1, cores - decoders);
+    double fps = 30.0;
+    if (info.isDir()) {
+        QDir dir(m_options.input);
+        for (const QString &f : dir.entryList({"*.png", "*.jpg", "*.jpeg", "*.tif", "*.tiff", "*.bmp"},
+                                              QDir::Files, QDir::Name)) {
+            images << dir.filePath(f);
+        }
+        const qint64 first = std::max<qint64>(m_options.firstFrame, 0);
+        images = images.mid(int(first), m_options.lastFrame >= 0
+                                            ? int(m_options.lastFrame - first + 1) : -1);
+        if (images.isEmpty()) {
+            m_error = QString("no images in %1").arg(m_options.input);
+            return false;
+        }
+    } else {
+        // The index backend first, so shard ranges count the same frames
+        video.open(m_options.input.toStdString(), VideoIndex::BACKEND,
+                   { cv::CAP_PROP_N_THREADS, decoders });
+        if (!video.isOpened()) {
+            video.open(m_options.input.toStdString(), cv::CAP_ANY,
+                       { cv::CAP_PROP_N_THREADS, decoders });
+        }
+        if (!video.isOpened()) {
+            m_error = QString("cannot open %1").arg(m_options.input);
+            return false;
+        }
+        fps = video.get(cv::CAP_PROP_FPS) > 0.0 ? video.get(cv::CAP_PROP_FPS) : fps;
+        if (m_options.firstFrame > 0) {
+            video.set(cv::CAP_PROP_POS_FRAMES, double(m_options.firstFrame));
+        }
+    }
+
+    QFile statsFile(out.filePath("stats.csv"));
+    if (!statsFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_error = "cannot write stats.csv";
+        return false;
+    }
+    QTextStream stats(&statsFile);
+    stats << "frame,name,mean,valid,masked,ms\n";
+    cv::VideoWriter colourVideo;
+
+    const int64 start = cv::getTickCount();
+    const int depth = std::max(m_options.queueDepth, workers + 1);
+
+    std::mutex mutex;
+    std::condition_variable slotFree, decodedReady, resultReady;
+    int inFlight = 0;                 // slots held by decoded or unwritten frames
+    qint64 nextIndex = 0;             // next frame to claim
+    // Frame count; for video -1 until the stream ends unless a range is set
+    qint64 endIndex = !images.isEmpty() ? images.size()
+                    : m_options.lastFrame >= 0 ? m_options.lastFrame - m_options.firstFrame + 1
+                    : -1;
+    int decodersLeft = images.isEmpty() ? 1 : decoders;
+    std::deque<Decoded> decoded;
+    std::map<qint64, Result> results;
+    std::atomic<bool> stop(false);
+
+    // Claims the next slot and frame index in order; -1 when done
+    auto claim = [&]() -> qint64 {
+        std::unique_lock<std::mutex> lock(mutex);
+        slotFree.wait(lock, [&]() { return inFlight < depth || stop; });
+        if (stop || (endIndex >= 0 && nextIndex >= endIndex)) {
+            return -1;
+        }
+        ++inFlight;
+        return nextIndex++;
+    };
+    auto push = [&](Decoded &&d) {
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(std::move(d));
+        decodedReady.notify_one();
+    };
+    auto decoderDone = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        --decodersLeft;
+        decodedReady.notify_all();
+        resultReady.notify_all();
+    };
+
+    std::vector<std::thread> threads;
+    if (!images.isEmpty()) {
+        for (int d = 0; d < decoders; ++d) {
+            threads.emplace_back([&]() {
+                RAZIEL_TRACE_THREAD("decode");
+                for (qint64 i; (i = claim()) >= 0;) {
+                    RAZIEL_TRACE_FRAME(m_options.firstFrame + i);
+                    Decoded item;
+                    item.index = i;
+                    item.name = QFileInfo(images.at(int(i))).completeBaseName();
+                    StageTimer timer(StageProfiler::Decode);
+                    item.frame = cv::imread(images.at(int(i)).toStdString(), cv::IMREAD_COLOR);
+                    timer.setPixels(qint64(item.frame.total()));
+                    timer.stop();
+                    push(std::move(item));
+                }
+                decoderDone();
+            });
+        }
+    } else {
+        threads.emplace_back([&]() {
+            RAZIEL_TRACE_THREAD("decode");
+            for (qint64 i; (i = claim()) >= 0;) {
+                RAZIEL_TRACE_FRAME(m_options.firstFrame + i);
+                Decoded item;
+                item.index = i;
+                item.name = QString("frame_%1").arg(m_options.firstFrame + i, 6, 10, QChar('0'));
+                StageTimer timer(StageProfiler::Decode);
+                const bool gotFrame = video.read(item.frame);
+                timer.setPixels(qint64(item.frame.total()));
+                timer.stop();
+                if (!gotFrame) {
+                    // End of stream: release the slot and fix the frame count
+                    std::lock_guard<std::mutex> lock(mutex);
+                    --inFlight;
+                    endIndex = i;
+                    slotFree.notify_all();
+                    break;
+                }
+                push(std::move(item));
+            }
+            decoderDone();
+        });
+    }
+
+    for (int w = 0; w < workers; ++w) {
+        threads.emplace_back([&]() {
+            RAZIEL_TRACE_THREAD("worker");
+            NDVIKernel kernel;
+            kernel.setGains(m_options.gains);
+            kernel.configure(m_options.vmin, m_options.vmax);
+            kernel.setMaskThresholds(m_options.satLevel, m_options.minSignal);
+            GuidedFilter guided;
+            cv::Mat mask;
+            for (;;) {
+                Decoded item;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    decodedReady.wait(lock, [&]() {
+                        return !decoded.empty() || decodersLeft == 0 || stop;
+                    });
+                    if (decoded.empty()) {
+                        return;
+                    }
+                    item = std::move(decoded.front());
+                    decoded.pop_front();
+                }
+                Result r;
+                r.name = item.name;
+                RAZIEL_TRACE_FRAME(m_options.firstFrame + item.index);
+                if (!item.frame.empty()) {
+                    const int64 t0 = cv::getTickCount();
+                    {
+                        StageTimer timer(StageProfiler::Index, qint64(item.frame.total()));
+                        kernel.apply(item.frame, lut, r.coloured, r.ndvi, mask, &r.stats);
+                    }
+                    if (m_options.smooth) {
+                        StageTimer timer(StageProfiler::Colourise, qint64(item.frame.total()));
+                        guided.apply(item.frame, r.ndvi, mask);
+                        kernel.colourise(r.ndvi, mask, lut, r.coloured, &r.stats);
+                    }
+                    r.ms = double(cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+                    r.ok = true;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                results.emplace(item.index, std::move(r));
+                resultReady.notify_all();
+            }
+        });
+    }
+
+    // Ordered writer on the calling thread
+    RAZIEL_TRACE_THREAD("writer");
+    bool writeFailed = false;
+    for (qint64 index = 0;; ++index) {
+        RAZIEL_TRACE_FRAME(m_options.firstFrame + index);
+        Result r;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            resultReady.wait(lock, [&]() {
+                return results.count(index) > 0
+                    || (endIndex >= 0 && index >= endIndex)
+                    || (decodersLeft == 0 && decoded.empty() && results.empty()
+                        && index >= nextIndex);
+            });
+            auto it = results.find(index);
+            if (it == results.end()) {
+                break;
+            }
+            r = std::move(it->second);
+            results.erase(it);
+        }
+
+        if (r.ok) {
+            StageTimer encodeTimer(StageProfiler::Encode, qint64(r.coloured.total()));
+            bool ok = true;
+            if (m_options.writeColour) {
+                if (images.isEmpty()) {
+                    if (!colourVideo.isOpened()) {
+                        colourVideo.open(out.filePath("colour.avi").toStdString(),
+                                         cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps,
+                                         r.coloured.size());
+                    }
+                    ok = colourVideo.isOpened();
+                    if (ok) colourVideo.write(r.coloured);
+                } else {
+                    ok = cv::imwrite(out.filePath("colour/" + r.name + ".png").toStdString(), r.coloured);
+                }
+            }
+            if (ok && m_options.writeNdvi) {
+                ok = cv::imwrite(out.filePath("ndvi/" + r.name + ".tiff").toStdString(), r.ndvi);
+            }
+            if (!ok) {
+                m_error = QString("cannot write output for %1").arg(r.name);
+                writeFailed = true;
+            }
+            encodeTimer.stop();
+            ++m_report.frames;
+            m_report.pixels += r.stats.total;
+            m_report.ndviSum += r.stats.sum;
+            m_report.valid += r.stats.valid;
+            stats << m_options.firstFrame + index << ',' << r.name << ',' << QString::number(r.stats.mean(), 'f', 4)
+                  << ',' << r.stats.valid << ',' << QString::number(r.stats.maskedFraction(), 'f', 4)
+                  << ',' << QString::number(r.ms, 'f', 2) << '\n';
+        } else {
+            ++m_report.failed;
+            stats << m_options.firstFrame + index << ',' << r.name << ",,,,\n";
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --inFlight;
+            if (writeFailed) stop = true;
+            slotFree.notify_one();
+        }
+        if (writeFailed) {
+            break;
+        }
+        if (m_progress) {
+            m_progress(m_report.frames);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        slotFree.notify_all();
+        decodedReady.notify_all();
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    m_report.seconds = double(cv::getTickCount() - start) / cv::getTickFrequency();
+    return !writeFailed;
+}
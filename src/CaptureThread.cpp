@@ -3,46 +3,275 @@
 //------------------------------------------------------------------------------
 
 #include "CaptureThread.h"
+#include "StageProfiler.h"
 #include <QDebug>
+#include <algorithm>
+#include <cstdlib>
+
+static constexpr int MAX_REGRAB = 4;  // re-grabs allowed to match a dual pair
 
 /**
  * @brief CaptureThread constructor
  * @param camIndex camera index
+ * @param nirIndex NIR camera index, -1 for single camera
  * @param parent parent QObject
  */
-CaptureThread::CaptureThread(int camIndex, QObject *parent)
+CaptureThread::CaptureThread(int camIndex, int nirIndex, QObject *parent)
     : QThread(parent)
     , m_camIndex(camIndex)
+    , m_nirIndex(nirIndex)
+    , m_running(false)
+    , m_capture()
+    , m_nirCapture()
+    , m_sequence(0)
+    , m_maxSkewUs(10000)
+    , m_source()
+    , m_pacing(RealTime)
+    , m_rate(0.0)
+    , m_loop(false)
+    , m_credits(SOURCE_CREDITS)
+{}
+
+/**
+ * @brief CaptureThread constructor for a FrameSource
+ * @param source frame source
+ * @param parent parent QObject
+ */
+CaptureThread::CaptureThread(std::unique_ptr<FrameSource> source, QObject *parent)
+    : QThread(parent)
+    , m_camIndex(-1)
+    , m_nirIndex(-1)
     , m_running(false)
     , m_capture()
+    , m_nirCapture()
+    , m_sequence(0)
+    , m_maxSkewUs(10000)
+    , m_source(std::move(source))
+    , m_pacing(RealTime)
+    , m_rate(0.0)
+    , m_loop(false)
+    , m_credits(SOURCE_CREDITS)
 {}
 
+/**
+ * @brief setPacing sets the FrameSource playback pacing.
+ */
+void CaptureThread::setPacing(Pacing pacing, double rate)
+{
+    m_pacing = pacing;
+    m_rate = rate > 0.0 ? rate : 0.0;
+}
+
 /**
  * @brief run entry point for QThread, captures frames continuously.
  */
 void CaptureThread::run()
 {
     m_running = true;
+    RAZIEL_TRACE_THREAD("capture");
+    if (m_source) {
+        if (!m_source->open()) {
+            emit sourceFailed(m_source->error());
+            emit frameReady(cv::Mat(), FrameMeta());
+            return;
+        }
+        runSource();
+        return;
+    }
     m_capture = openCamera(m_camIndex);
     if (!m_capture.isOpened()) {
         // emit empty frame to signal error
-        emit frameReady(cv::Mat());
+        emit frameReady(cv::Mat(), FrameMeta());
         return;
     }
 
+    if (m_nirIndex >= 0) {
+        m_nirCapture = openCamera(m_nirIndex);
+        if (!m_nirCapture.isOpened()) {
+            emit frameReady(cv::Mat(), FrameMeta());
+            return;
+        }
+        runDual();
+    } else {
+        runSingle();
+    }
+}
+
+/**
+ * @brief runSingle reads one camera and emits every frame.
+ */
+void CaptureThread::runSingle()
+{
     while (m_running && m_capture.isOpened()) {
+        // read() split in two, so capture (sensor wait) and decode time apart
+        RAZIEL_TRACE_FRAME(m_sequence);
         cv::Mat frame;
-        bool ret = m_capture.read(frame);
-        if (!ret) {
+        StageTimer grabTimer(StageProfiler::Capture);
+        if (!m_capture.grab()) {
+            break;
+        }
+        grabTimer.stop();
+        StageTimer decodeTimer(StageProfiler::Decode);
+        if (!m_capture.retrieve(frame)) {
             break;
         }
+        decodeTimer.setPixels(qint64(frame.total()));
+        decodeTimer.stop();
+        FrameMeta meta;
+        meta.sequence = m_sequence++;
+        meta.timestampUs = steadyMicros();
+        meta.arrivalUs = meta.timestampUs;
         // emit captured frame
-        emit frameReady(frame);
+        {
+            RAZIEL_TRACE_SCOPE("emit");
+            RAZIEL_TRACE_FLOW_BEGIN("frame", meta.sequence);
+            emit frameReady(frame, meta);
+        }
         // slight sleep to avoid CPU spin
         msleep(1);
     }
 }
 
+/**
+ * @brief runSource plays the FrameSource with the selected pacing. Frames
+ * are only emitted while the consumer holds fewer than SOURCE_CREDITS, so
+ * MaxSpeed measures the pipeline instead of filling the event queue. A
+ * read error ends playback with sourceFailed().
+ */
+void CaptureThread::runSource()
+{
+    // FixedRate defaults to the rate the source reports once open
+    const double rate = m_rate > 0.0 ? m_rate
+                      : m_source->frameRate() > 0.0 ? m_source->frameRate() : 30.0;
+    qint64 wallStart = steadyMicros();
+    qint64 sourceStart = -1;
+    qint64 played = 0;  // frames since the last (re)start
+    while (m_running) {
+        cv::Mat frame, nir;
+        FrameMeta meta;
+        StageTimer readTimer(StageProfiler::Capture);
+        if (!m_source->readDual(frame, nir, meta)) {
+            // A read error ends playback even when looping
+            if (!m_source->error().isEmpty()) {
+                emit sourceFailed(m_source->error());
+                break;
+            }
+            if (!m_loop || !m_source->rewind()) {
+                break;
+            }
+            wallStart = steadyMicros();
+            sourceStart = -1;
+            played = 0;
+            continue;
+        }
+        RAZIEL_TRACE_FRAME(meta.sequence);
+        readTimer.setPixels(qint64(frame.total() + nir.total()));
+        readTimer.stop();
+        if (sourceStart < 0) {
+            sourceStart = meta.timestampUs;
+        }
+
+        // Due time on the steady clock, or now for MaxSpeed
+        qint64 due = 0;
+        if (m_pacing == RealTime) {
+            due = wallStart + (meta.timestampUs - sourceStart);
+        } else if (m_pacing == FixedRate) {
+            due = wallStart + qint64(played * 1e6 / rate);
+        }
+        ++played;
+        {
+            RAZIEL_TRACE_SCOPE("pace");
+            for (qint64 wait = due - steadyMicros(); m_running && wait > 0; wait = due - steadyMicros()) {
+                usleep(static_cast<unsigned long>(std::min<qint64>(wait, 20000)));
+            }
+        }
+        {
+            // Waiting here means the consumer is behind
+            RAZIEL_TRACE_SCOPE("credit");
+            while (m_running && !m_credits.tryAcquire(1, 20)) {
+            }
+        }
+        if (!m_running) {
+            break;
+        }
+        QJsonObject params;
+        if (m_source->takeParams(params)) {
+            emit sourceParams(params);
+        }
+        RAZIEL_TRACE_SCOPE("emit");
+        RAZIEL_TRACE_FLOW_BEGIN("frame", meta.sequence);
+        meta.arrivalUs = steadyMicros();
+        if (nir.empty()) {
+            emit frameReady(frame, meta);
+        } else {
+            emit dualFrameReady(frame, nir, meta);
+        }
+    }
+}
+
+/**
+ * @brief runDual grabs both cameras back to back, matches the pair by
+ * timestamp, then decodes and emits it.
+ */
+void CaptureThread::runDual()
+{
+    while (m_running && m_capture.isOpened() && m_nirCapture.isOpened()) {
+        RAZIEL_TRACE_FRAME(m_sequence);
+        qint64 tRgb = 0, tNir = 0;
+        StageTimer grabTimer(StageProfiler::Capture);
+        if (!grabPair(tRgb, tNir)) {
+            break;
+        }
+        grabTimer.stop();
+        // grab() only latches the frames; decode after both are matched
+        cv::Mat rgb, nir;
+        StageTimer decodeTimer(StageProfiler::Decode);
+        if (!m_capture.retrieve(rgb) || !m_nirCapture.retrieve(nir)) {
+            break;
+        }
+        decodeTimer.setPixels(qint64(rgb.total() + nir.total()));
+        decodeTimer.stop();
+        FrameMeta meta;
+        meta.sequence = m_sequence++;
+        meta.timestampUs = tRgb;
+        meta.pairSkewUs = std::llabs(tRgb - tNir);
+        meta.arrivalUs = steadyMicros();
+        {
+            RAZIEL_TRACE_SCOPE("emit");
+            RAZIEL_TRACE_FLOW_BEGIN("frame", meta.sequence);
+            emit dualFrameReady(rgb, nir, meta);
+        }
+        msleep(1);
+    }
+}
+
+/**
+ * @brief grabPair grabs both cameras and re-grabs whichever lags until the
+ * pair is within the skew budget (or the retry limit is hit).
+ */
+bool CaptureThread::grabPair(qint64 &tRgb, qint64 &tNir)
+{
+    if (!m_capture.grab()) {
+        return false;
+    }
+    tRgb = steadyMicros();
+    if (!m_nirCapture.grab()) {
+        return false;
+    }
+    tNir = steadyMicros();
+
+    for (int tries = 0; tries < MAX_REGRAB && std::llabs(tRgb - tNir) > m_maxSkewUs; ++tries) {
+        if (tRgb < tNir) {
+            if (!m_capture.grab()) return false;
+            tRgb = steadyMicros();
+        } else {
+            if (!m_nirCapture.grab()) return false;
+            tNir = steadyMicros();
+        }
+    }
+    return true;
+}
+
 /**
  * @brief stop stops the capture loop and releases the camera.
  */
@@ -53,6 +282,9 @@ void CaptureThread::stop()
     if (m_capture.isOpened()) {
         m_capture.release();
     }
+    if (m_nirCapture.isOpened()) {
+        m_nirCapture.release();
+    }
 }
 
 /**
@@ -74,4 +306,4 @@ cv::VideoCapture CaptureThread::openCamera(int index)
     }
     // return empty capture if all backends fail
     return cv::VideoCapture();
-}
\ No newline at end of file
+}
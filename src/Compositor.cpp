@@ -0,0 +1,251 @@
+//------------------------------------------------------------------------------
+// src/Compositor.cpp
+//------------------------------------------------------------------------------
+
+#include "Compositor.h"
+#include "NDVIKernel.h"
+
+#include <algorithm>
+#include <limits>
+
+static constexpr int   BINS = 32;            // histogram bins per pixel
+static constexpr int   BIN_SHIFT = 3;        // 256 int8 levels / 32 bins
+static constexpr schar INVALID_Q = -128;     // ring marker for masked pixels
+static constexpr int   MAX_WINDOW = 255;     // longest sliding window
+
+/**
+ * @brief quantise maps NDVI in [-1, 1] onto int8 levels [-127, 127].
+ */
+static inline schar quantise(float v)
+{
+    int q = cvRound(v * 127.0f);
+    return schar(std::min(std::max(q, -127), 127));
+}
+
+/**
+ * @brief binOf returns the histogram bin of a quantised value.
+ */
+static inline int binOf(schar q)
+{
+    return (int(q) + 128) >> BIN_SHIFT;
+}
+
+/**
+ * @brief Compositor constructor, starts disabled over a whole pass.
+ */
+Compositor::Compositor()
+    : m_mode(Off)
+    , m_window(0)
+    , m_percentile(90.0f)
+    , m_hist()
+    , m_count()
+    , m_max()
+    , m_ring()
+    , m_head(0)
+    , m_frames(0)
+{}
+
+/**
+ * @brief setMode selects the composite. Max drops the histograms, so a
+ * later histogram mode starts over.
+ */
+void Compositor::setMode(Mode mode)
+{
+    if (mode != Off && (m_mode == Off || (usesHistograms(mode) && !m_count.empty() && m_hist.empty()))) {
+        reset();
+    }
+    if (mode == Max) {
+        m_hist.release();
+    }
+    m_mode = mode;
+}
+
+/**
+ * @brief setWindow sets the window length and resets the state.
+ */
+void Compositor::setWindow(int frames)
+{
+    m_window = std::min(std::max(frames, 0), MAX_WINDOW);
+    reset();
+}
+
+/**
+ * @brief setPercentile sets the percentile used by Percentile mode.
+ */
+void Compositor::setPercentile(float p)
+{
+    m_percentile = std::min(std::max(p, 0.0f), 100.0f);
+}
+
+/**
+ * @brief reset starts a new pass.
+ */
+void Compositor::reset()
+{
+    m_hist.release();
+    m_count.release();
+    m_max.release();
+    m_ring.clear();
+    m_head = 0;
+    m_frames = 0;
+}
+
+/**
+ * @brief initialise allocates zeroed state for a frame size: histograms
+ * for Median/Percentile, the running maximum for a whole pass and the
+ * int8 ring for a window.
+ */
+void Compositor::initialise(const cv::Size &size)
+{
+    reset();
+    if (usesHistograms(m_mode)) {
+        m_hist = cv::Mat::zeros(size.height, size.width * BINS, CV_16U);
+    }
+    m_count = cv::Mat::zeros(size, CV_16U);
+    if (m_window > 0) {
+        m_ring.assign(m_window, cv::Mat());
+        for (cv::Mat &slot : m_ring) {
+            slot = cv::Mat(size, CV_8S, cv::Scalar(INVALID_Q));
+        }
+    } else {
+        m_max = cv::Mat(size, CV_32F, cv::Scalar(-std::numeric_limits<float>::infinity()));
+    }
+}
+
+/**
+ * @brief add accumulates one NDVI frame in parallel row stripes. With a
+ * full sliding window the frame leaving the ring is subtracted first.
+ */
+void Compositor::add(const cv::Mat &ndvi, const cv::Mat &mask)
+{
+    if (m_mode == Off || ndvi.empty()) {
+        return;
+    }
+    CV_Assert(ndvi.type() == CV_32F && mask.type() == CV_8U && mask.size() == ndvi.size());
+    if (m_count.empty() || m_count.size() != ndvi.size()) {
+        initialise(ndvi.size());
+    }
+
+    const bool windowed = m_window > 0;
+    const bool full = windowed && m_frames >= m_window;
+    const bool histograms = !m_hist.empty();
+    cv::Mat slot = windowed ? m_ring[m_head] : cv::Mat();
+    const int cols = ndvi.cols;
+
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *nd = ndvi.ptr<float>(y);
+            const uchar *mk = mask.ptr<uchar>(y);
+            ushort *hist = histograms ? m_hist.ptr<ushort>(y) : nullptr;
+            ushort *cnt = m_count.ptr<ushort>(y);
+            float *mx = windowed ? nullptr : m_max.ptr<float>(y);
+            schar *ring = windowed ? slot.ptr<schar>(y) : nullptr;
+
+            for (int x = 0; x < cols; ++x) {
+                if (full && ring[x] != INVALID_Q) {
+                    if (hist) {
+                        hist[x * BINS + binOf(ring[x])]--;
+                    }
+                    cnt[x]--;
+                }
+                if (mk[x] != 0) {
+                    if (ring) ring[x] = INVALID_Q;
+                    continue;
+                }
+                const schar q = quantise(nd[x]);
+                if (ring) {
+                    ring[x] = q;
+                } else {
+                    mx[x] = std::max(mx[x], nd[x]);
+                }
+                if (!hist) {
+                    // Max only needs to know a valid sample exists
+                    cnt[x] = ushort(std::min<int>(cnt[x] + 1, std::numeric_limits<ushort>::max()));
+                    continue;
+                }
+                ushort *h = hist + x * BINS;
+                h[binOf(q)]++;
+                if (++cnt[x] == std::numeric_limits<ushort>::max()) {
+                    // Whole pass overflow: halve, keeping the distribution
+                    int total = 0;
+                    for (int b = 0; b < BINS; ++b) {
+                        h[b] >>= 1;
+                        total += h[b];
+                    }
+                    cnt[x] = ushort(total);
+                }
+            }
+        }
+    });
+
+    if (windowed) {
+        m_head = (m_head + 1) % m_window;
+        m_frames = std::min(m_frames + 1, m_window);
+    } else {
+        ++m_frames;
+    }
+}
+
+/**
+ * @brief composite evaluates the selected composite in parallel row
+ * stripes. Percentiles are interpolated inside the bin holding the
+ * target rank; windowed max scans the int8 ring.
+ */
+bool Compositor::composite(cv::Mat &ndvi, cv::Mat &mask) const
+{
+    if (m_mode == Off || m_frames == 0) {
+        return false;
+    }
+    const cv::Size size = m_count.size();
+    ndvi.create(size, CV_32F);
+    mask.create(size, CV_8U);
+    const float p = (m_mode == Median ? 50.0f : m_percentile) / 100.0f;
+    const int cols = size.width;
+
+    cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const ushort *hist = m_hist.empty() ? nullptr : m_hist.ptr<ushort>(y);
+            const ushort *cnt = m_count.ptr<ushort>(y);
+            const float *mx = m_max.empty() ? nullptr : m_max.ptr<float>(y);
+            float *out = ndvi.ptr<float>(y);
+            uchar *mk = mask.ptr<uchar>(y);
+
+            for (int x = 0; x < cols; ++x) {
+                if (cnt[x] == 0) {
+                    out[x] = 0.0f;
+                    mk[x] = MASK_LOW_SIGNAL;
+                    continue;
+                }
+                mk[x] = 0;
+
+                if (m_mode == Max) {
+                    if (m_ring.empty()) {
+                        out[x] = mx[x];
+                    } else {
+                        int best = INVALID_Q;
+                        for (const cv::Mat &slot : m_ring) {
+                            best = std::max(best, int(slot.ptr<schar>(y)[x]));
+                        }
+                        out[x] = best / 127.0f;
+                    }
+                    continue;
+                }
+
+                const ushort *h = hist + x * BINS;
+                float target = p * (cnt[x] - 1);
+                int cum = 0;
+                float q = 127.0f;
+                for (int b = 0; b < BINS; ++b) {
+                    if (h[b] > 0 && cum + h[b] > target) {
+                        float frac = (target - cum + 0.5f) / h[b];
+                        q = float((b << BIN_SHIFT) - 128) + frac * (1 << BIN_SHIFT);
+                        break;
+                    }
+                    cum += h[b];
+                }
+                out[x] = std::min(std::max(q / 127.0f, -1.0f), 1.0f);
+            }
+        }
+    });
+    return true;
+}
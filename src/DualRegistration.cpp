@@ -0,0 +1,223 @@
+//------------------------------------------------------------------------------
+// src/DualRegistration.cpp
+//------------------------------------------------------------------------------
+
+#include "DualRegistration.h"
+
+#include <cmath>
+#include <vector>
+
+static constexpr int MIN_FEATURE_INLIERS = 12;  // ORB fallback acceptance
+
+/**
+ * @brief DualRegistration constructor, starts uncalibrated (pure scaling).
+ */
+DualRegistration::DualRegistration()
+    : m_homography(cv::Matx33d::eye())
+    , m_calibrated(false)
+    , m_offsets()
+    , m_weights()
+    , m_mapOutSize()
+    , m_mapNirSize()
+    , m_mapNirStep(0)
+    , m_mapView(cv::Matx33d::eye())
+    , m_mapDirty(true)
+{}
+
+/**
+ * @brief estimate solves the NIR→RGB homography from one frame pair,
+ * trying the chessboard target first and ORB feature matches second.
+ */
+bool DualRegistration::estimate(const cv::Mat &rgb, const cv::Mat &nir, const cv::Size &pattern)
+{
+    if (rgb.empty() || nir.empty()) {
+        return false;
+    }
+    cv::Mat rgbGray, nirGray;
+    cv::cvtColor(rgb, rgbGray, cv::COLOR_BGR2GRAY);
+    cv::cvtColor(nir, nirGray, cv::COLOR_BGR2GRAY);
+
+    cv::Mat H;
+    if (!estimateChessboard(rgbGray, nirGray, pattern, H)
+        && !estimateFeatures(rgbGray, nirGray, H)) {
+        return false;
+    }
+    m_homography = cv::Matx33d(H.ptr<double>());
+    m_calibrated = true;
+    m_mapDirty = true;
+    return true;
+}
+
+/**
+ * @brief estimateChessboard fits H to matched chessboard corners.
+ */
+bool DualRegistration::estimateChessboard(const cv::Mat &rgbGray, const cv::Mat &nirGray,
+                                          const cv::Size &pattern, cv::Mat &H) const
+{
+    std::vector<cv::Point2f> rgbPts, nirPts;
+    int flags = cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE;
+    if (!cv::findChessboardCorners(rgbGray, pattern, rgbPts, flags)
+        || !cv::findChessboardCorners(nirGray, pattern, nirPts, flags)) {
+        return false;
+    }
+    cv::TermCriteria crit(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 30, 0.01);
+    cv::cornerSubPix(rgbGray, rgbPts, cv::Size(11, 11), cv::Size(-1, -1), crit);
+    cv::cornerSubPix(nirGray, nirPts, cv::Size(11, 11), cv::Size(-1, -1), crit);
+
+    H = cv::findHomography(nirPts, rgbPts, cv::RANSAC, 3.0);
+    return !H.empty();
+}
+
+/**
+ * @brief estimateFeatures fits H to cross-checked ORB matches.
+ */
+bool DualRegistration::estimateFeatures(const cv::Mat &rgbGray, const cv::Mat &nirGray,
+                                        cv::Mat &H) const
+{
+    cv::Ptr<cv::ORB> orb = cv::ORB::create(2000);
+    std::vector<cv::KeyPoint> rgbKp, nirKp;
+    cv::Mat rgbDesc, nirDesc;
+    orb->detectAndCompute(rgbGray, cv::noArray(), rgbKp, rgbDesc);
+    orb->detectAndCompute(nirGray, cv::noArray(), nirKp, nirDesc);
+    if (rgbDesc.empty() || nirDesc.empty()) {
+        return false;
+    }
+
+    cv::BFMatcher matcher(cv::NORM_HAMMING, true);
+    std::vector<cv::DMatch> matches;
+    matcher.match(nirDesc, rgbDesc, matches);
+    if (int(matches.size()) < MIN_FEATURE_INLIERS) {
+        return false;
+    }
+
+    std::vector<cv::Point2f> nirPts, rgbPts;
+    for (const cv::DMatch &m : matches) {
+        nirPts.push_back(nirKp[m.queryIdx].pt);
+        rgbPts.push_back(rgbKp[m.trainIdx].pt);
+    }
+    cv::Mat inliers;
+    H = cv::findHomography(nirPts, rgbPts, cv::RANSAC, 3.0, inliers);
+    return !H.empty() && cv::countNonZero(inliers) >= MIN_FEATURE_INLIERS;
+}
+
+/**
+ * @brief load reads a cached homography.
+ */
+bool DualRegistration::load(const std::string &path)
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        return false;
+    }
+    cv::Mat H;
+    fs["homography"] >> H;
+    if (H.rows != 3 || H.cols != 3) {
+        return false;
+    }
+    H.convertTo(H, CV_64F);
+    m_homography = cv::Matx33d(H.ptr<double>());
+    m_calibrated = true;
+    m_mapDirty = true;
+    return true;
+}
+
+/**
+ * @brief setHomography installs a known homography.
+ */
+void DualRegistration::setHomography(const cv::Matx33d &H)
+{
+    m_homography = H;
+    m_calibrated = true;
+    m_mapDirty = true;
+}
+
+/**
+ * @brief clear drops the homography; prepare() falls back to pure scaling.
+ */
+void DualRegistration::clear()
+{
+    m_homography = cv::Matx33d::eye();
+    m_calibrated = false;
+    m_mapDirty = true;
+}
+
+/**
+ * @brief save writes the homography cache.
+ */
+bool DualRegistration::save(const std::string &path) const
+{
+    if (!m_calibrated) {
+        return false;
+    }
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        return false;
+    }
+    fs << "homography" << cv::Mat(m_homography);
+    return true;
+}
+
+/**
+ * @brief prepare rebuilds the fixed-point sample map when the output size,
+ * NIR layout, view transform or homography changed.
+ *
+ * Each output pixel is taken through the view transform into RGB pixels,
+ * then through the inverse homography into NIR pixels. The NIR position is
+ * quantised to 1/256 pixel; the integer part becomes the byte offset of the
+ * red channel of the top-left sample, the fraction the bilinear weights.
+ */
+void DualRegistration::prepare(const cv::Size &outSize, const cv::Mat &nir,
+                               const cv::Matx33d &outToRgb)
+{
+    if (!m_mapDirty && outSize == m_mapOutSize && nir.size() == m_mapNirSize
+        && nir.step[0] == m_mapNirStep && outToRgb == m_mapView) {
+        return;
+    }
+
+    cv::Matx33d H = m_homography;
+    if (!m_calibrated) {
+        // Uncalibrated: assume both cameras see the same field, scaled
+        H = cv::Matx33d(double(outSize.width) / nir.cols, 0, 0,
+                        0, double(outSize.height) / nir.rows, 0,
+                        0, 0, 1);
+    }
+    const cv::Matx33d M = H.inv() * outToRgb;
+
+    m_offsets.create(outSize, CV_32S);
+    m_weights.create(outSize, CV_16U);
+    const int nirW = nir.cols;
+    const int nirH = nir.rows;
+    const size_t step = nir.step[0];
+
+    cv::parallel_for_(cv::Range(0, outSize.height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            int *off = m_offsets.ptr<int>(y);
+            ushort *wt = m_weights.ptr<ushort>(y);
+            for (int x = 0; x < outSize.width; ++x) {
+                cv::Vec3d p = M * cv::Vec3d(x, y, 1.0);
+                if (std::abs(p[2]) < 1e-12) {
+                    off[x] = -1;
+                    wt[x] = 0;
+                    continue;
+                }
+                long qx = std::lround(p[0] / p[2] * 256.0);
+                long qy = std::lround(p[1] / p[2] * 256.0);
+                long ix = qx >> 8;
+                long iy = qy >> 8;
+                if (ix < 0 || iy < 0 || ix + 1 >= nirW || iy + 1 >= nirH) {
+                    off[x] = -1;
+                    wt[x] = 0;
+                    continue;
+                }
+                off[x] = int(iy * step + ix * 3 + 2);
+                wt[x] = ushort((qx & 255) | ((qy & 255) << 8));
+            }
+        }
+    });
+
+    m_mapOutSize = outSize;
+    m_mapNirSize = nir.size();
+    m_mapNirStep = step;
+    m_mapView = outToRgb;
+    m_mapDirty = false;
+}
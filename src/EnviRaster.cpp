@@ -0,0 +1,183 @@
+//------------------------------------------------------------------------------
+// src/EnviRaster.cpp
+//------------------------------------------------------------------------------
+
+#include "EnviRaster.h"
+
+#include <QFileInfo>
+#include <QMap>
+#include <QTextStream>
+#include <algorithm>
+
+/**
+ * @brief EnviRaster constructor.
+ */
+EnviRaster::EnviRaster()
+    : m_file()
+    , m_error()
+    , m_width(0)
+    , m_height(0)
+    , m_bands(0)
+    , m_bytes(0)
+    , m_bigEndian(false)
+    , m_offset(0)
+    , m_interleave(BSQ)
+    , m_row()
+{}
+
+/**
+ * @brief open parses "key = value" header lines and opens the data file,
+ * looked up as the header path without its suffix, then with .raw/.img/.dat.
+ */
+bool EnviRaster::open(const QString &path)
+{
+    close();
+    QFileInfo info(path);
+    QString headerPath = info.suffix().compare("hdr", Qt::CaseInsensitive) == 0
+        ? path : path + ".hdr";
+    QString base = headerPath.left(headerPath.size() - 4);
+
+    QFile header(headerPath);
+    if (!header.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_error = QString("cannot open header %1").arg(headerPath);
+        return false;
+    }
+    QMap<QString, QString> keys;
+    QTextStream in(&header);
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        int eq = line.indexOf('=');
+        if (eq > 0) {
+            keys[line.left(eq).trimmed().toLower()] = line.mid(eq + 1).trimmed().toLower();
+        }
+    }
+
+    m_width = keys.value("samples").toInt();
+    m_height = keys.value("lines").toInt();
+    m_bands = keys.value("bands").toInt();
+    m_offset = keys.value("header offset", "0").toLongLong();
+    m_bigEndian = keys.value("byte order", "0").toInt() == 1;
+    const int dataType = keys.value("data type").toInt();
+    m_bytes = dataType == 1 ? 1 : dataType == 12 ? 2 : 0;
+    const QString interleave = keys.value("interleave", "bsq");
+    m_interleave = interleave == "bip" ? BIP : interleave == "bil" ? BIL : BSQ;
+    if (m_width <= 0 || m_height <= 0 || m_bands <= 0) {
+        m_error = "header lacks samples/lines/bands";
+        return false;
+    }
+    if (m_bytes == 0) {
+        m_error = QString("unsupported data type %1 (need 1 or 12)").arg(dataType);
+        return false;
+    }
+
+    QString dataPath = base;
+    for (const char *ext : {"", ".raw", ".img", ".dat", ".bsq", ".bil", ".bip"}) {
+        if (QFileInfo::exists(base + ext) && !QFileInfo(base + ext).isDir()) {
+            dataPath = base + ext;
+            break;
+        }
+    }
+    m_file.setFileName(dataPath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("cannot open data %1").arg(dataPath);
+        return false;
+    }
+    const qint64 need = m_offset + qint64(m_width) * m_height * m_bands * m_bytes;
+    if (m_file.size() < need) {
+        m_error = QString("data file too short (%1 < %2 bytes)").arg(m_file.size()).arg(need);
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief close closes the data file.
+ */
+void EnviRaster::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+/**
+ * @brief readSpan reads count consecutive samples starting at a sample index.
+ */
+bool EnviRaster::readSpan(qint64 sampleIndex, int count, std::vector<uchar> &buf)
+{
+    const qint64 bytes = qint64(count) * m_bytes;
+    buf.resize(size_t(bytes));
+    if (!m_file.seek(m_offset + sampleIndex * m_bytes)) {
+        return false;
+    }
+    return m_file.read(reinterpret_cast<char *>(buf.data()), bytes) == bytes;
+}
+
+/**
+ * @brief convertSpan converts count samples, stride samples apart, to 8 bits
+ * into every third byte of dst.
+ */
+void EnviRaster::convertSpan(const uchar *src, int count, int stride, uchar *dst, int shift) const
+{
+    if (m_bytes == 1) {
+        for (int i = 0; i < count; ++i) {
+            dst[3 * i] = src[i * stride];
+        }
+        return;
+    }
+    const int hi = m_bigEndian ? 0 : 1;
+    for (int i = 0; i < count; ++i) {
+        const uchar *s = src + 2 * i * stride;
+        int v = ((s[hi] << 8) | s[1 - hi]) >> shift;
+        dst[3 * i] = uchar(std::min(v, 255));
+    }
+}
+
+/**
+ * @brief readTile reads the NIR and visible bands of a window.
+ */
+bool EnviRaster::readTile(const cv::Rect &rect, int nirBand, int visBand, int shift, cv::Mat &bgr)
+{
+    const cv::Rect r = rect & cv::Rect(0, 0, m_width, m_height);
+    if (!m_file.isOpen() || r.empty() || nirBand < 0 || nirBand >= m_bands
+        || visBand < 0 || visBand >= m_bands) {
+        m_error = "bad window or band";
+        return false;
+    }
+    bgr.create(r.size(), CV_8UC3);
+    const qint64 W = m_width;
+    const qint64 H = m_height;
+    const qint64 B = m_bands;
+
+    for (int y = 0; y < r.height; ++y) {
+        const qint64 line = r.y + y;
+        uchar *dst = bgr.ptr<uchar>(y);
+        if (m_interleave == BIP) {
+            if (!readSpan((line * W + r.x) * B, int(r.width * B), m_row)) {
+                m_error = "read failed";
+                return false;
+            }
+            convertSpan(m_row.data() + visBand * m_bytes, r.width, int(B), dst + 0, shift);
+            convertSpan(m_row.data() + nirBand * m_bytes, r.width, int(B), dst + 2, shift);
+        } else {
+            const int bands[2] = { visBand, nirBand };
+            for (int k = 0; k < 2; ++k) {
+                const qint64 b = bands[k];
+                const qint64 index = m_interleave == BSQ
+                    ? (b * H + line) * W + r.x
+                    : (line * B + b) * W + r.x;
+                if (!readSpan(index, r.width, m_row)) {
+                    m_error = "read failed";
+                    return false;
+                }
+                convertSpan(m_row.data(), r.width, 1, dst + (k == 0 ? 0 : 2), shift);
+            }
+        }
+        // G mirrors the visible band so the tile also previews as an image
+        for (int x = 0; x < r.width; ++x) {
+            dst[3 * x + 1] = dst[3 * x];
+        }
+    }
+    return true;
+}
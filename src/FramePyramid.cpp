@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------
+// src/FramePyramid.cpp
+//------------------------------------------------------------------------------
+
+#include "FramePyramid.h"
+
+#include <algorithm>
+
+/**
+ * @brief FramePyramid constructor.
+ */
+FramePyramid::FramePyramid()
+    : m_source()
+    , m_levels(MAX_LEVELS)
+    , m_built(0)
+{}
+
+/**
+ * @brief reset points the pyramid at a new frame.
+ */
+void FramePyramid::reset(const cv::Mat &bgr)
+{
+    m_source = bgr;
+    m_built = 0;
+}
+
+/**
+ * @brief level returns grey level i, converting and downsampling lazily.
+ */
+const cv::Mat &FramePyramid::level(int i)
+{
+    CV_Assert(!m_source.empty() && i >= 0 && i < MAX_LEVELS);
+    if (m_built == 0) {
+        if (m_source.channels() == 1) {
+            m_source.copyTo(m_levels[0]);
+        } else {
+            cv::cvtColor(m_source, m_levels[0], cv::COLOR_BGR2GRAY);
+        }
+        m_built = 1;
+    }
+    for (; m_built <= i; ++m_built) {
+        cv::pyrDown(m_levels[m_built - 1], m_levels[m_built]);
+    }
+    return m_levels[i];
+}
+
+/**
+ * @brief levelSize returns the pyrDown size of level i.
+ */
+cv::Size FramePyramid::levelSize(int i) const
+{
+    cv::Size s = m_source.size();
+    for (int l = 0; l < i; ++l) {
+        s = cv::Size((s.width + 1) / 2, (s.height + 1) / 2);
+    }
+    return s;
+}
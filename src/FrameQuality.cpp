@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+// src/FrameQuality.cpp
+//------------------------------------------------------------------------------
+
+#include "FrameQuality.h"
+
+#include <algorithm>
+
+static constexpr int   STEP = 4;            // sampling stride in x and y
+static constexpr int   DARK_LEVEL = 16;     // luma at or below counts as dark
+static constexpr int   BRIGHT_LEVEL = 250;  // luma at or above counts as clipped
+static constexpr float MEAN_RATE = 0.05f;   // running sharpness mean update rate
+static constexpr int   RESEED_RUN = 15;     // blurred frames in a row that re-seed the mean
+
+/**
+ * @brief FrameQuality constructor, starts disabled.
+ */
+FrameQuality::FrameQuality()
+    : m_mode(Off)
+    , m_blurRatio(0.5f)
+    , m_maxDark(0.5f)
+    , m_maxBright(0.25f)
+    , m_meanSharp(-1.0f)
+    , m_blurRun(0)
+    , m_luma()
+{}
+
+/**
+ * @brief setMode selects the gate behaviour.
+ */
+void FrameQuality::setMode(Mode mode)
+{
+    m_mode = mode;
+    reset();
+}
+
+/**
+ * @brief setBlurRatio sets the relative blur threshold.
+ */
+void FrameQuality::setBlurRatio(float ratio)
+{
+    m_blurRatio = std::min(std::max(ratio, 0.0f), 1.0f);
+}
+
+/**
+ * @brief setMaxDark sets the dark tail limit.
+ */
+void FrameQuality::setMaxDark(float fraction)
+{
+    m_maxDark = std::min(std::max(fraction, 0.0f), 1.0f);
+}
+
+/**
+ * @brief setMaxBright sets the clipped tail limit.
+ */
+void FrameQuality::setMaxBright(float fraction)
+{
+    m_maxBright = std::min(std::max(fraction, 0.0f), 1.0f);
+}
+
+/**
+ * @brief reset forgets the running sharpness mean.
+ */
+void FrameQuality::reset()
+{
+    m_meanSharp = -1.0f;
+    m_blurRun = 0;
+}
+
+/**
+ * @brief assess gathers the luma grid with the exposure tails in one strided
+ * pass, then takes the Laplacian variance over the grid.
+ */
+bool FrameQuality::assess(const cv::Mat &bgr, FrameMeta &meta)
+{
+    meta.qualityFlags = 0;
+    if (m_mode == Off || bgr.empty()) {
+        return true;
+    }
+    CV_Assert(bgr.type() == CV_8UC3);
+
+    const int gw = bgr.cols / STEP;
+    const int gh = bgr.rows / STEP;
+    if (gw < 3 || gh < 3) {
+        return true;
+    }
+    m_luma.create(gh, gw, CV_8U);
+    int dark = 0;
+    int bright = 0;
+    for (int gy = 0; gy < gh; ++gy) {
+        const uchar *src = bgr.ptr<uchar>(gy * STEP + STEP / 2);
+        uchar *dst = m_luma.ptr<uchar>(gy);
+        for (int gx = 0; gx < gw; ++gx) {
+            const uchar *p = src + (gx * STEP + STEP / 2) * 3;
+            int y = (p[0] + 2 * p[1] + p[2]) >> 2;
+            dst[gx] = uchar(y);
+            dark += y <= DARK_LEVEL;
+            bright += y >= BRIGHT_LEVEL;
+        }
+    }
+
+    // Variance of the 4-neighbour Laplacian over the interior of the grid
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (int gy = 1; gy < gh - 1; ++gy) {
+        const uchar *up = m_luma.ptr<uchar>(gy - 1);
+        const uchar *row = m_luma.ptr<uchar>(gy);
+        const uchar *down = m_luma.ptr<uchar>(gy + 1);
+        long long rs = 0;
+        long long rsq = 0;
+        for (int gx = 1; gx < gw - 1; ++gx) {
+            int lap = 4 * row[gx] - row[gx - 1] - row[gx + 1] - up[gx] - down[gx];
+            rs += lap;
+            rsq += lap * lap;
+        }
+        sum += double(rs);
+        sumSq += double(rsq);
+    }
+    const double n = double(gw - 2) * double(gh - 2);
+    const double mean = sum / n;
+    const float sharpness = float(sumSq / n - mean * mean);
+    const float samples = float(gw) * float(gh);
+
+    meta.sharpness = sharpness;
+    meta.darkFraction = dark / samples;
+    meta.brightFraction = bright / samples;
+    if (meta.darkFraction > m_maxDark) {
+        meta.qualityFlags |= QUALITY_DARK;
+    }
+    if (meta.brightFraction > m_maxBright) {
+        meta.qualityFlags |= QUALITY_BRIGHT;
+    }
+    if (m_meanSharp > 0.0f && sharpness < m_blurRatio * m_meanSharp) {
+        meta.qualityFlags |= QUALITY_BLUR;
+    }
+
+    // Only passed frames feed the reference, so a blurred run cannot lower
+    // it; a run longer than motion blur lasts is a new scene, and the mean
+    // restarts from it so the following frames can pass
+    if (meta.qualityFlags & QUALITY_BLUR) {
+        if (++m_blurRun >= RESEED_RUN) {
+            m_meanSharp = sharpness;
+            m_blurRun = 0;
+        }
+    } else {
+        m_blurRun = 0;
+    }
+    if (meta.qualityFlags == 0) {
+        m_meanSharp = m_meanSharp < 0.0f
+            ? sharpness : m_meanSharp + MEAN_RATE * (sharpness - m_meanSharp);
+    }
+    return meta.qualityFlags == 0;
+}
@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+// src/GeometryRemap.cpp
+//------------------------------------------------------------------------------
+
+#include "GeometryRemap.h"
+
+#include <algorithm>
+
+/**
+ * @brief GeometryRemap constructor, starts without intrinsics.
+ */
+GeometryRemap::GeometryRemap()
+    : m_cameraMatrix()
+    , m_distCoeffs()
+    , m_calibSize()
+    , m_undistort(true)
+    , m_map1()
+    , m_map2()
+    , m_mapSize()
+    , m_mapZoom(1.0)
+    , m_mapPanX(0.0)
+    , m_mapPanY(0.0)
+    , m_mapUndistort(false)
+    , m_dirty(true)
+{}
+
+/**
+ * @brief loadIntrinsics reads camera_matrix / distortion_coefficients.
+ * @param path OpenCV FileStorage file (YAML or XML)
+ * @return true on success; the previous intrinsics are kept on failure
+ */
+bool GeometryRemap::loadIntrinsics(const std::string &path)
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        return false;
+    }
+    cv::Mat K, D;
+    fs["camera_matrix"] >> K;
+    fs["distortion_coefficients"] >> D;
+    int w = 0, h = 0;
+    if (!fs["image_width"].empty()) fs["image_width"] >> w;
+    if (!fs["image_height"].empty()) fs["image_height"] >> h;
+    return setIntrinsics(K, D, cv::Size(w, h));
+}
+
+/**
+ * @brief setIntrinsics installs a camera matrix and distortion model.
+ */
+bool GeometryRemap::setIntrinsics(const cv::Mat &cameraMatrix, const cv::Mat &distCoeffs,
+                                  const cv::Size &calibSize)
+{
+    if (cameraMatrix.rows != 3 || cameraMatrix.cols != 3) {
+        return false;
+    }
+    cameraMatrix.convertTo(m_cameraMatrix, CV_64F);
+    if (distCoeffs.empty()) {
+        m_distCoeffs = cv::Mat::zeros(1, 5, CV_64F);
+    } else {
+        distCoeffs.reshape(1, 1).convertTo(m_distCoeffs, CV_64F);
+    }
+    m_calibSize = calibSize;
+    m_dirty = true;
+    return true;
+}
+
+/**
+ * @brief clearIntrinsics drops the intrinsics, leaving zoom/pan only.
+ */
+void GeometryRemap::clearIntrinsics()
+{
+    m_cameraMatrix.release();
+    m_distCoeffs.release();
+    m_calibSize = cv::Size();
+    m_dirty = true;
+}
+
+/**
+ * @brief setUndistort enables or disables lens undistortion.
+ */
+void GeometryRemap::setUndistort(bool enabled)
+{
+    m_undistort = enabled;
+}
+
+/**
+ * @brief rebuild computes the combined undistort + zoom + pan map.
+ *
+ * The output view is modelled as an ideal pinhole camera whose focal
+ * length is scaled by the zoom and whose principal point is shifted by
+ * the pan. initUndistortRectifyMap then maps every output pixel through
+ * that camera and the real lens model back to the source frame. Without
+ * intrinsics a synthetic distortion-free camera is used, which reduces to
+ * the plain crop-and-scale zoom.
+ */
+void GeometryRemap::rebuild(const cv::Size &size, double zoom, double panX, double panY)
+{
+    bool undistort = m_undistort && hasIntrinsics();
+
+    cv::Mat K, D;
+    if (undistort) {
+        // Rescale intrinsics if calibrated at a different resolution
+        K = m_cameraMatrix.clone();
+        if (m_calibSize.width > 0 && m_calibSize.height > 0) {
+            double sx = double(size.width) / m_calibSize.width;
+            double sy = double(size.height) / m_calibSize.height;
+            K.at<double>(0, 0) *= sx;
+            K.at<double>(0, 2) *= sx;
+            K.at<double>(1, 1) *= sy;
+            K.at<double>(1, 2) *= sy;
+        }
+        D = m_distCoeffs;
+    } else {
+        double f = std::max(size.width, size.height);
+        K = (cv::Mat_<double>(3, 3) << f, 0, size.width / 2.0,
+                                       0, f, size.height / 2.0,
+                                       0, 0, 1);
+        D = cv::Mat::zeros(1, 5, CV_64F);
+    }
+
+    // Centre of the zoom window in source pixels, kept inside the frame
+    double travelX = (size.width  - size.width  / zoom) / 2.0;
+    double travelY = (size.height - size.height / zoom) / 2.0;
+    double centreX = size.width  / 2.0 + panX * travelX;
+    double centreY = size.height / 2.0 + panY * travelY;
+
+    double fx = K.at<double>(0, 0);
+    double fy = K.at<double>(1, 1);
+    double cx = K.at<double>(0, 2);
+    double cy = K.at<double>(1, 2);
+    cv::Mat newK = (cv::Mat_<double>(3, 3)
+        << fx * zoom, 0, size.width  / 2.0 - zoom * (centreX - cx),
+           0, fy * zoom, size.height / 2.0 - zoom * (centreY - cy),
+           0, 0, 1);
+
+    cv::initUndistortRectifyMap(K, D, cv::Mat(), newK, size, CV_16SC2, m_map1, m_map2);
+
+    m_mapSize = size;
+    m_mapZoom = zoom;
+    m_mapPanX = panX;
+    m_mapPanY = panY;
+    m_mapUndistort = undistort;
+    m_dirty = false;
+}
+
+/**
+ * @brief viewTransform returns the output→source transform of the plain
+ * zoom/pan view: source = centre + (output - frameCentre) / zoom.
+ */
+cv::Matx33d GeometryRemap::viewTransform(const cv::Size &size, double zoom, double panX, double panY)
+{
+    zoom = std::max(zoom, 1.0);
+    double travelX = (size.width  - size.width  / zoom) / 2.0;
+    double travelY = (size.height - size.height / zoom) / 2.0;
+    double centreX = size.width  / 2.0 + panX * travelX;
+    double centreY = size.height / 2.0 + panY * travelY;
+    return cv::Matx33d(1.0 / zoom, 0, centreX - size.width  / (2.0 * zoom),
+                       0, 1.0 / zoom, centreY - size.height / (2.0 * zoom),
+                       0, 0, 1);
+}
+
+/**
+ * @brief apply resamples src into dst with undistortion, zoom and pan.
+ * The identity case (no undistortion, 1x zoom) passes src through.
+ */
+void GeometryRemap::apply(const cv::Mat &src, cv::Mat &dst, double zoom, double panX, double panY)
+{
+    bool undistort = m_undistort && hasIntrinsics();
+    if (!undistort && zoom <= 1.0) {
+        dst = src;
+        return;
+    }
+
+    if (m_dirty || src.size() != m_mapSize || zoom != m_mapZoom
+        || panX != m_mapPanX || panY != m_mapPanY || undistort != m_mapUndistort) {
+        rebuild(src.size(), zoom, panX, panY);
+    }
+    cv::remap(src, dst, m_map1, m_map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+}
@@ -0,0 +1,270 @@
+//------------------------------------------------------------------------------
+// src/GuidedFilter.cpp
+//------------------------------------------------------------------------------
+
+#include "GuidedFilter.h"
+
+#include <algorithm>
+#include <vector>
+
+static constexpr int STRIP = 64;  // column strip width of the vertical pass
+
+/**
+ * @brief GuidedFilter constructor.
+ * @param radius box radius in pixels
+ * @param eps regularisation
+ */
+GuidedFilter::GuidedFilter(int radius, float eps)
+    : m_radius(std::max(radius, 1))
+    , m_eps(eps)
+{}
+
+/**
+ * @brief setRadius sets the box radius in pixels.
+ */
+void GuidedFilter::setRadius(int radius)
+{
+    m_radius = std::max(radius, 1);
+}
+
+/**
+ * @brief setEps sets the edge-preservation regularisation.
+ */
+void GuidedFilter::setEps(float eps)
+{
+    m_eps = eps;
+}
+
+/**
+ * @brief boxFilter computes the normalised box mean with running sums.
+ *
+ * The row pass slides a window sum along every row; the column pass slides
+ * a row of window sums down each vertical strip. Each output pixel costs
+ * one add and one subtract per pass whatever the radius. Sums are kept in
+ * double so long rows do not drift.
+ */
+void GuidedFilter::boxFilter(const cv::Mat &src, cv::Mat &dst, int radius, cv::Mat &tmp)
+{
+    CV_Assert(src.type() == CV_32F && src.data != dst.data);
+    const int rows = src.rows;
+    const int cols = src.cols;
+    tmp.create(src.size(), CV_32F);
+    dst.create(src.size(), CV_32F);
+
+    // Horizontal window sums
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *s = src.ptr<float>(y);
+            float *t = tmp.ptr<float>(y);
+            double sum = 0.0;
+            for (int i = 0; i <= std::min(radius, cols - 1); ++i) {
+                sum += s[i];
+            }
+            for (int x = 0; x < cols; ++x) {
+                t[x] = float(sum);
+                int add = x + radius + 1;
+                int sub = x - radius;
+                if (add < cols) sum += s[add];
+                if (sub >= 0) sum -= s[sub];
+            }
+        }
+    });
+
+    // Vertical window sums over column strips, normalised by the clipped area
+    const int strips = (cols + STRIP - 1) / STRIP;
+    cv::parallel_for_(cv::Range(0, strips), [&](const cv::Range &range) {
+        std::vector<double> acc(STRIP);
+        std::vector<float> invWx(STRIP);
+        for (int s = range.start; s < range.end; ++s) {
+            int x0 = s * STRIP;
+            int n = std::min(STRIP, cols - x0);
+            for (int i = 0; i < n; ++i) {
+                int x = x0 + i;
+                int wx = std::min(x + radius, cols - 1) - std::max(x - radius, 0) + 1;
+                invWx[i] = 1.0f / wx;
+            }
+            std::fill(acc.begin(), acc.end(), 0.0);
+            for (int yy = 0; yy <= std::min(radius, rows - 1); ++yy) {
+                const float *t = tmp.ptr<float>(yy) + x0;
+                for (int i = 0; i < n; ++i) acc[i] += t[i];
+            }
+            for (int y = 0; y < rows; ++y) {
+                int wy = std::min(y + radius, rows - 1) - std::max(y - radius, 0) + 1;
+                float invWy = 1.0f / wy;
+                float *d = dst.ptr<float>(y) + x0;
+                for (int i = 0; i < n; ++i) {
+                    d[i] = float(acc[i]) * invWx[i] * invWy;
+                }
+                int add = y + radius + 1;
+                int sub = y - radius;
+                if (add < rows) {
+                    const float *t = tmp.ptr<float>(add) + x0;
+                    for (int i = 0; i < n; ++i) acc[i] += t[i];
+                }
+                if (sub >= 0) {
+                    const float *t = tmp.ptr<float>(sub) + x0;
+                    for (int i = 0; i < n; ++i) acc[i] -= t[i];
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief apply runs the grey-guide guided filter (He et al.) on the NDVI
+ * plane in place:
+ *   a = cov(I, p) / (var(I) + eps),  b = mean(p) - a * mean(I),
+ *   q = mean(a) * I + mean(b).
+ */
+void GuidedFilter::apply(const cv::Mat &guide, cv::Mat &ndvi, const cv::Mat &mask)
+{
+    CV_Assert(ndvi.type() == CV_32F && guide.size() == ndvi.size());
+    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == ndvi.size()));
+
+    if (guide.channels() == 1) {
+        guide.convertTo(m_I, CV_32F, 1.0 / 255.0);
+    } else {
+        cv::Mat gray;
+        cv::cvtColor(guide, gray, cv::COLOR_BGR2GRAY);
+        gray.convertTo(m_I, CV_32F, 1.0 / 255.0);
+    }
+    if (!mask.empty() && cv::countNonZero(mask) > 0) {
+        applyMasked(ndvi, mask);
+        return;
+    }
+
+    boxFilter(m_I, m_meanI, m_radius, m_tmp);
+    boxFilter(ndvi, m_meanP, m_radius, m_tmp);
+    cv::multiply(m_I, m_I, m_prod);
+    boxFilter(m_prod, m_corrI, m_radius, m_tmp);
+    cv::multiply(m_I, ndvi, m_prod);
+    boxFilter(m_prod, m_corrIP, m_radius, m_tmp);
+
+    m_a.create(ndvi.size(), CV_32F);
+    m_b.create(ndvi.size(), CV_32F);
+    const float eps = m_eps;
+    const int cols = ndvi.cols;
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *mI = m_meanI.ptr<float>(y);
+            const float *mP = m_meanP.ptr<float>(y);
+            const float *cI = m_corrI.ptr<float>(y);
+            const float *cIP = m_corrIP.ptr<float>(y);
+            float *a = m_a.ptr<float>(y);
+            float *b = m_b.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                float var = cI[x] - mI[x] * mI[x];
+                float cov = cIP[x] - mI[x] * mP[x];
+                a[x] = cov / (var + eps);
+                b[x] = mP[x] - a[x] * mI[x];
+            }
+        }
+    });
+
+    boxFilter(m_a, m_meanA, m_radius, m_tmp);
+    boxFilter(m_b, m_meanB, m_radius, m_tmp);
+
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *I = m_I.ptr<float>(y);
+            const float *mA = m_meanA.ptr<float>(y);
+            const float *mB = m_meanB.ptr<float>(y);
+            float *q = ndvi.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                q[x] = mA[x] * I[x] + mB[x];
+            }
+        }
+    });
+}
+
+/**
+ * @brief applyMasked is apply() with every mean weighted by validity W:
+ * mean(x) = box(W x) / box(W). The window coefficients are averaged with
+ * the valid fraction of their window as weight, and windows without a
+ * valid pixel drop out. Masked pixels keep their input value.
+ */
+void GuidedFilter::applyMasked(cv::Mat &ndvi, const cv::Mat &mask)
+{
+    const cv::Size size = ndvi.size();
+    const int cols = ndvi.cols;
+    m_W.create(size, CV_32F);
+    m_a.create(size, CV_32F);
+    m_b.create(size, CV_32F);
+    m_prod.create(size, CV_32F);
+
+    // Weighted inputs; masked NDVI may hold anything, so it is never read
+    cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar *mk = mask.ptr<uchar>(y);
+            const float *I = m_I.ptr<float>(y);
+            const float *p = ndvi.ptr<float>(y);
+            float *w = m_W.ptr<float>(y);
+            float *wI = m_a.ptr<float>(y);
+            float *wP = m_b.ptr<float>(y);
+            float *wII = m_prod.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                const bool valid = mk[x] == 0;
+                w[x] = valid ? 1.0f : 0.0f;
+                wI[x] = valid ? I[x] : 0.0f;
+                wP[x] = valid ? p[x] : 0.0f;
+                wII[x] = valid ? I[x] * I[x] : 0.0f;
+            }
+        }
+    });
+    boxFilter(m_W, m_meanW, m_radius, m_tmp);
+    boxFilter(m_a, m_meanI, m_radius, m_tmp);
+    boxFilter(m_b, m_meanP, m_radius, m_tmp);
+    boxFilter(m_prod, m_corrI, m_radius, m_tmp);
+    cv::multiply(m_a, m_b, m_prod);  // W I p, as W is 0 or 1
+    boxFilter(m_prod, m_corrIP, m_radius, m_tmp);
+
+    // Coefficients pre-multiplied by their window weight for the second mean
+    const float eps = m_eps;
+    cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *mW = m_meanW.ptr<float>(y);
+            const float *mI = m_meanI.ptr<float>(y);
+            const float *mP = m_meanP.ptr<float>(y);
+            const float *cI = m_corrI.ptr<float>(y);
+            const float *cIP = m_corrIP.ptr<float>(y);
+            float *a = m_a.ptr<float>(y);
+            float *b = m_b.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                const float wk = mW[x];
+                if (wk < 1e-6f) {
+                    a[x] = 0.0f;
+                    b[x] = 0.0f;
+                    continue;
+                }
+                const float inv = 1.0f / wk;
+                const float meanI = mI[x] * inv;
+                const float meanP = mP[x] * inv;
+                const float var = cI[x] * inv - meanI * meanI;
+                const float cov = cIP[x] * inv - meanI * meanP;
+                const float ak = cov / (var + eps);
+                a[x] = wk * ak;
+                b[x] = wk * (meanP - ak * meanI);
+            }
+        }
+    });
+    boxFilter(m_a, m_meanA, m_radius, m_tmp);
+    boxFilter(m_b, m_meanB, m_radius, m_tmp);
+    boxFilter(m_meanW, m_meanWk, m_radius, m_tmp);
+
+    cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar *mk = mask.ptr<uchar>(y);
+            const float *I = m_I.ptr<float>(y);
+            const float *mA = m_meanA.ptr<float>(y);
+            const float *mB = m_meanB.ptr<float>(y);
+            const float *mWk = m_meanWk.ptr<float>(y);
+            float *q = ndvi.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                // A valid pixel lies in its own window, so mWk > 0
+                if (mk[x] == 0) {
+                    q[x] = (mA[x] * I[x] + mB[x]) / mWk[x];
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,249 @@
+//------------------------------------------------------------------------------
+// src/IsolineExtractor.cpp
+//------------------------------------------------------------------------------
+
+#include "IsolineExtractor.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * @brief Segment is one marching-squares segment; each end is identified
+ * by the cell edge it lies on.
+ */
+struct Segment
+{
+    long long   edge[2];
+    cv::Point2f pt[2];
+};
+
+// Cell edges: 0 top, 1 right, 2 bottom, 3 left. Up to two segments per case,
+// -1 terminated. Saddles (5, 10) are resolved separately.
+const int CASES[16][4] = {
+    {-1, -1, -1, -1}, { 3,  2, -1, -1}, { 2,  1, -1, -1}, { 3,  1, -1, -1},
+    { 0,  1, -1, -1}, {-1, -1, -1, -1}, { 0,  2, -1, -1}, { 3,  0, -1, -1},
+    { 3,  0, -1, -1}, { 0,  2, -1, -1}, {-1, -1, -1, -1}, { 0,  1, -1, -1},
+    { 3,  1, -1, -1}, { 2,  1, -1, -1}, { 3,  2, -1, -1}, {-1, -1, -1, -1}
+};
+
+} // namespace
+
+/**
+ * @brief IsolineExtractor constructor.
+ * @param downsample downsampling factor applied before the sweep
+ */
+IsolineExtractor::IsolineExtractor(int downsample)
+    : m_levels({0.2f, 0.4f, 0.6f})
+    , m_downsample(std::max(downsample, 1))
+{}
+
+/**
+ * @brief setLevels sets the NDVI levels to extract.
+ */
+void IsolineExtractor::setLevels(const std::vector<float> &levels)
+{
+    m_levels = levels;
+}
+
+/**
+ * @brief setDownsample sets the downsampling factor.
+ */
+void IsolineExtractor::setDownsample(int factor)
+{
+    m_downsample = std::max(factor, 1);
+}
+
+/**
+ * @brief extract runs the marching-squares sweep for all levels in
+ * parallel row stripes, then joins each level's segments into polylines.
+ * A downsampled sample is masked if any pixel of its block is.
+ */
+std::vector<Isoline> IsolineExtractor::extract(const cv::Mat &ndvi, const cv::Mat &mask)
+{
+    std::vector<Isoline> result;
+    if (ndvi.empty() || m_levels.empty()) {
+        return result;
+    }
+    CV_Assert(ndvi.type() == CV_32F);
+    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == ndvi.size()));
+
+    const int f = m_downsample;
+    if (f > 1) {
+        cv::resize(ndvi, m_small, cv::Size(ndvi.cols / f, ndvi.rows / f), 0, 0, cv::INTER_AREA);
+    } else {
+        m_small = ndvi;
+    }
+    const int W = m_small.cols;
+    const int H = m_small.rows;
+    if (W < 2 || H < 2) {
+        return result;
+    }
+    const bool masked = !mask.empty();
+    if (masked && f > 1) {
+        m_smallMask.create(H, W, CV_8U);
+        cv::parallel_for_(cv::Range(0, H), [&](const cv::Range &range) {
+            for (int y = range.start; y < range.end; ++y) {
+                uchar *out = m_smallMask.ptr<uchar>(y);
+                std::fill(out, out + W, uchar(0));
+                for (int dy = 0; dy < f; ++dy) {
+                    const uchar *mk = mask.ptr<uchar>(y * f + dy);
+                    for (int x = 0; x < W; ++x) {
+                        for (int dx = 0; dx < f; ++dx) {
+                            out[x] |= mk[x * f + dx];
+                        }
+                    }
+                }
+            }
+        });
+    } else if (masked) {
+        m_smallMask = mask;
+    }
+
+    const int levelCount = int(m_levels.size());
+    const int cellRows = H - 1;
+    const int stripes = std::min(cellRows, std::max(1, cv::getNumThreads() * 4));
+    // segments[stripe][level]
+    std::vector<std::vector<std::vector<Segment>>> segments(
+        stripes, std::vector<std::vector<Segment>>(levelCount));
+
+    // Small-grid sample to full-resolution pixel centre
+    auto toFull = [f](float x, float y) {
+        return cv::Point2f((x + 0.5f) * f - 0.5f, (y + 0.5f) * f - 0.5f);
+    };
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range &range) {
+        for (int s = range.start; s < range.end; ++s) {
+            int y0 = int((long long)cellRows * s / stripes);
+            int y1 = int((long long)cellRows * (s + 1) / stripes);
+            for (int y = y0; y < y1; ++y) {
+                const float *top = m_small.ptr<float>(y);
+                const float *bot = m_small.ptr<float>(y + 1);
+                const uchar *mTop = masked ? m_smallMask.ptr<uchar>(y) : nullptr;
+                const uchar *mBot = masked ? m_smallMask.ptr<uchar>(y + 1) : nullptr;
+                for (int x = 0; x < W - 1; ++x) {
+                    if (mTop && (mTop[x] | mTop[x + 1] | mBot[x] | mBot[x + 1])) {
+                        continue;
+                    }
+                    const float v[4] = { top[x], top[x + 1], bot[x + 1], bot[x] };  // tl tr br bl
+                    const float lo = std::min(std::min(v[0], v[1]), std::min(v[2], v[3]));
+                    const float hi = std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+
+                    // Edge ids: horizontal edge (x,y)-(x+1,y) even, vertical (x,y)-(x,y+1) odd
+                    const long long edgeId[4] = {
+                        (((long long)y * W + x) << 1),
+                        (((long long)y * W + x + 1) << 1) | 1,
+                        (((long long)(y + 1) * W + x) << 1),
+                        (((long long)y * W + x) << 1) | 1
+                    };
+
+                    for (int l = 0; l < levelCount; ++l) {
+                        const float L = m_levels[l];
+                        if (L < lo || L > hi) continue;
+                        int c = (v[0] >= L ? 8 : 0) | (v[1] >= L ? 4 : 0)
+                              | (v[2] >= L ? 2 : 0) | (v[3] >= L ? 1 : 0);
+                        if (c == 0 || c == 15) continue;
+
+                        auto edgePoint = [&](int e) {
+                            // Corner indices at each end of edge e
+                            static const int ends[4][2] = { {0, 1}, {1, 2}, {3, 2}, {0, 3} };
+                            static const float cx[4] = { 0.f, 1.f, 1.f, 0.f };
+                            static const float cy[4] = { 0.f, 0.f, 1.f, 1.f };
+                            int a = ends[e][0], b = ends[e][1];
+                            float t = (L - v[a]) / (v[b] - v[a]);
+                            return toFull(x + cx[a] + t * (cx[b] - cx[a]),
+                                          y + cy[a] + t * (cy[b] - cy[a]));
+                        };
+                        auto emit = [&](int e0, int e1) {
+                            Segment seg;
+                            seg.edge[0] = edgeId[e0];
+                            seg.edge[1] = edgeId[e1];
+                            seg.pt[0] = edgePoint(e0);
+                            seg.pt[1] = edgePoint(e1);
+                            segments[s][l].push_back(seg);
+                        };
+
+                        if (c == 5 || c == 10) {
+                            // Saddle: decide by the cell centre
+                            bool centreHigh = (v[0] + v[1] + v[2] + v[3]) * 0.25f >= L;
+                            if ((c == 5) == centreHigh) {
+                                emit(3, 0);
+                                emit(2, 1);
+                            } else {
+                                emit(0, 1);
+                                emit(3, 2);
+                            }
+                        } else {
+                            emit(CASES[c][0], CASES[c][1]);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // Join the segments of each level through their shared edges
+    for (int l = 0; l < levelCount; ++l) {
+        std::vector<Segment> segs;
+        for (int s = 0; s < stripes; ++s) {
+            segs.insert(segs.end(), segments[s][l].begin(), segments[s][l].end());
+        }
+        std::unordered_map<long long, std::array<int, 2>> adj;
+        adj.reserve(segs.size() * 2);
+        for (int i = 0; i < int(segs.size()); ++i) {
+            for (int e = 0; e < 2; ++e) {
+                auto it = adj.emplace(segs[i].edge[e], std::array<int, 2>{ -1, -1 }).first;
+                (it->second[0] < 0 ? it->second[0] : it->second[1]) = i;
+            }
+        }
+        auto neighbour = [&](long long edge, int cur) {
+            const std::array<int, 2> &a = adj[edge];
+            return a[0] == cur ? a[1] : a[0];
+        };
+
+        std::vector<bool> visited(segs.size(), false);
+        for (int start = 0; start < int(segs.size()); ++start) {
+            if (visited[start]) continue;
+            visited[start] = true;
+            std::deque<cv::Point2f> chain = { segs[start].pt[0], segs[start].pt[1] };
+
+            // Walk forward from the far end
+            int cur = start;
+            long long edge = segs[start].edge[1];
+            for (int next = neighbour(edge, cur); next >= 0 && !visited[next];
+                 next = neighbour(edge, cur)) {
+                visited[next] = true;
+                int far = segs[next].edge[0] == edge ? 1 : 0;
+                chain.push_back(segs[next].pt[far]);
+                edge = segs[next].edge[far];
+                cur = next;
+            }
+            bool closed = edge == segs[start].edge[0] && chain.size() > 3;
+            if (closed) {
+                chain.pop_back();  // repeats the first vertex
+            } else {
+                // Walk backward from the near end
+                cur = start;
+                edge = segs[start].edge[0];
+                for (int next = neighbour(edge, cur); next >= 0 && !visited[next];
+                     next = neighbour(edge, cur)) {
+                    visited[next] = true;
+                    int far = segs[next].edge[0] == edge ? 1 : 0;
+                    chain.push_front(segs[next].pt[far]);
+                    edge = segs[next].edge[far];
+                    cur = next;
+                }
+            }
+
+            Isoline line;
+            line.level = m_levels[l];
+            line.points.assign(chain.begin(), chain.end());
+            line.closed = closed;
+            result.push_back(std::move(line));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+// src/KeyframeSelector.cpp
+//------------------------------------------------------------------------------
+
+#include "KeyframeSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief KeyframeSelector constructor.
+ * @param overlap overlap fraction that triggers a new keyframe
+ * @param workWidth approximate width of the correlated frames
+ */
+KeyframeSelector::KeyframeSelector(float overlap, int workWidth)
+    : m_overlap(std::min(std::max(overlap, 0.0f), 0.95f))
+    , m_workWidth(std::max(workWidth, 32))
+    , m_minResponse(0.05)
+    , m_level(0)
+    , m_frameSize()
+    , m_prev()
+    , m_curr()
+    , m_window()
+    , m_accum()
+    , m_keyShift()
+    , m_shift()
+    , m_response(0.0)
+    , m_pending(true)
+    , m_lost(false)
+    , m_keyTrusted(true)
+    , m_frames(0)
+    , m_keyframes(0)
+{}
+
+/**
+ * @brief setOverlap sets the overlap fraction.
+ */
+void KeyframeSelector::setOverlap(float overlap)
+{
+    m_overlap = std::min(std::max(overlap, 0.0f), 0.95f);
+}
+
+/**
+ * @brief setMinResponse sets the trusted peak threshold.
+ */
+void KeyframeSelector::setMinResponse(double response)
+{
+    m_minResponse = response;
+}
+
+/**
+ * @brief reset forgets the previous frame.
+ */
+void KeyframeSelector::reset()
+{
+    m_prev.release();
+    m_frameSize = cv::Size();
+    m_accum = cv::Point2d();
+    m_keyShift = cv::Point2d();
+    m_shift = cv::Point2d();
+    m_response = 0.0;
+    m_pending = true;
+    m_lost = false;
+    m_keyTrusted = true;
+    m_frames = 0;
+    m_keyframes = 0;
+}
+
+/**
+ * @brief update correlates the current frame against the previous one and
+ * decides whether it is a keyframe.
+ */
+bool KeyframeSelector::update(FramePyramid &pyramid, bool eligible)
+{
+    if (pyramid.empty()) {
+        return false;
+    }
+    if (pyramid.size() != m_frameSize) {
+        // New geometry: pick the level and start over
+        m_prev.release();
+        m_frameSize = pyramid.size();
+        m_level = 0;
+        while (m_level + 1 < FramePyramid::MAX_LEVELS
+               && pyramid.levelSize(m_level + 1).width >= m_workWidth) {
+            ++m_level;
+        }
+        cv::createHanningWindow(m_window, pyramid.levelSize(m_level), CV_32F);
+        m_pending = true;
+        m_lost = true;
+    }
+    ++m_frames;
+    pyramid.level(m_level).convertTo(m_curr, CV_32F);
+
+    if (!m_prev.empty()) {
+        m_shift = cv::phaseCorrelate(m_prev, m_curr, m_window, &m_response);
+        const double scale = double(1 << m_level);
+        m_shift *= scale;
+        if (m_response < m_minResponse) {
+            m_pending = true;
+            m_lost = true;
+        } else {
+            m_accum += m_shift;
+        }
+    }
+    std::swap(m_prev, m_curr);
+
+    // Keyframe once the overlap along either axis falls to the threshold
+    const double travel = 1.0 - m_overlap;
+    if (std::abs(m_accum.x) >= travel * m_frameSize.width
+        || std::abs(m_accum.y) >= travel * m_frameSize.height) {
+        m_pending = true;
+    }
+    if (!m_pending || !eligible) {
+        return false;
+    }
+    m_pending = false;
+    // The first keyframe anchors the run, so only later ones can be off
+    m_keyTrusted = !m_lost || m_keyframes == 0;
+    m_lost = false;
+    m_keyShift = m_keyframes > 0 ? m_accum : cv::Point2d();
+    m_accum = cv::Point2d();
+    ++m_keyframes;
+    return true;
+}
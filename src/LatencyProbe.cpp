@@ -0,0 +1,296 @@
+//------------------------------------------------------------------------------
+// src/LatencyProbe.cpp
+//------------------------------------------------------------------------------
+
+#include "LatencyProbe.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+static constexpr int STAMP_CELLS = 40;     // 32 value bits + 8 check bits
+static constexpr int LUMA_HISTORY = 60;    // frames of brightness range
+static constexpr float MIN_CONTRAST = 16.0f;
+static constexpr quint32 CHECK_KEY = 0xA5;  // plain black or white rows never decode
+
+/**
+ * @brief LatencyProbe constructor.
+ */
+LatencyProbe::LatencyProbe()
+    : m_mode(Off)
+    , m_active(false)
+    , m_marks()
+    , m_pendingEventUs(-1)
+    , m_receiveUs(0)
+    , m_flashUs(-1)
+    , m_luma()
+    , m_lumaNext(0)
+    , m_lastLuma(0.0f)
+    , m_missed(0)
+    , m_records()
+{}
+
+/**
+ * @brief start clears the samples and the detector.
+ */
+void LatencyProbe::start(Mode mode)
+{
+    m_mode = mode;
+    m_active = false;
+    m_pendingEventUs = -1;
+    m_flashUs = -1;
+    m_luma.clear();
+    m_lumaNext = 0;
+    m_lastLuma = 0.0f;
+    m_missed = 0;
+    m_records.clear();
+}
+
+/**
+ * @brief stop ends the measurement.
+ */
+void LatencyProbe::stop()
+{
+    m_mode = Off;
+    m_active = false;
+    m_pendingEventUs = -1;
+    m_flashUs = -1;
+}
+
+/**
+ * @brief flash arms the detector.
+ */
+void LatencyProbe::flash(qint64 tUs)
+{
+    if (m_mode == Flash) {
+        m_flashUs = tUs;
+    }
+}
+
+/**
+ * @brief unflash disarms the detector.
+ */
+void LatencyProbe::unflash()
+{
+    if (m_flashUs >= 0) {
+        ++m_missed;
+        m_flashUs = -1;
+    }
+}
+
+/**
+ * @brief inspect detects a flash (rising edge through the middle of the
+ * recent brightness range) or decodes a stamp.
+ */
+void LatencyProbe::inspect(const cv::Mat &frame, const cv::Rect &region)
+{
+    if (m_mode == Off) {
+        return;
+    }
+    m_receiveUs = steadyMicros();
+    if (m_mode == Stamp) {
+        quint32 stamp;
+        if (readStamp(frame, stamp)) {
+            // The stamp is the low 32 bits of the steady clock
+            m_pendingEventUs = m_receiveUs - qint64(quint32(m_receiveUs) - stamp);
+        }
+        return;
+    }
+
+    const cv::Rect r = region & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (r.empty()) {
+        return;
+    }
+    const cv::Scalar mean = cv::mean(frame(r));
+    const float luma = float(mean[0] + mean[1] + mean[2]) / 3.0f;
+    if (m_luma.size() < size_t(LUMA_HISTORY)) {
+        m_luma.push_back(luma);
+    } else {
+        m_luma[m_lumaNext] = luma;
+        m_lumaNext = (m_lumaNext + 1) % m_luma.size();
+    }
+    const auto range = std::minmax_element(m_luma.begin(), m_luma.end());
+    const float mid = (*range.first + *range.second) / 2.0f;
+    if (m_flashUs >= 0 && *range.second - *range.first >= MIN_CONTRAST
+        && luma > mid && m_lastLuma <= mid) {
+        m_pendingEventUs = m_flashUs;
+        m_flashUs = -1;
+    }
+    m_lastLuma = luma;
+}
+
+/**
+ * @brief beginFrame traces the frame if an event is waiting for one.
+ */
+void LatencyProbe::beginFrame(const FrameMeta &meta)
+{
+    if (m_pendingEventUs < 0) {
+        return;
+    }
+    std::fill(std::begin(m_marks), std::end(m_marks), -1);
+    m_marks[Event] = m_pendingEventUs;
+    m_marks[Capture] = meta.arrivalUs > 0 ? meta.arrivalUs : -1;
+    m_marks[Receive] = m_receiveUs;
+    m_pendingEventUs = -1;
+    m_active = true;
+    m_records.push_back({meta.sequence, {}});
+}
+
+/**
+ * @brief endFrame stores the marks of the traced frame.
+ */
+void LatencyProbe::endFrame()
+{
+    if (m_active) {
+        std::copy(std::begin(m_marks), std::end(m_marks), m_records.back().marks);
+        m_active = false;
+    }
+}
+
+/**
+ * @brief name returns the display name of a mark.
+ */
+const char *LatencyProbe::name(Mark m)
+{
+    static const char *NAMES[MARK_COUNT] = {
+        "event", "capture", "receive", "remap", "index",
+        "refine", "overlay", "scale", "paint", "encode"
+    };
+    return m >= 0 && m < MARK_COUNT ? NAMES[m] : "?";
+}
+
+namespace {
+
+/**
+ * @brief distribution formats "p50 / p95 / p99 / max" of milliseconds.
+ */
+QString distribution(std::vector<double> v)
+{
+    if (v.empty()) {
+        return QString("--");
+    }
+    std::sort(v.begin(), v.end());
+    auto at = [&v](double p) {
+        return v[std::min(v.size() - 1, size_t(p / 100.0 * (v.size() - 1) + 0.5))];
+    };
+    return QString("p50 %1 p95 %2 p99 %3 max %4 ms (%5)")
+        .arg(at(50), 0, 'f', 1).arg(at(95), 0, 'f', 1).arg(at(99), 0, 'f', 1)
+        .arg(v.back(), 0, 'f', 1).arg(v.size());
+}
+
+} // namespace
+
+/**
+ * @brief report summarises event→display, event→encode and
+ * capture→display, then the median of every segment between reached marks.
+ */
+QStringList LatencyProbe::report() const
+{
+    QStringList lines;
+    lines << QString("%1 frames traced, %2 flashes missed").arg(m_records.size()).arg(m_missed);
+
+    std::vector<double> display, encode, pipeline;
+    std::vector<std::vector<double>> segments(MARK_COUNT);
+    for (const Record &rec : m_records) {
+        const qint64 *m = rec.marks;
+        if (m[Paint] >= 0) {
+            display.push_back((m[Paint] - m[Event]) / 1000.0);
+            if (m[Capture] >= 0) {
+                pipeline.push_back((m[Paint] - m[Capture]) / 1000.0);
+            }
+        }
+        if (m[Encode] >= 0) {
+            encode.push_back((m[Encode] - m[Event]) / 1000.0);
+        }
+        // Each reached mark against the previous reached one
+        int prev = Event;
+        for (int i = Capture; i < MARK_COUNT; ++i) {
+            if (m[i] >= 0) {
+                segments[size_t(i)].push_back((m[i] - m[prev]) / 1000.0);
+                prev = i;
+            }
+        }
+    }
+    lines << "event→display " + distribution(display);
+    lines << "event→encode " + distribution(encode);
+    lines << "capture→display " + distribution(pipeline);
+
+    QStringList parts;
+    for (int i = Capture; i < MARK_COUNT; ++i) {
+        std::vector<double> &s = segments[size_t(i)];
+        if (s.empty()) {
+            continue;
+        }
+        std::nth_element(s.begin(), s.begin() + s.size() / 2, s.end());
+        parts << QString("%1 %2").arg(name(Mark(i))).arg(s[s.size() / 2], 0, 'f', 2);
+    }
+    if (!parts.isEmpty()) {
+        lines << "median ms to " + parts.join(", ");
+    }
+    return lines;
+}
+
+/**
+ * @brief writeCsv writes the traced frames.
+ */
+bool LatencyProbe::writeCsv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out << "sequence";
+    for (int i = Capture; i < MARK_COUNT; ++i) {
+        out << ',' << name(Mark(i)) << "_us";
+    }
+    out << '\n';
+    for (const Record &rec : m_records) {
+        out << rec.sequence;
+        for (int i = Capture; i < MARK_COUNT; ++i) {
+            out << ',';
+            if (rec.marks[i] >= 0) {
+                out << rec.marks[i] - rec.marks[Event];
+            }
+        }
+        out << '\n';
+    }
+    return true;
+}
+
+/**
+ * @brief stamp draws the code cells, most significant bit first.
+ */
+bool LatencyProbe::stamp(cv::Mat &frame, quint32 value)
+{
+    const int cell = std::max(4, frame.cols / (STAMP_CELLS + 8));
+    if (frame.type() != CV_8UC3 || frame.rows < cell || cell * STAMP_CELLS > frame.cols) {
+        return false;
+    }
+    const quint32 check = (value ^ (value >> 8) ^ (value >> 16) ^ (value >> 24) ^ CHECK_KEY) & 0xFF;
+    const quint64 code = (quint64(value) << 8) | check;
+    for (int i = 0; i < STAMP_CELLS; ++i) {
+        const bool bit = (code >> (STAMP_CELLS - 1 - i)) & 1;
+        frame(cv::Rect(i * cell, 0, cell, cell)).setTo(cv::Scalar::all(bit ? 255 : 0));
+    }
+    return true;
+}
+
+/**
+ * @brief readStamp samples the middle of each cell and checks the code.
+ */
+bool LatencyProbe::readStamp(const cv::Mat &frame, quint32 &value)
+{
+    const int cell = std::max(4, frame.cols / (STAMP_CELLS + 8));
+    if (frame.type() != CV_8UC3 || frame.rows < cell || cell * STAMP_CELLS > frame.cols) {
+        return false;
+    }
+    quint64 code = 0;
+    for (int i = 0; i < STAMP_CELLS; ++i) {
+        const cv::Vec3b &px = frame.at<cv::Vec3b>(cell / 2, i * cell + cell / 2);
+        code = (code << 1) | ((px[0] + px[1] + px[2]) > 3 * 128 ? 1 : 0);
+    }
+    value = quint32(code >> 8);
+    const quint32 check = (value ^ (value >> 8) ^ (value >> 16) ^ (value >> 24) ^ CHECK_KEY) & 0xFF;
+    return check == (code & 0xFF);
+}
@@ -0,0 +1,260 @@
+//------------------------------------------------------------------------------
+// src/MosaicCanvas.cpp
+//------------------------------------------------------------------------------
+
+#include "MosaicCanvas.h"
+#include "NDVIKernel.h"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+static constexpr qint64 TILE_BYTES = qint64(MosaicCanvas::TILE) * MosaicCanvas::TILE * 2 * sizeof(float);
+static constexpr qint64 GROW_TILES = 64;  // backing file growth step
+
+/**
+ * @brief floorDiv divides rounding towards negative infinity.
+ */
+static inline int floorDiv(int a, int b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/**
+ * @brief tileKey packs signed tile coordinates into one key.
+ */
+static inline long long tileKey(int tx, int ty)
+{
+    return (static_cast<long long>(tx) << 32) ^ static_cast<unsigned int>(ty);
+}
+
+/**
+ * @brief MosaicCanvas constructor.
+ */
+MosaicCanvas::MosaicCanvas()
+    : m_file()
+    , m_tiles()
+    , m_lru()
+    , m_budget(256)
+    , m_slots(0)
+    , m_capacity(0)
+    , m_bounds()
+    , m_feather()
+{}
+
+/**
+ * @brief Destructor.
+ */
+MosaicCanvas::~MosaicCanvas()
+{
+    close();
+}
+
+/**
+ * @brief open creates the backing file and empties the canvas.
+ */
+bool MosaicCanvas::open(const QString &path, int residentTiles)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        return false;
+    }
+    m_budget = std::max(residentTiles, 4);
+    return true;
+}
+
+/**
+ * @brief close unmaps all tiles and closes the backing file.
+ */
+void MosaicCanvas::close()
+{
+    while (!m_lru.empty()) {
+        evict();
+    }
+    m_tiles.clear();
+    m_slots = 0;
+    m_capacity = 0;
+    m_bounds = cv::Rect();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+/**
+ * @brief evict unmaps the least recently used tile.
+ */
+void MosaicCanvas::evict()
+{
+    Tile &tile = m_tiles[m_lru.back()];
+    m_file.unmap(reinterpret_cast<uchar *>(tile.data));
+    tile.data = nullptr;
+    m_lru.pop_back();
+}
+
+/**
+ * @brief acquire returns the mapped data of a tile, allocating its file
+ * slot if create is set.
+ * @return the tile data, or null if the tile does not exist or mapping failed
+ */
+float *MosaicCanvas::acquire(int tx, int ty, bool create)
+{
+    const long long key = tileKey(tx, ty);
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end()) {
+        if (!create) {
+            return nullptr;
+        }
+        if (m_slots == m_capacity) {
+            // Sparse growth: new slots read back as zero weight
+            if (!m_file.resize((m_capacity + GROW_TILES) * TILE_BYTES)) {
+                return nullptr;
+            }
+            m_capacity += GROW_TILES;
+        }
+        it = m_tiles.emplace(key, Tile{ m_slots++, nullptr, m_lru.end() }).first;
+    }
+
+    Tile &tile = it->second;
+    if (tile.data) {
+        m_lru.splice(m_lru.begin(), m_lru, tile.lru);
+        return tile.data;
+    }
+    while (int(m_lru.size()) >= m_budget) {
+        evict();
+    }
+    uchar *p = m_file.map(tile.slot * TILE_BYTES, TILE_BYTES);
+    if (!p) {
+        return nullptr;
+    }
+    tile.data = reinterpret_cast<float *>(p);
+    m_lru.push_front(key);
+    tile.lru = m_lru.begin();
+    return tile.data;
+}
+
+/**
+ * @brief feather returns the blend weight plane for a frame size: the
+ * distance to the nearest border, ramped to 1 over an eighth of the
+ * shorter side, so seams between keyframes fade out.
+ */
+const cv::Mat &MosaicCanvas::feather(const cv::Size &size)
+{
+    if (m_feather.size() != size) {
+        m_feather.create(size, CV_32F);
+        const float ramp = std::max(std::min(size.width, size.height) / 8.0f, 1.0f);
+        for (int y = 0; y < size.height; ++y) {
+            float *f = m_feather.ptr<float>(y);
+            int dy = std::min(y + 1, size.height - y);
+            for (int x = 0; x < size.width; ++x) {
+                int d = std::min(dy, std::min(x + 1, size.width - x));
+                f[x] = std::min(d / ramp, 1.0f);
+            }
+        }
+    }
+    return m_feather;
+}
+
+/**
+ * @brief blend maps every tile the frame covers on this thread, then
+ * accumulates the tiles in parallel.
+ */
+void MosaicCanvas::blend(const cv::Mat &ndvi, const cv::Mat &mask, const cv::Point &origin)
+{
+    if (!isOpen() || ndvi.empty()) {
+        return;
+    }
+    CV_Assert(ndvi.type() == CV_32F && mask.type() == CV_8U && mask.size() == ndvi.size());
+    const cv::Rect frame(origin, ndvi.size());
+    const cv::Mat &weights = feather(ndvi.size());
+
+    const int tx0 = floorDiv(frame.x, TILE);
+    const int ty0 = floorDiv(frame.y, TILE);
+    const int tx1 = floorDiv(frame.x + frame.width - 1, TILE);
+    const int ty1 = floorDiv(frame.y + frame.height - 1, TILE);
+    const int needed = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    // The whole frame must be resident at once
+    m_budget = std::max(m_budget, needed + 1);
+
+    struct Job { float *data; cv::Rect area; };
+    std::vector<Job> jobs;
+    jobs.reserve(needed);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            float *data = acquire(tx, ty, true);
+            if (data) {
+                cv::Rect area = frame & cv::Rect(tx * TILE, ty * TILE, TILE, TILE);
+                jobs.push_back({ data, area });
+            }
+        }
+    }
+
+    cv::parallel_for_(cv::Range(0, int(jobs.size())), [&](const cv::Range &range) {
+        for (int j = range.start; j < range.end; ++j) {
+            const Job &job = jobs[j];
+            const int tileX = floorDiv(job.area.x, TILE) * TILE;
+            const int tileY = floorDiv(job.area.y, TILE) * TILE;
+            const int fx0 = job.area.x - origin.x;
+            for (int y = job.area.y; y < job.area.y + job.area.height; ++y) {
+                const int fy = y - origin.y;
+                const float *nd = ndvi.ptr<float>(fy) + fx0;
+                const uchar *mk = mask.ptr<uchar>(fy) + fx0;
+                const float *wt = weights.ptr<float>(fy) + fx0;
+                float *dst = job.data + ((y - tileY) * TILE + job.area.x - tileX) * 2;
+                for (int i = 0; i < job.area.width; ++i) {
+                    if (mk[i] != 0) continue;
+                    dst[2 * i]     += wt[i] * nd[i];
+                    dst[2 * i + 1] += wt[i];
+                }
+            }
+        }
+    });
+
+    m_bounds = m_bounds.empty() ? frame : (m_bounds | frame);
+}
+
+/**
+ * @brief render point-samples the canvas row by row, reusing the tile
+ * pointer while consecutive samples stay in the same tile.
+ */
+void MosaicCanvas::render(const cv::Rect &view, const cv::Size &outSize,
+                          cv::Mat &ndvi, cv::Mat &mask)
+{
+    ndvi.create(outSize, CV_32F);
+    mask.create(outSize, CV_8U);
+    ndvi.setTo(0.0f);
+    mask.setTo(MASK_UNREGISTERED);
+    if (!isOpen() || view.empty() || outSize.empty()) {
+        return;
+    }
+
+    const double sx = double(view.width) / outSize.width;
+    const double sy = double(view.height) / outSize.height;
+    std::vector<int> cxs(outSize.width);
+    for (int u = 0; u < outSize.width; ++u) {
+        cxs[u] = view.x + int((u + 0.5) * sx);
+    }
+
+    for (int v = 0; v < outSize.height; ++v) {
+        const int cy = view.y + int((v + 0.5) * sy);
+        const int ty = floorDiv(cy, TILE);
+        const int ly = cy - ty * TILE;
+        float *out = ndvi.ptr<float>(v);
+        uchar *mk = mask.ptr<uchar>(v);
+        int lastTx = INT_MIN;
+        const float *data = nullptr;
+        for (int u = 0; u < outSize.width; ++u) {
+            const int tx = floorDiv(cxs[u], TILE);
+            if (tx != lastTx) {
+                data = acquire(tx, ty, false);
+                lastTx = tx;
+            }
+            if (!data) continue;
+            const float *px = data + (ly * TILE + (cxs[u] - tx * TILE)) * 2;
+            if (px[1] > 0.0f) {
+                out[u] = px[0] / px[1];
+                mk[u] = 0;
+            }
+        }
+    }
+}
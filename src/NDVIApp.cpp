@@ -3,6 +3,9 @@
 //------------------------------------------------------------------------------
 
 #include "NDVIApp.h"
+#include "Palette.h"
+#include "ReplaySource.h"
+#include "RawDumpSource.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -16,18 +19,54 @@
 #include <QCheckBox>
 #include <QTextEdit>
 #include <QColorDialog>
+#include <QFileDialog>
 #include <QStandardPaths>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QCloseEvent>
 #include <QScrollBar>
+#include <QRandomGenerator>
 #include <cmath>
 #include <QDateTime>
 #include <algorithm>
 #include <QApplication>
 
-static constexpr float EPSILON = 1e-9f;  // match Python NDVI denominator
+namespace {
+
+/**
+ * @brief matToJson flattens a CV_64F matrix row by row.
+ */
+QJsonArray matToJson(const cv::Mat &m)
+{
+    QJsonArray values;
+    for (int y = 0; y < m.rows; ++y) {
+        for (int x = 0; x < m.cols; ++x) {
+            values.append(m.at<double>(y, x));
+        }
+    }
+    return values;
+}
+
+/**
+ * @brief jsonToMat rebuilds a CV_64F matrix of @p rows rows, empty if the
+ * value count does not split into them.
+ */
+cv::Mat jsonToMat(const QJsonArray &values, int rows)
+{
+    if (values.isEmpty() || values.size() % rows != 0) {
+        return cv::Mat();
+    }
+    cv::Mat m(rows, values.size() / rows, CV_64F);
+    for (int i = 0; i < values.size(); ++i) {
+        m.at<double>(i / m.cols, i % m.cols) = values.at(i).toDouble();
+    }
+    return m;
+}
+
+} // namespace
 
 /**
  * @brief NDVIApp constructor initializes UI, state, and preview timer.
@@ -37,19 +76,70 @@ NDVIApp::NDVIApp(QWidget *parent)
     : QWidget(parent)
     , m_captureThread(nullptr)
     , m_lut()
-    , m_lastTime(0.0f)
+    , m_lastTime(0.0)
     , m_fps(0.0f)
     , m_crosshairColor(Qt::green)
     , m_roiColor(Qt::red)
     , m_lastNDVI()
+    , m_lastFrame()
+    , m_lastNir()
+    , m_lastMask()
+    , m_kernel()
+    , m_geometry()
+    , m_temporal()
+    , m_compositor()
+    , m_guided()
+    , m_isolines()
+    , m_lastIsolines()
+    , m_pyramid()
+    , m_tracker()
+    , m_trackSeed(true)
+    , m_quality()
+    , m_lastQualityFlags(0)
+    , m_droppedFrames(0)
+    , m_dropRun(0)
+    , m_keyframes()
+    , m_lastKeyframe(false)
+    , m_mosaic()
+    , m_mosaicOrigin()
+    , m_orthoThread(nullptr)
+    , m_orthoJob()
+    , m_orthoTileSize(1024)
+    , m_orthoNirBand(0)
+    , m_orthoVisBand(1)
+    , m_orthoShift(0)
+    , m_contourFile()
+    , m_registration()
     , m_videoWriter()
+    , m_dump()
+    , m_dumpParams()
+    , m_replayExact(false)
+    , m_probe()
+    , m_flashWindow(nullptr)
+    , m_flashTimer(new QTimer(this))
+    , m_flashBright(false)
+    , m_flashPeriodMs(1000)
+    , m_feedStamped(false)
     , m_previewTimer(new QTimer(this))
-    , m_processInterval(0.1f)
-    , m_lastProcessTime(0.0f)
+    , m_profileTimer(new QTimer(this))
+    , m_profileSnap()
+    , m_profileLogSnap()
+    , m_profileLogInterval(10)
+    , m_hudLines()
+    , m_processInterval(0.1)
+    , m_lastProcessTime(0.0)
+    , m_unthrottled(false)
+    , m_sceneParams()
 {
     // Determine settings file path
     m_settingsPath = QStandardPaths::writableLocation(
         QStandardPaths::AppDataLocation) + "/raziel_settings.json";
+    m_homographyPath = QStandardPaths::writableLocation(
+        QStandardPaths::AppDataLocation) + "/raziel_homography.yml";
+    m_mosaicPath = QStandardPaths::writableLocation(
+        QStandardPaths::AppDataLocation) + "/raziel_mosaic.bin";
+
+    RAZIEL_TRACE_THREAD("gui");
 
     // Apply visual style
     applyStyle();
@@ -62,8 +152,17 @@ NDVIApp::NDVIApp(QWidget *parent)
     // Start preview updates at 200ms intervals
     m_previewTimer->start(200);
 
+    // Stage latency HUD and log dumps
+    connect(m_profileTimer, &QTimer::timeout, this, &NDVIApp::onProfileTimer);
+    m_profileTimer->start(1000);
+
     // Load persisted settings
     restoreSettings();
+
+    // Load cached dual-rig registration
+    if (m_registration.load(m_homographyPath.toStdString())) {
+        logMessage("Dual-rig homography restored");
+    }
 }
 
 /**
@@ -202,8 +301,29 @@ void NDVIApp::setupUI()
     for (int i = 0; i < 5; ++i) {
         m_camBox->addItem(QString("Cam %1").arg(i));
     }
+    m_camBox->addItem("Synthetic");
     grid->addWidget(m_camBox, 0, 1);
 
+    grid->addWidget(new QLabel("NIR Cam:"), 5, 0);
+    m_nirBox = new QComboBox();
+    m_nirBox->addItem("None");
+    for (int i = 0; i < 5; ++i) {
+        m_nirBox->addItem(QString("Cam %1").arg(i));
+    }
+    grid->addWidget(m_nirBox, 5, 1);
+    m_registerBtn = new QPushButton("Register");
+    grid->addWidget(m_registerBtn, 6, 1);
+
+    m_replayBtn = new QPushButton("Replay");
+    grid->addWidget(m_replayBtn, 7, 0);
+    m_pacingBox = new QComboBox();
+    for (const QString &name : {"Real-time", "Fixed rate", "Max speed"}) {
+        m_pacingBox->addItem(name);
+    }
+    grid->addWidget(m_pacingBox, 7, 1);
+    m_loopChk = new QCheckBox("Loop");
+    grid->addWidget(m_loopChk, 8, 1);
+
     m_startBtn = new QPushButton("ENGAGE");
     m_startBtn->setObjectName("start");
     m_abortBtn = new QPushButton("ABORT");
@@ -225,9 +345,7 @@ void NDVIApp::setupUI()
 
     grid->addWidget(new QLabel("Palette:"), 4, 0);
     m_paletteBox = new QComboBox();
-    for (const QString &name : {"NDVI Classic","Infrared","Thermal","Grayscale"}) {
-        m_paletteBox->addItem(name);
-    }
+    m_paletteBox->addItems(paletteNames());
     grid->addWidget(m_paletteBox, 4, 1);
 
     rightLayout->addWidget(controlsGroup);
@@ -242,8 +360,46 @@ void NDVIApp::setupUI()
     m_recordBtn->setCheckable(true);
     m_snapshotBtn = new QPushButton("Snap");
     m_snapshotBtn->setObjectName("snapshot");
+    m_dumpBtn = new QPushButton("Dump");
+    m_dumpBtn->setObjectName("record");
+    m_dumpBtn->setCheckable(true);
+    m_traceBtn = new QPushButton("Trace");
+    m_traceBtn->setObjectName("record");
+    m_traceBtn->setCheckable(true);
+    m_latencyBtn = new QPushButton("G2G");
+    m_latencyBtn->setObjectName("record");
+    m_latencyBtn->setCheckable(true);
+    m_latencyBtn->setToolTip("Glass-to-glass latency: flash marker, or stamped synthetic frames");
     rh->addWidget(m_recordBtn);
+    rh->addWidget(m_dumpBtn);
+    rh->addWidget(m_traceBtn);
+    rh->addWidget(m_latencyBtn);
     rh->addWidget(m_snapshotBtn);
+    m_compositeBox = new QComboBox();
+    for (const QString &name : {"Comp Off", "Max NDVI", "Median", "P90"}) {
+        m_compositeBox->addItem(name);
+    }
+    m_compWindowSpin = new QSpinBox();
+    m_compWindowSpin->setRange(0, 255);
+    m_compWindowSpin->setSpecialValueText("Pass");
+    m_compWindowSpin->setSuffix(" fr");
+    m_compExportBtn = new QPushButton("Export");
+    rh->addWidget(m_compositeBox);
+    rh->addWidget(m_compWindowSpin);
+    rh->addWidget(m_compExportBtn);
+    m_contourRecBtn = new QPushButton("Iso");
+    m_contourRecBtn->setObjectName("record");
+    m_contourRecBtn->setCheckable(true);
+    rh->addWidget(m_contourRecBtn);
+    m_keyframeBtn = new QPushButton("Key");
+    m_keyframeBtn->setObjectName("record");
+    m_keyframeBtn->setCheckable(true);
+    rh->addWidget(m_keyframeBtn);
+    m_mosaicBtn = new QPushButton("Mosaic");
+    m_mosaicBtn->setCheckable(true);
+    rh->addWidget(m_mosaicBtn);
+    m_orthoBtn = new QPushButton("Ortho");
+    rh->addWidget(m_orthoBtn);
     rightLayout->addWidget(recordGroup);
 
     // Features & ROI group
@@ -262,6 +418,18 @@ void NDVIApp::setupUI()
     m_zoomLabel = new QLabel("1x");
     col1->addRow("Zoom:", m_zoomSlider);
     col1->addRow("", m_zoomLabel);
+    m_panXSlider = new QSlider(Qt::Horizontal);
+    m_panXSlider->setRange(-100, 100);
+    col1->addRow("Pan X:", m_panXSlider);
+    m_panYSlider = new QSlider(Qt::Horizontal);
+    m_panYSlider->setRange(-100, 100);
+    col1->addRow("Pan Y:", m_panYSlider);
+
+    m_undistortChk = new QCheckBox();
+    m_undistortChk->setChecked(true);
+    col1->addRow("Undistort:", m_undistortChk);
+    m_lensBtn = new QPushButton("Lens...");
+    col1->addRow("", m_lensBtn);
 
     m_gridChk = new QCheckBox();
     col1->addRow("Grid:", m_gridChk);
@@ -276,6 +444,11 @@ void NDVIApp::setupUI()
     m_telemChk = new QCheckBox();
     m_telemChk->setChecked(true);
     col1->addRow("Telemetry:", m_telemChk);
+    m_hudChk = new QCheckBox();
+    col1->addRow("Profiler:", m_hudChk);
+    m_perfChk = new QCheckBox();
+    m_perfChk->setToolTip("Hardware counters per stage: IPC and misses per pixel (Linux perf events)");
+    col1->addRow("Counters:", m_perfChk);
 
     m_blendChk = new QCheckBox();
     col1->addRow("Blend:", m_blendChk);
@@ -284,12 +457,38 @@ void NDVIApp::setupUI()
     m_alphaSlider->setValue(100);
     col1->addRow("Alpha%:", m_alphaSlider);
 
+    m_temporalBox = new QComboBox();
+    for (const QString &name : {"Off", "EMA", "Box"}) {
+        m_temporalBox->addItem(name);
+    }
+    col1->addRow("Temporal:", m_temporalBox);
+    m_guidedChk = new QCheckBox();
+    col1->addRow("Smooth:", m_guidedChk);
+    m_contourChk = new QCheckBox();
+    col1->addRow("Contours:", m_contourChk);
+
+    m_satSpin = new QSpinBox();
+    m_satSpin->setRange(1, 255);
+    m_satSpin->setValue(255);
+    col1->addRow("Sat ≥:", m_satSpin);
+    m_minSignalSpin = new QSpinBox();
+    m_minSignalSpin->setRange(0, 510);
+    m_minSignalSpin->setValue(8);
+    col1->addRow("Min R+B:", m_minSignalSpin);
+    m_gateBox = new QComboBox();
+    for (const QString &name : {"Off", "Flag", "Drop"}) {
+        m_gateBox->addItem(name);
+    }
+    col1->addRow("Gate:", m_gateBox);
+
     m_roiToggle = new QCheckBox();
     col2->addRow("ROI On:", m_roiToggle);
     m_roiColorBtn = new QPushButton();
     m_roiColorBtn->setFixedSize(20,20);
     m_roiColorBtn->setStyleSheet("background:#ff0000;");
     col2->addRow("ROI Color:", m_roiColorBtn);
+    m_trackChk = new QCheckBox();
+    col2->addRow("Track:", m_trackChk);
 
     m_roiLeft = new QSlider(Qt::Horizontal); m_roiLeft->setRange(0,100);
     col2->addRow("Left%:", m_roiLeft);
@@ -303,6 +502,19 @@ void NDVIApp::setupUI()
     m_autoCalibBtn = new QPushButton("AutoCalib");
     col2->addRow("", m_autoCalibBtn);
 
+    m_panelSpin = new QDoubleSpinBox();
+    m_panelSpin->setRange(0.01, 1.0);
+    m_panelSpin->setSingleStep(0.01);
+    m_panelSpin->setValue(0.50);
+    col2->addRow("Panel ρ:", m_panelSpin);
+    m_panelCalBtn = new QPushButton("PanelCal");
+    m_panelResetBtn = new QPushButton("Reset");
+    QHBoxLayout *calRow = new QHBoxLayout();
+    calRow->setSpacing(6);
+    calRow->addWidget(m_panelCalBtn);
+    calRow->addWidget(m_panelResetBtn);
+    col2->addRow("", calRow);
+
     fs->addLayout(col1);
     fs->addLayout(col2);
     rightLayout->addWidget(featuresGroup);
@@ -333,6 +545,7 @@ void NDVIApp::setupUI()
     // Connect UI signals to slots
     connect(m_startBtn, &QPushButton::clicked, this, &NDVIApp::startCamera);
     connect(m_abortBtn, &QPushButton::clicked, this, &NDVIApp::stopCamera);
+    connect(m_replayBtn, &QPushButton::clicked, this, &NDVIApp::startReplay);
     connect(m_quitBtn, &QPushButton::clicked, this, &QWidget::close);
     // Play beep sound on quit
     connect(m_quitBtn, &QPushButton::clicked, []() {
@@ -340,21 +553,57 @@ void NDVIApp::setupUI()
     });
     connect(m_snapshotBtn, &QPushButton::clicked, this, &NDVIApp::takeSnapshot);
     connect(m_recordBtn, &QPushButton::toggled, this, &NDVIApp::toggleRecording);
+    connect(m_dumpBtn, &QPushButton::toggled, this, &NDVIApp::toggleRawDump);
+    connect(m_traceBtn, &QPushButton::toggled, this, &NDVIApp::toggleTrace);
+    connect(m_latencyBtn, &QPushButton::toggled, this, &NDVIApp::toggleLatency);
+    m_flashTimer->setSingleShot(true);
+    connect(m_flashTimer, &QTimer::timeout, this, &NDVIApp::onFlashTimer);
     connect(m_autoCalibBtn, &QPushButton::clicked, this, &NDVIApp::autoCalibrate);
+    connect(m_registerBtn, &QPushButton::clicked, this, &NDVIApp::registerDual);
+    connect(m_panelCalBtn, &QPushButton::clicked, this, &NDVIApp::calibratePanel);
+    connect(m_panelResetBtn, &QPushButton::clicked, this, &NDVIApp::resetPanelCalibration);
     connect(m_paletteBox, &QComboBox::currentTextChanged, this, &NDVIApp::changePalette);
     connect(m_zoomSlider, &QSlider::valueChanged, this, &NDVIApp::onZoomChanged);
+    connect(m_panXSlider, &QSlider::valueChanged, [this](int v){ logMessage(QString("Pan X %1").arg(v)); });
+    connect(m_panYSlider, &QSlider::valueChanged, [this](int v){ logMessage(QString("Pan Y %1").arg(v)); });
+    connect(m_undistortChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
+    connect(m_guidedChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
+    connect(m_lensBtn, &QPushButton::clicked, this, &NDVIApp::loadIntrinsics);
     connect(m_minSlider, &QSlider::valueChanged, [this](int v){ logMessage(QString("Min %1").arg(v/100.0, 0, 'f', 2)); });
     connect(m_maxSlider, &QSlider::valueChanged, [this](int v){ logMessage(QString("Max %1").arg(v/100.0, 0, 'f', 2)); });
     connect(m_alphaSlider, &QSlider::valueChanged, [this](int v){ logMessage(QString("Alpha %1").arg(v)); });
     connect(m_gridChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
     connect(m_crossChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
     connect(m_telemChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
+    connect(m_hudChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
+    connect(m_perfChk, &QCheckBox::toggled, this, &NDVIApp::togglePerfCounters);
     connect(m_blendChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
-    connect(m_roiToggle, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
-    connect(m_roiLeft, &QSlider::valueChanged, [this](){ logMessage("ROI changed"); });
-    connect(m_roiRight, &QSlider::valueChanged, [this](){ logMessage("ROI changed"); });
-    connect(m_roiTop, &QSlider::valueChanged, [this](){ logMessage("ROI changed"); });
-    connect(m_roiBottom, &QSlider::valueChanged, [this](){ logMessage("ROI changed"); });
+    connect(m_roiToggle, &QCheckBox::stateChanged, [this](){ m_trackSeed = true; logMessage("Toggle changed"); });
+    connect(m_trackChk, &QCheckBox::stateChanged, [this](){ m_trackSeed = true; logMessage("Toggle changed"); });
+    connect(m_temporalBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &NDVIApp::changeTemporalMode);
+    connect(m_gateBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &NDVIApp::changeGateMode);
+    connect(m_compositeBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &NDVIApp::changeCompositeMode);
+    connect(m_compWindowSpin, QOverload<int>::of(&QSpinBox::valueChanged), [this](int v){
+        m_compositor.setWindow(v);
+        logMessage(v > 0 ? QString("Composite window %1").arg(v) : QString("Composite whole pass"));
+    });
+    connect(m_compExportBtn, &QPushButton::clicked, this, &NDVIApp::exportComposite);
+    connect(m_contourRecBtn, &QPushButton::toggled, this, &NDVIApp::toggleContourStream);
+    connect(m_keyframeBtn, &QPushButton::toggled, this, &NDVIApp::toggleKeyframeMode);
+    connect(m_mosaicBtn, &QPushButton::toggled, this, &NDVIApp::toggleMosaic);
+    connect(m_orthoBtn, &QPushButton::clicked, this, &NDVIApp::processOrthomosaic);
+    connect(m_contourChk, &QCheckBox::stateChanged, [this](){ logMessage("Toggle changed"); });
+    connect(m_satSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            [this](int v){ logMessage(QString("Sat level %1").arg(v)); });
+    connect(m_minSignalSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            [this](int v){ logMessage(QString("Min signal %1").arg(v)); });
+    connect(m_roiLeft, &QSlider::valueChanged, [this](){ m_trackSeed = true; logMessage("ROI changed"); });
+    connect(m_roiRight, &QSlider::valueChanged, [this](){ m_trackSeed = true; logMessage("ROI changed"); });
+    connect(m_roiTop, &QSlider::valueChanged, [this](){ m_trackSeed = true; logMessage("ROI changed"); });
+    connect(m_roiBottom, &QSlider::valueChanged, [this](){ m_trackSeed = true; logMessage("ROI changed"); });
     connect(m_crossColorBtn, &QPushButton::clicked, this, &NDVIApp::chooseCrossColor);
     connect(m_roiColorBtn, &QPushButton::clicked, this, &NDVIApp::chooseRoiColor);
 }
@@ -388,18 +637,164 @@ void NDVIApp::restoreSettings()
         int idx = m_paletteBox->findText(pal);
         if (idx >= 0) m_paletteBox->setCurrentIndex(idx);
     }
+    if (obj.contains("temporal") && obj["temporal"].isString()) {
+        int idx = m_temporalBox->findText(obj["temporal"].toString());
+        if (idx >= 0) m_temporalBox->setCurrentIndex(idx);
+    }
+    if (obj.contains("qualityGate") && obj["qualityGate"].isString()) {
+        int idx = m_gateBox->findText(obj["qualityGate"].toString());
+        if (idx >= 0) m_gateBox->setCurrentIndex(idx);
+    }
+    if (obj.contains("qualityBlurRatio") && obj["qualityBlurRatio"].isDouble()) {
+        m_quality.setBlurRatio(float(obj["qualityBlurRatio"].toDouble()));
+    }
+    if (obj.contains("qualityMaxDark") && obj["qualityMaxDark"].isDouble()) {
+        m_quality.setMaxDark(float(obj["qualityMaxDark"].toDouble()));
+    }
+    if (obj.contains("qualityMaxBright") && obj["qualityMaxBright"].isDouble()) {
+        m_quality.setMaxBright(float(obj["qualityMaxBright"].toDouble()));
+    }
+    if (obj.contains("temporalAlpha") && obj["temporalAlpha"].isDouble()) {
+        m_temporal.setAlpha(float(obj["temporalAlpha"].toDouble()));
+    }
+    if (obj.contains("temporalWindow") && obj["temporalWindow"].isDouble()) {
+        m_temporal.setWindow(obj["temporalWindow"].toInt());
+    }
+    if (obj.contains("motionThreshold") && obj["motionThreshold"].isDouble()) {
+        m_temporal.setMotionThreshold(float(obj["motionThreshold"].toDouble()));
+    }
+    if (obj.contains("guidedRadius") && obj["guidedRadius"].isDouble()) {
+        m_guided.setRadius(obj["guidedRadius"].toInt());
+    }
+    if (obj.contains("guidedEps") && obj["guidedEps"].isDouble()) {
+        m_guided.setEps(float(obj["guidedEps"].toDouble()));
+    }
+    if (obj.contains("guided") && obj["guided"].isBool()) {
+        m_guidedChk->setChecked(obj["guided"].toBool());
+    }
+    if (obj.contains("contourLevels") && obj["contourLevels"].isArray()) {
+        std::vector<float> levels;
+        for (const QJsonValue &v : obj["contourLevels"].toArray()) {
+            if (v.isDouble()) levels.push_back(float(v.toDouble()));
+        }
+        m_isolines.setLevels(levels);
+    }
+    if (obj.contains("contourDownsample") && obj["contourDownsample"].isDouble()) {
+        m_isolines.setDownsample(obj["contourDownsample"].toInt());
+    }
+    if (obj.contains("keyframeOverlap") && obj["keyframeOverlap"].isDouble()) {
+        m_keyframes.setOverlap(float(obj["keyframeOverlap"].toDouble()));
+    }
+    if (obj.contains("orthoTileSize") && obj["orthoTileSize"].isDouble()) {
+        m_orthoTileSize = obj["orthoTileSize"].toInt();
+    }
+    if (obj.contains("orthoNirBand") && obj["orthoNirBand"].isDouble()) {
+        m_orthoNirBand = obj["orthoNirBand"].toInt();
+    }
+    if (obj.contains("orthoVisBand") && obj["orthoVisBand"].isDouble()) {
+        m_orthoVisBand = obj["orthoVisBand"].toInt();
+    }
+    if (obj.contains("orthoShift") && obj["orthoShift"].isDouble()) {
+        m_orthoShift = obj["orthoShift"].toInt();
+    }
+    if (obj.contains("latencyFlashMs") && obj["latencyFlashMs"].isDouble()) {
+        m_flashPeriodMs = qMax(200, obj["latencyFlashMs"].toInt());
+    }
+    if (obj.contains("maxProcessFps") && obj["maxProcessFps"].isDouble()) {
+        const double fps = obj["maxProcessFps"].toDouble();
+        m_processInterval = fps > 0.0 ? 1.0 / fps : 0.0;
+    }
+    if (obj.contains("profileLogInterval") && obj["profileLogInterval"].isDouble()) {
+        m_profileLogInterval = obj["profileLogInterval"].toInt();
+    }
+    if (obj.contains("synthetic") && obj["synthetic"].isObject()) {
+        m_sceneParams = SceneParams::fromJson(obj["synthetic"].toObject());
+    }
+    if (obj.contains("trackRadius") && obj["trackRadius"].isDouble()) {
+        m_tracker.setSearchRadius(obj["trackRadius"].toInt());
+    }
+    if (obj.contains("trackMinScore") && obj["trackMinScore"].isDouble()) {
+        m_tracker.setMinScore(float(obj["trackMinScore"].toDouble()));
+    }
+    if (obj.contains("satLevel") && obj["satLevel"].isDouble()) {
+        m_satSpin->setValue(obj["satLevel"].toInt());
+    }
+    if (obj.contains("minSignal") && obj["minSignal"].isDouble()) {
+        m_minSignalSpin->setValue(obj["minSignal"].toInt());
+    }
+    if (obj.contains("panelReflectance") && obj["panelReflectance"].isDouble()) {
+        m_panelSpin->setValue(obj["panelReflectance"].toDouble());
+    }
+    if (obj.contains("intrinsics") && obj["intrinsics"].isString()) {
+        m_intrinsicsPath = obj["intrinsics"].toString();
+        if (!m_geometry.loadIntrinsics(m_intrinsicsPath.toStdString())) {
+            logMessage(QString("Lens intrinsics not loaded: %1").arg(m_intrinsicsPath));
+            m_intrinsicsPath.clear();
+        }
+    }
+    if (obj.contains("gainRed") && obj["gainRed"].isDouble()
+        && obj.contains("gainBlue") && obj["gainBlue"].isDouble()) {
+        BandGains gains;
+        gains.red = float(obj["gainRed"].toDouble());
+        gains.blue = float(obj["gainBlue"].toDouble());
+        m_kernel.setGains(gains);
+    }
     logMessage("Settings restored");
 }
 
 /**
- * @brief saveSettings writes current min/max/palette to JSON file.
+ * @brief saveSettings writes current min/max/palette, band gains and the
+ * stage tunables to the JSON file, merged into the existing contents so
+ * keys this version does not know survive.
  */
 void NDVIApp::saveSettings()
 {
     QJsonObject obj;
+    QFile existing(m_settingsPath);
+    if (existing.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QJsonDocument old = QJsonDocument::fromJson(existing.readAll());
+        if (old.isObject()) {
+            obj = old.object();
+        }
+        existing.close();
+    }
     obj["min"] = m_minSlider->value();
     obj["max"] = m_maxSlider->value();
     obj["palette"] = m_paletteBox->currentText();
+    obj["temporal"] = m_temporalBox->currentText();
+    obj["temporalAlpha"] = m_temporal.alpha();
+    obj["temporalWindow"] = m_temporal.window();
+    obj["motionThreshold"] = m_temporal.motionThreshold();
+    obj["guided"] = m_guidedChk->isChecked();
+    obj["guidedRadius"] = m_guided.radius();
+    obj["guidedEps"] = m_guided.eps();
+    obj["qualityGate"] = m_gateBox->currentText();
+    obj["qualityBlurRatio"] = m_quality.blurRatio();
+    obj["qualityMaxDark"] = m_quality.maxDark();
+    obj["qualityMaxBright"] = m_quality.maxBright();
+    QJsonArray levels;
+    for (float level : m_isolines.levels()) {
+        levels.append(level);
+    }
+    obj["contourLevels"] = levels;
+    obj["contourDownsample"] = m_isolines.downsample();
+    obj["keyframeOverlap"] = m_keyframes.overlap();
+    obj["orthoTileSize"] = m_orthoTileSize;
+    obj["orthoNirBand"] = m_orthoNirBand;
+    obj["orthoVisBand"] = m_orthoVisBand;
+    obj["orthoShift"] = m_orthoShift;
+    obj["trackRadius"] = m_tracker.searchRadius();
+    obj["trackMinScore"] = m_tracker.minScore();
+    obj["satLevel"] = m_satSpin->value();
+    obj["minSignal"] = m_minSignalSpin->value();
+    obj["panelReflectance"] = m_panelSpin->value();
+    obj["intrinsics"] = m_intrinsicsPath;
+    obj["gainRed"] = m_kernel.gains().red;
+    obj["gainBlue"] = m_kernel.gains().blue;
+    obj["maxProcessFps"] = m_processInterval > 0.0 ? 1.0 / m_processInterval : 0.0;
+    obj["synthetic"] = m_sceneParams.toJson();
+    obj["profileLogInterval"] = m_profileLogInterval;
+    obj["latencyFlashMs"] = m_flashPeriodMs;
     QJsonDocument doc(obj);
     QFile file(m_settingsPath);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
@@ -413,113 +808,85 @@ void NDVIApp::saveSettings()
 
 /**
  * @brief computeNDVI computes the NDVI and returns the coloured frame.
- * Also outputs the raw NDVI float32 matrix.
+ * Also outputs the raw NDVI float32 matrix, the validity mask and the
+ * valid-pixel statistics. Band gains and mask thresholds are folded into
+ * the kernel tables, so neither adds a per-pixel cost or an extra pass.
+ * With a NIR frame (dual rig) the NIR band is sampled through the
+ * registration map inside the same kernel.
  */
 cv::Mat NDVIApp::computeNDVI(
     const cv::Mat &frame,
+    const cv::Mat &nir,
     float vmin,
     float vmax,
     const cv::Mat &lut,
-    cv::Mat &ndviOut
+    cv::Mat &ndviOut,
+    cv::Mat &maskOut,
+    NDVIStats &stats
 ) {
-    // Convert to float for safe division
-    cv::Mat f;
-    frame.convertTo(f, CV_32F);
-    std::vector<cv::Mat> channels(3);
-    cv::split(f, channels);
-    cv::Mat &B = channels[0];
-    cv::Mat &G = channels[1]; // unused
-    cv::Mat &R = channels[2];
-    // NDVI = (R - B) / (R + B + epsilon)
-    cv::Mat numerator = R - B;
-    cv::Mat denominator = R + B + EPSILON;
-    cv::Mat ndvi;
-    cv::divide(numerator, denominator, ndvi);
-    ndviOut = ndvi; // store raw NDVI
-
-    // Normalize to [0,1]
-    cv::Mat norm;
-    if (vmax <= vmin) {
-        norm = cv::Mat::zeros(ndvi.size(), CV_32F);
+    m_kernel.configure(vmin, vmax);
+    m_kernel.setMaskThresholds(m_satSpin->value(), m_minSignalSpin->value());
+    cv::Mat coloured;
+    if (nir.empty()) {
+        m_kernel.apply(frame, lut, coloured, ndviOut, maskOut, &stats);
     } else {
-        cv::subtract(ndvi, vmin, norm);
-        cv::divide(norm, (vmax - vmin), norm);
-        cv::threshold(norm, norm, 0.0, 0.0, cv::THRESH_TOZERO);
-        cv::threshold(norm, norm, 1.0, 1.0, cv::THRESH_TRUNC);
+        m_kernel.applyDual(frame, nir, m_registration.offsets(), m_registration.weights(),
+                           lut, coloured, ndviOut, maskOut, &stats);
     }
-
-    // Map to 0..255 index
-    cv::Mat idx;
-    norm.convertTo(idx, CV_8U, 255.0);
-
-    // Apply 3-channel LUT by splitting into three 1-channel LUTs
-    cv::Mat coloured;
-    std::vector<cv::Mat> lutChannels(3);
-    cv::split(lut, lutChannels);
-    cv::Mat bchan, gchan, rchan;
-    cv::LUT(idx, lutChannels[0], bchan);
-    cv::LUT(idx, lutChannels[1], gchan);
-    cv::LUT(idx, lutChannels[2], rchan);
-    std::vector<cv::Mat> colouredChans = { bchan, gchan, rchan };
-    cv::merge(colouredChans, coloured);
     return coloured;
 }
 
-/**
- * @brief makeLUT builds a 256×1×3 CV_8UC3 lookup table from three colors.
- */
-cv::Mat NDVIApp::makeLUT(const QColor &c1, const QColor &c2, const QColor &c3)
-{
-    // Build a CV_32F colormap via interpolation, then convert
-    cv::Mat lutF(256, 1, CV_32FC3);
-    for (int i = 0; i < 256; ++i) {
-        float t = i / 255.0f;
-        QColor c;
-        if (t < 0.5f) {
-            float u = t * 2.0f;
-            c = QColor::fromRgbF(
-                c1.redF()    + u * (c2.redF()   - c1.redF()),
-                c1.greenF()  + u * (c2.greenF() - c1.greenF()),
-                c1.blueF()   + u * (c2.blueF()  - c1.blueF())
-            );
-        } else {
-            float u = (t - 0.5f) * 2.0f;
-            c = QColor::fromRgbF(
-                c2.redF()    + u * (c3.redF()   - c2.redF()),
-                c2.greenF()  + u * (c3.greenF() - c2.greenF()),
-                c2.blueF()   + u * (c3.blueF()  - c2.blueF())
-            );
-        }
-        lutF.at<cv::Vec3f>(i,0) =
-            cv::Vec3f(c.redF(), c.greenF(), c.blueF());
-    }
-    cv::Mat lut8;
-    lutF.convertTo(lut8, CV_8UC3, 255.0);
-    return lut8;
-}
-
 /**
  * @brief drawOverlay overlays telemetry, grid, crosshair, ROI, and REC indicator.
  * @param img the BGR image to draw on
  * @param ndvi the NDVI float image
+ * @param mask validity flags for ndvi (0 = valid)
+ * @param stats valid-pixel statistics from the kernel pass
  */
-void NDVIApp::drawOverlay(cv::Mat &img, const cv::Mat &ndvi)
+void NDVIApp::drawOverlay(cv::Mat &img, const cv::Mat &ndvi, const cv::Mat &mask,
+                          const NDVIStats &stats)
 {
     int h = img.rows;
     int w = img.cols;
 
+    // NDVI contour lines, one colour per level (sub-pixel via 4-bit shift)
+    if (m_contourChk->isChecked()) {
+        static const cv::Scalar levelColours[] = {
+            {255, 255, 0}, {0, 255, 255}, {255, 0, 255}, {255, 255, 255}
+        };
+        const std::vector<float> &levels = m_isolines.levels();
+        for (const Isoline &line : m_lastIsolines) {
+            size_t li = std::find(levels.begin(), levels.end(), line.level) - levels.begin();
+            std::vector<cv::Point> pts;
+            pts.reserve(line.points.size());
+            for (const cv::Point2f &p : line.points) {
+                pts.emplace_back(cvRound(p.x * 16.0f), cvRound(p.y * 16.0f));
+            }
+            cv::polylines(img, pts, line.closed, levelColours[li % 4], 1, cv::LINE_AA, 4);
+        }
+    }
+
     // Telemetry panel
     if (m_telemChk->isChecked()) {
         cv::Mat overlay;
         img.copyTo(overlay);
-        cv::rectangle(overlay, cv::Point(5, 5), cv::Point(280, 180),
+        cv::rectangle(overlay, cv::Point(5, 5), cv::Point(280, 215),
                       cv::Scalar(0, 0, 0), cv::FILLED);
         cv::addWeighted(overlay, 0.6, img, 0.4, 0.0, img);
         QString now = QDateTime::currentDateTime().toString("HH:mm:ss");
-        double meanVal = cv::mean(ndvi)[0];
+        double meanVal = stats.mean();
         int cx = w / 2;
         int cy = h / 2;
-        float centerVal = ndvi.at<float>(cy, cx);
+        QString centerText = mask.at<uchar>(cy, cx) == 0
+            ? QString::number(ndvi.at<float>(cy, cx), 'f', 2) : QString("--");
+        QString roiText = "--";
+        cv::Rect roi = roiRect(ndvi.size());
+        if (m_roiToggle->isChecked() && !roi.empty()) {
+            cv::Mat roiValid = mask(roi) == 0;
+            if (cv::countNonZero(roiValid) > 0) {
+                roiText = QString::number(cv::mean(ndvi(roi), roiValid)[0], 'f', 2);
+            }
+        }
         cv::putText(img, now.toStdString(), cv::Point(10, 30),
                     cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
         cv::putText(img, ("FPS:" + QString::number(m_fps, 'f', 1)).toStdString(),
@@ -528,9 +895,31 @@ void NDVIApp::drawOverlay(cv::Mat &img, const cv::Mat &ndvi)
         cv::putText(img, ("Mean:" + QString::number(meanVal, 'f', 2)).toStdString(),
                     cv::Point(10, 90), cv::FONT_HERSHEY_SIMPLEX, 0.6,
                     cv::Scalar(0, 255, 0), 2);
-        cv::putText(img, ("Ctr:" + QString::number(centerVal, 'f', 2)).toStdString(),
+        cv::putText(img, ("Ctr:" + centerText).toStdString(),
                     cv::Point(10, 120), cv::FONT_HERSHEY_SIMPLEX, 0.6,
                     cv::Scalar(0, 255, 0), 2);
+        cv::putText(img, ("Masked:" + QString::number(stats.maskedFraction() * 100.0, 'f', 1) + "%").toStdString(),
+                    cv::Point(10, 150), cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                    cv::Scalar(0, 255, 0), 2);
+        cv::putText(img, ("ROI:" + roiText).toStdString(),
+                    cv::Point(10, 180), cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                    cv::Scalar(0, 255, 0), 2);
+    }
+
+    // Profiler HUD: per-stage latency percentiles, rates and counters, bottom left
+    if (m_hudChk->isChecked() && !m_hudLines.empty()) {
+        const int lineH = 16;
+        const int top = std::max(0, h - 10 - lineH * int(m_hudLines.size()));
+        cv::Mat overlay;
+        img.copyTo(overlay);
+        const int right = PerfCounters::isEnabled() ? 640 : 400;
+        cv::rectangle(overlay, cv::Point(5, top), cv::Point(std::min(w - 1, right), h - 5),
+                      cv::Scalar(0, 0, 0), cv::FILLED);
+        cv::addWeighted(overlay, 0.6, img, 0.4, 0.0, img);
+        for (size_t i = 0; i < m_hudLines.size(); ++i) {
+            cv::putText(img, m_hudLines[i], cv::Point(10, top + lineH * int(i + 1)),
+                        cv::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(0, 255, 0), 1);
+        }
     }
 
     // Grid lines
@@ -554,15 +943,13 @@ void NDVIApp::drawOverlay(cv::Mat &img, const cv::Mat &ndvi)
 
     // ROI rectangle
     if (m_roiToggle->isChecked()) {
-        int x0 = int(m_roiLeft->value() / 100.0f * w);
-        int x1 = int(m_roiRight->value() / 100.0f * w);
-        int y0 = int(m_roiTop->value() / 100.0f * h);
-        int y1 = int(m_roiBottom->value() / 100.0f * h);
-        if (x1 > x0 && y1 > y0) {
+        cv::Rect roi = roiRect(img.size());
+        if (!roi.empty()) {
             cv::Scalar c(m_roiColor.blue(),
                          m_roiColor.green(),
                          m_roiColor.red());
-            cv::rectangle(img, cv::Point(x0, y0), cv::Point(x1, y1), c, 2);
+            // Thin outline while the tracked box is lost and held
+            cv::rectangle(img, roi.tl(), roi.br(), c, m_tracker.isLost() ? 1 : 2);
         }
     }
 
@@ -571,6 +958,97 @@ void NDVIApp::drawOverlay(cv::Mat &img, const cv::Mat &ndvi)
         cv::putText(img, "REC", cv::Point(w - 80, 30),
                     cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 255), 2);
     }
+
+    // Keyframe counter, highlighted on the frame that was kept
+    if (m_keyframeBtn->isChecked()) {
+        cv::putText(img, QString("KEY %1/%2").arg(m_keyframes.keyframes())
+                             .arg(m_keyframes.frames()).toStdString(),
+                    cv::Point(w - 260, 90), cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                    m_lastKeyframe ? cv::Scalar(0, 0, 255) : cv::Scalar(0, 255, 0), 2);
+    }
+
+    // Quality gate tag and drop count
+    if (m_quality.mode() != FrameQuality::Off) {
+        QString tag = qualityTag(m_lastQualityFlags);
+        if (m_droppedFrames > 0) tag += QString(" Drop:%1").arg(m_droppedFrames);
+        if (!tag.trimmed().isEmpty()) {
+            cv::putText(img, tag.trimmed().toStdString(), cv::Point(w - 260, 60),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 165, 255), 2);
+        }
+    }
+}
+
+/**
+ * @brief qualityTag names the quality flags set in @p flags.
+ */
+QString NDVIApp::qualityTag(quint8 flags)
+{
+    QStringList names;
+    if (flags & FrameQuality::QUALITY_BLUR)   names << "BLUR";
+    if (flags & FrameQuality::QUALITY_DARK)   names << "DARK";
+    if (flags & FrameQuality::QUALITY_BRIGHT) names << "BRIGHT";
+    return names.join(' ');
+}
+
+/**
+ * @brief roiRect returns the active ROI: the tracked box while tracking a
+ * frame of this size, otherwise the slider rectangle.
+ * @param size frame size the ROI applies to
+ * @return the ROI rectangle, or an empty rectangle if there is none
+ */
+cv::Rect NDVIApp::roiRect(const cv::Size &size) const
+{
+    if (m_tracker.isTracking() && m_tracker.frameSize() == size) {
+        return m_tracker.rect();
+    }
+    return sliderRoiRect(size);
+}
+
+/**
+ * @brief sliderRoiRect converts the ROI slider percentages into a pixel rectangle.
+ * @param size frame size the ROI applies to
+ * @return the ROI rectangle, or an empty rectangle if the sliders are inverted
+ */
+cv::Rect NDVIApp::sliderRoiRect(const cv::Size &size) const
+{
+    int x0 = int(m_roiLeft->value() / 100.0f * size.width);
+    int x1 = int(m_roiRight->value() / 100.0f * size.width);
+    int y0 = int(m_roiTop->value() / 100.0f * size.height);
+    int y1 = int(m_roiBottom->value() / 100.0f * size.height);
+    if (x1 <= x0 || y1 <= y0) {
+        return cv::Rect();
+    }
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/**
+ * @brief updateRoiTracking seeds the tracker from the sliders when tracking
+ * is switched on or the sliders move, otherwise follows the box into the
+ * frame held by m_pyramid.
+ */
+void NDVIApp::updateRoiTracking()
+{
+    if (!m_roiToggle->isChecked() || !m_trackChk->isChecked()) {
+        m_tracker.stop();
+        return;
+    }
+    if (m_trackSeed || !m_tracker.isTracking()) {
+        m_trackSeed = false;
+        if (m_tracker.start(m_pyramid, sliderRoiRect(m_pyramid.size()))) {
+            logMessage("ROI tracking");
+        } else {
+            logMessage("ROI too small to track");
+            m_trackChk->setChecked(false);
+        }
+        return;
+    }
+    bool wasLost = m_tracker.isLost();
+    bool found = m_tracker.update(m_pyramid);
+    if (found && wasLost) {
+        logMessage("ROI track reacquired");
+    } else if (!found && !wasLost && m_tracker.isTracking()) {
+        logMessage(QString("ROI track lost (score %1)").arg(m_tracker.score(), 0, 'f', 2));
+    }
 }
 
 /**
@@ -582,16 +1060,97 @@ void NDVIApp::startCamera()
         logMessage("Camera already running");
         return;
     }
+    if (m_camBox->currentText() == "Synthetic") {
+        SceneParams params = m_sceneParams;
+        params.stamp = params.stamp || m_probe.mode() == LatencyProbe::Stamp;
+        m_feedStamped = params.stamp;
+        auto source = std::make_unique<SyntheticSource>(params);
+        const QString name = source->description();
+        CaptureThread *thread = new CaptureThread(std::move(source), this);
+        const CaptureThread::Pacing pacing = CaptureThread::Pacing(m_pacingBox->currentIndex());
+        thread->setPacing(pacing, params.frameRate);
+        thread->setLoop(true);
+        m_unthrottled = pacing != CaptureThread::RealTime;
+        m_replayExact = false;
+        startCapture(thread);
+        logMessage(QString("Feed on (%1, %2)").arg(name, m_pacingBox->currentText()));
+        return;
+    }
     int idx = m_camBox->currentIndex();
-    m_captureThread = new CaptureThread(idx, this);
+    int nirIdx = m_nirBox->currentIndex() - 1;  // "None" → -1
+    // The dual path is sized for the full camera rate (30 fps at 1080p)
+    m_unthrottled = nirIdx >= 0;
+    m_replayExact = false;
+    startCapture(new CaptureThread(idx, nirIdx, this));
+    if (nirIdx >= 0) {
+        logMessage(QString("Feed on (Cam %1 + NIR Cam %2)").arg(idx).arg(nirIdx));
+    } else {
+        logMessage(QString("Feed on (Cam %1)").arg(idx));
+    }
+}
+
+/**
+ * @brief startReplay plays a recording through the pipeline: a raw dump,
+ * a video file, or the directory of a picked image as a frame sequence.
+ * A raw dump replays its recorded parameters and processing decisions,
+ * so the session is reproduced exactly.
+ */
+void NDVIApp::startReplay()
+{
+    if (m_captureThread && m_captureThread->isRunning()) {
+        logMessage("Camera already running");
+        return;
+    }
+    QString path = QFileDialog::getOpenFileName(this, "Replay recording", QString(),
+        "Recordings (*.rzdump *.avi *.mp4 *.mkv *.mov *.png *.jpg *.jpeg *.tif *.tiff *.bmp)");
+    if (path.isEmpty()) {
+        return;
+    }
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (QStringList({"png", "jpg", "jpeg", "tif", "tiff", "bmp"}).contains(suffix)) {
+        path = QFileInfo(path).absolutePath();
+    }
+    std::unique_ptr<FrameSource> source;
+    m_replayExact = suffix == "rzdump";
+    if (m_replayExact) {
+        source = std::make_unique<RawDumpSource>(path);
+    } else {
+        source = std::make_unique<ReplaySource>(path);
+    }
+    const QString name = source->description();
+    CaptureThread *thread = new CaptureThread(std::move(source), this);
+    const CaptureThread::Pacing pacing = CaptureThread::Pacing(m_pacingBox->currentIndex());
+    thread->setPacing(pacing);
+    thread->setLoop(m_loopChk->isChecked());
+    // Paced runs are for measurement: process every frame
+    m_unthrottled = pacing != CaptureThread::RealTime;
+    startCapture(thread);
+    logMessage(QString("Replay on (%1, %2%3)").arg(name, m_pacingBox->currentText(),
+                                                  m_loopChk->isChecked() ? ", loop" : ""));
+}
+
+/**
+ * @brief startCapture connects and starts a capture thread.
+ */
+void NDVIApp::startCapture(CaptureThread *thread)
+{
+    m_captureThread = thread;
     connect(m_captureThread, &CaptureThread::frameReady,
             this, &NDVIApp::onFrameReady);
+    connect(m_captureThread, &CaptureThread::dualFrameReady,
+            this, &NDVIApp::onDualFrameReady);
+    connect(m_captureThread, &CaptureThread::sourceParams,
+            this, &NDVIApp::applyPipelineParams);
+    connect(m_captureThread, &CaptureThread::sourceFailed, this, [this](const QString &error) {
+        logMessage(QString("Source failed: %1").arg(error));
+    });
     connect(m_captureThread, &QThread::finished,
             this, &NDVIApp::onCaptureStopped);
+    resetPipelineState();
     m_captureThread->start();
     m_startBtn->setEnabled(false);
+    m_replayBtn->setEnabled(false);
     m_abortBtn->setEnabled(true);
-    logMessage(QString("Feed on (Cam %1)").arg(idx));
 }
 
 /**
@@ -614,79 +1173,265 @@ void NDVIApp::onCaptureStopped()
     delete m_captureThread;
     m_captureThread = nullptr;
     m_startBtn->setEnabled(true);
+    m_replayBtn->setEnabled(true);
     m_abortBtn->setEnabled(false);
     logMessage("Feed off");
 }
 
 /**
- * @brief onFrameReady receives raw frames, throttles processing, and updates views.
+ * @brief onFrameReady receives raw frames from a single camera.
  * @param frame BGR frame from camera
+ * @param meta capture metadata
  */
-void NDVIApp::onFrameReady(const cv::Mat &frame)
+void NDVIApp::onFrameReady(const cv::Mat &frame, const FrameMeta &meta)
 {
+    processFrame(frame, cv::Mat(), meta);
+    if (m_captureThread && m_captureThread->isSource()) {
+        m_captureThread->frameConsumed();
+    }
+}
+
+/**
+ * @brief onDualFrameReady receives a timestamp-matched RGB/NIR pair.
+ * @param rgb frame from the visible camera
+ * @param nir frame from the NIR camera
+ * @param meta capture metadata
+ */
+void NDVIApp::onDualFrameReady(const cv::Mat &rgb, const cv::Mat &nir, const FrameMeta &meta)
+{
+    m_lastRawRgb = rgb;
+    m_lastRawNir = nir;
+    processFrame(rgb, nir, meta);
+    if (m_captureThread && m_captureThread->isSource()) {
+        m_captureThread->frameConsumed();
+    }
+}
+
+/**
+ * @brief processFrame throttles processing and updates views.
+ * @param frame BGR frame (the RGB camera on a dual rig)
+ * @param nir NIR frame on a dual rig, empty for a single camera
+ * @param meta capture metadata
+ */
+void NDVIApp::processFrame(const cv::Mat &frame, const cv::Mat &nir, const FrameMeta &meta)
+{
+    if (frame.empty()) {
+        logMessage("Camera open failed");
+        return;
+    }
+    RAZIEL_TRACE_FRAME(meta.sequence);
+    RAZIEL_TRACE_SCOPE("frame");
+    RAZIEL_TRACE_FLOW_END("frame", meta.sequence);
+    if (m_probe.mode() != LatencyProbe::Off) {
+        // Flash region: the ROI, else the middle of the frame
+        const cv::Rect region = m_roiToggle->isChecked()
+            ? roiRect(frame.size()) : cv::Rect(frame.cols / 4, frame.rows / 4, frame.cols / 2, frame.rows / 2);
+        m_probe.inspect(frame, region);
+    }
     double now = static_cast<double>(cv::getTickCount()) / cv::getTickFrequency();
     // Always display raw feed immediately
     setPixmap(m_rawView, frame);
 
-    // Throttle NDVI computations
-    if (now - m_lastProcessTime < m_processInterval) {
+    // Throttle NDVI computations to maxProcessFps (settings, 0 = every
+    // frame); a raw dump replays the recorded decisions
+    const bool throttled = m_replayExact
+        ? meta.throttled
+        : !m_unthrottled && now - m_lastProcessTime < m_processInterval;
+
+    // Raw dump: the camera frames as received, with any parameter change first
+    if (m_dump.isOpen()) {
+        const QJsonObject params = pipelineParams();
+        if (params != m_dumpParams) {
+            m_dump.writeParams(params);
+            m_dumpParams = params;
+        }
+        m_dump.writeFrame(frame, nir, meta, throttled);
+    }
+    if (throttled) {
         return;
     }
-    m_lastProcessTime = now;
 
-    // Apply digital zoom prior to NDVI computation
-    cv::Mat procInput = frame;
-    int z = m_zoomSlider->value();
-    if (z > 1) {
-        int h0 = procInput.rows;
-        int w0 = procInput.cols;
-        int cx = w0 / 2;
-        int cy = h0 / 2;
-        int ws = w0 / z;
-        int hs = h0 / z;
-        if (ws > 0 && hs > 0) {
-            cv::Rect zoomRect(cx - ws / 2, cy - hs / 2, ws, hs);
-            procInput = procInput(zoomRect);
-            cv::resize(procInput, procInput, cv::Size(w0, h0), 0, 0, cv::INTER_LINEAR);
+    // Score sharpness and exposure on the raw frame; a dropped frame does
+    // not use up the processing slot, so the next good frame runs at once
+    FrameMeta gated = meta;
+    if (!m_quality.assess(frame, gated) && m_quality.mode() == FrameQuality::Drop) {
+        ++m_droppedFrames;
+        m_lastQualityFlags = gated.qualityFlags;
+        if (m_dropRun++ == 0) {
+            logMessage(QString("Gate dropping frames: %1").arg(qualityTag(gated.qualityFlags)));
+        }
+        // Keep the keyframe selector's motion estimate current, so the
+        // first good frame after a drop run is judged against real motion
+        if (m_keyframeBtn->isChecked() || m_mosaic.isOpen()) {
+            cv::Mat dropInput;
+            m_geometry.setUndistort(m_undistortChk->isChecked() && nir.empty());
+            m_geometry.apply(frame, dropInput, m_zoomSlider->value(),
+                             m_panXSlider->value() / 100.0, m_panYSlider->value() / 100.0);
+            m_pyramid.reset(dropInput);
+            m_keyframes.update(m_pyramid, false);
         }
+        // The processed views hold the last good frame; mark the raw view
+        cv::Mat marked = frame.clone();
+        cv::putText(marked, QString("GATE DROP %1 (%2)").arg(qualityTag(gated.qualityFlags))
+                                .arg(m_dropRun).toStdString(),
+                    cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7,
+                    cv::Scalar(0, 165, 255), 2);
+        setPixmap(m_rawView, marked);
+        return;
+    }
+    if (m_dropRun > 0) {
+        logMessage(QString("Gate passing again after %1 dropped frames").arg(m_dropRun));
+        m_dropRun = 0;
+    }
+    m_lastQualityFlags = gated.qualityFlags;
+    m_lastProcessTime = now;
+
+    // Processed-frame rate for the telemetry panel, smoothed over ~10 frames
+    if (m_lastTime > 0.0 && now > m_lastTime) {
+        const float instant = float(1.0 / (now - m_lastTime));
+        m_fps = m_fps > 0.0f ? 0.9f * m_fps + 0.1f * instant : instant;
+    }
+    m_lastTime = now;
+    m_probe.beginFrame(meta);
+
+    // Apply undistortion, digital zoom and pan as one remap prior to NDVI computation
+    StageTimer remapTimer(StageProfiler::Remap, qint64(frame.total()));
+    cv::Mat procInput;
+    double zoom = m_zoomSlider->value();
+    double panX = m_panXSlider->value() / 100.0;
+    double panY = m_panYSlider->value() / 100.0;
+    // The dual-rig homography is fitted on raw frames, so only zoom/pan apply there
+    m_geometry.setUndistort(m_undistortChk->isChecked() && nir.empty());
+    m_geometry.apply(frame, procInput, zoom, panX, panY);
+    if (!nir.empty()) {
+        m_registration.prepare(procInput.size(), nir,
+                               GeometryRemap::viewTransform(frame.size(), zoom, panX, panY));
+    }
+
+    // Grey pyramid shared by the ROI tracker and the guided filter
+    m_pyramid.reset(procInput);
+    remapTimer.stop();
+    m_probe.mark(LatencyProbe::Remap);
+    updateRoiTracking();
+
+    // Keyframe selection: in Key mode only keyframes reach the recording
+    // and the contour stream; flagged frames never become keyframes
+    const bool keyMode = m_keyframeBtn->isChecked();
+    const bool mosaicMode = m_mosaic.isOpen();
+    if (keyMode || mosaicMode) {
+        gated.keyframe = m_keyframes.update(m_pyramid, gated.qualityFlags == 0);
     }
+    m_lastKeyframe = gated.keyframe;
 
     // Prepare LUT if first time
     if (m_lut.empty()) {
         // default NDVI Classic
-        m_lut = makeLUT(Qt::white, Qt::darkRed, Qt::green);
+        m_lut = paletteLUT("NDVI Classic");
     }
 
     // Compute NDVI on full resolution
     float vmin = m_minSlider->value() / 100.0f;
     float vmax = m_maxSlider->value() / 100.0f;
-    cv::Mat ndviMat;
-    cv::Mat coloured = computeNDVI(procInput, vmin, vmax, m_lut, ndviMat);
+    cv::Mat ndviMat, maskMat;
+    NDVIStats stats;
+    StageTimer indexTimer(StageProfiler::Index, qint64(procInput.total()));
+    cv::Mat coloured = computeNDVI(procInput, nir, vmin, vmax, m_lut, ndviMat, maskMat, stats);
+    indexTimer.stop();
+    m_probe.mark(LatencyProbe::Index);
+
+    // Optional temporal denoising and edge-preserving smoothing;
+    // re-colourise from the refined plane
+    if (m_temporal.mode() != TemporalFilter::Off || m_guidedChk->isChecked()) {
+        StageTimer timer(StageProfiler::Colourise, qint64(ndviMat.total()));
+        if (m_temporal.mode() != TemporalFilter::Off) {
+            m_temporal.apply(ndviMat, maskMat);
+        }
+        if (m_guidedChk->isChecked()) {
+            m_guided.apply(m_pyramid.level(0), ndviMat, maskMat);
+        }
+        m_kernel.colourise(ndviMat, maskMat, m_lut, coloured, &stats);
+        timer.stop();
+        m_probe.mark(LatencyProbe::Refine);
+    }
+
+    // Accumulate the composite from the (filtered) NDVI plane; flagged
+    // frames are shown but kept out of the composite and the recording
+    const bool flagged = gated.qualityFlags != 0;
+    if (!flagged) {
+        m_compositor.add(ndviMat, maskMat);
+    }
+
+    // Contour lines for the overlay and the vector stream
+    if (m_contourChk->isChecked() || m_contourFile.isOpen()) {
+        m_lastIsolines = m_isolines.extract(ndviMat, maskMat);
+        if (m_contourFile.isOpen() && (!keyMode || gated.keyframe)) {
+            writeContours(gated);
+        }
+    } else {
+        m_lastIsolines.clear();
+    }
     m_lastNDVI = ndviMat;
+    m_lastMask = maskMat;
+    m_lastFrame = procInput;
+    m_lastNir = nir;
 
     // Blend if required
     if (m_blendChk->isChecked()) {
+        StageTimer timer(StageProfiler::Blend, qint64(coloured.total()));
         float alpha = m_alphaSlider->value() / 100.0f;
         cv::addWeighted(coloured, alpha, procInput, 1.0f - alpha, 0.0f, coloured);
     }
 
-
     // Draw overlays (grid, crosshair, ROI, REC indicator)
-    drawOverlay(coloured, ndviMat);
+    {
+        StageTimer timer(StageProfiler::Overlay, qint64(coloured.total()));
+        drawOverlay(coloured, ndviMat, maskMat, stats);
+    }
+    m_probe.mark(LatencyProbe::Overlay);
 
     // Resize to display label dimensions
     cv::Mat display;
-    cv::resize(coloured, display,
-               cv::Size(m_procView->width(), m_procView->height()),
-               0, 0, cv::INTER_LINEAR);
+    const cv::Size displaySize(m_procView->width(), m_procView->height());
+    StageTimer scaleTimer(StageProfiler::Scale, qint64(displaySize.area()));
+    if (mosaicMode) {
+        // Place keyframes on the canvas by their phase-correlated shift
+        if (gated.keyframe) {
+            const cv::Rect b = m_mosaic.bounds();
+            if (m_keyframes.keyTrusted() || b.empty()) {
+                m_mosaicOrigin -= m_keyframes.keyShift();
+            } else {
+                // Tracking was lost: start a new strip clear of the canvas so
+                // the unplaced keyframe cannot overwrite what is already mapped
+                m_mosaicOrigin = cv::Point2d(b.x + b.width + ndviMat.cols / 4, b.y);
+                logMessage(QString("Mosaic lost track, re-anchored at %1,%2")
+                               .arg(cvRound(m_mosaicOrigin.x)).arg(cvRound(m_mosaicOrigin.y)));
+            }
+            m_mosaic.blend(ndviMat, maskMat,
+                           cv::Point(cvRound(m_mosaicOrigin.x), cvRound(m_mosaicOrigin.y)));
+        }
+        renderMosaic(ndviMat.size(), displaySize, display);
+    } else {
+        cv::resize(coloured, display, displaySize, 0, 0, cv::INTER_LINEAR);
+    }
+    scaleTimer.stop();
+    m_probe.mark(LatencyProbe::Scale);
 
     // Update processed view
-    setPixmap(m_procView, display);
+    {
+        StageTimer timer(StageProfiler::Paint, qint64(display.total()));
+        setPixmap(m_procView, display);
+    }
+    m_probe.mark(LatencyProbe::Paint);
 
     // Record if active
-    if (m_recordBtn->isChecked() && m_videoWriter.isOpened()) {
+    if (m_recordBtn->isChecked() && m_videoWriter.isOpened() && !flagged
+        && (!keyMode || gated.keyframe)) {
+        StageTimer timer(StageProfiler::Encode, qint64(display.total()));
         m_videoWriter.write(display);
+        timer.stop();
+        m_probe.mark(LatencyProbe::Encode);
     }
+    m_probe.endFrame();
 }
 
 /**
@@ -699,7 +1444,55 @@ void NDVIApp::onPreviewTimer()
     }
     float vmin = m_minSlider->value() / 100.0f;
     float vmax = m_maxSlider->value() / 100.0f;
-    updatePreview(vmin, vmax, m_lastNDVI);
+    updatePreview(vmin, vmax, m_lastNDVI, m_lastMask);
+}
+
+/**
+ * @brief onProfileTimer refreshes the profiler HUD from the last second of
+ * stage samples and periodically dumps the stage table to the log.
+ */
+void NDVIApp::onProfileTimer()
+{
+    const StageProfiler::Snapshot snap = StageProfiler::snapshot();
+    if (m_hudChk->isChecked()) {
+        const StageProfiler::Snapshot window = snap.since(m_profileSnap);
+        const bool counters = PerfCounters::isEnabled();
+        // Counter columns: "--" where the stage or event was not counted
+        auto rate = [](double v, int width, int decimals) {
+            return v >= 0.0 ? QString("%1").arg(v, width, 'f', decimals)
+                            : QString("--").rightJustified(width);
+        };
+        m_hudLines.clear();
+        m_hudLines.push_back(std::string("stage        p50    p95    p99 ms    fps")
+                             + (counters ? "   IPC  cyc/px  LLC/px   br/px" : ""));
+        for (int s = 0; s < StageProfiler::STAGE_COUNT; ++s) {
+            const StageStats st = window.stats(StageProfiler::Stage(s));
+            if (st.count > 0) {
+                QString line = QString("%1 %2 %3 %4 %5")
+                                   .arg(StageProfiler::name(StageProfiler::Stage(s)), -9)
+                                   .arg(st.p50Us / 1000.0, 6, 'f', 2)
+                                   .arg(st.p95Us / 1000.0, 6, 'f', 2)
+                                   .arg(st.p99Us / 1000.0, 6, 'f', 2)
+                                   .arg(st.fps, 9, 'f', 1);
+                if (counters) {
+                    line += QString(" %1 %2 %3 %4")
+                                .arg(rate(st.ipc, 5, 2), rate(st.cyclesPerPx, 7, 1),
+                                     rate(st.llcPerPx, 7, 4), rate(st.branchPerPx, 7, 4));
+                }
+                m_hudLines.push_back(line.toStdString());
+            }
+        }
+    }
+    m_profileSnap = snap;
+
+    if (m_profileLogInterval > 0
+        && snap.takenUs() - m_profileLogSnap.takenUs() >= m_profileLogInterval * 1000000LL) {
+        const QStringList lines = snap.since(m_profileLogSnap).report();
+        if (!lines.isEmpty()) {
+            logMessage("Stage latency:<br>" + lines.join("<br>"));
+        }
+        m_profileLogSnap = snap;
+    }
 }
 
 /**
@@ -708,21 +1501,269 @@ void NDVIApp::onPreviewTimer()
  */
 void NDVIApp::changePalette(const QString &name)
 {
-    if (name == "NDVI Classic") {
-        m_lut = makeLUT(Qt::white, Qt::darkRed, Qt::green);
-    } else if (name == "Infrared") {
-        m_lut = makeLUT(Qt::black, Qt::red, Qt::white);
-    } else if (name == "Thermal") {
-        m_lut = makeLUT(Qt::blue, Qt::yellow, Qt::red);
-    } else if (name == "Grayscale") {
-        m_lut = makeLUT(Qt::black, Qt::gray, Qt::white);
-    } else {
+    cv::Mat lut = paletteLUT(name);
+    if (lut.empty()) {
         logMessage(QString("Unknown palette %1").arg(name));
         return;
     }
+    m_lut = lut;
     logMessage(QString("Palette %1").arg(name));
 }
 
+/**
+ * @brief changeGateMode switches the frame quality gate.
+ * @param index combo index: 0 = Off, 1 = Flag, 2 = Drop
+ */
+void NDVIApp::changeGateMode(int index)
+{
+    m_quality.setMode(static_cast<FrameQuality::Mode>(index));
+    m_lastQualityFlags = 0;
+    m_droppedFrames = 0;
+    m_dropRun = 0;
+    logMessage(QString("Gate %1").arg(m_gateBox->itemText(index)));
+}
+
+/**
+ * @brief changeTemporalMode switches the temporal NDVI filter.
+ * @param index combo index: 0 = Off, 1 = EMA, 2 = Box
+ */
+void NDVIApp::changeTemporalMode(int index)
+{
+    m_temporal.setMode(static_cast<TemporalFilter::Mode>(index));
+    logMessage(QString("Temporal %1").arg(m_temporalBox->itemText(index)));
+}
+
+/**
+ * @brief changeCompositeMode switches the temporal composite.
+ * @param index combo index: 0 = Off, 1 = Max NDVI, 2 = Median, 3 = P90
+ */
+void NDVIApp::changeCompositeMode(int index)
+{
+    m_compositor.setPercentile(90.0f);
+    m_compositor.setMode(static_cast<Compositor::Mode>(index));
+    logMessage(QString("Composite %1").arg(m_compositeBox->itemText(index)));
+}
+
+/**
+ * @brief exportComposite writes the current composite as a float NDVI
+ * TIFF and a palette-coloured PNG. Accumulation continues afterwards.
+ */
+void NDVIApp::exportComposite()
+{
+    cv::Mat ndvi, mask;
+    if (!m_compositor.composite(ndvi, mask)) {
+        logMessage("Composite: nothing accumulated");
+        return;
+    }
+    if (m_lut.empty()) {
+        m_lut = paletteLUT("NDVI Classic");
+    }
+    cv::Mat coloured;
+    m_kernel.colourise(ndvi, mask, m_lut, coloured);
+
+    QString base = timestampedFilename("comp", "");
+    bool ok = cv::imwrite((base + ".tiff").toStdString(), ndvi)
+           && cv::imwrite((base + ".png").toStdString(), coloured);
+    if (ok) {
+        logMessage(QString("Composite (%1 fr) → %2").arg(m_compositor.frames()).arg(base));
+    } else {
+        logMessage("Composite export failed");
+    }
+}
+
+/**
+ * @brief toggleContourStream starts/stops streaming contours to a
+ * GeoJSON-lines file (one MultiLineString feature per level per frame).
+ * @param checked true to start, false to stop
+ */
+void NDVIApp::toggleContourStream(bool checked)
+{
+    if (checked) {
+        m_contourFile.setFileName(timestampedFilename("iso", ".geojsonl"));
+        if (!m_contourFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            m_contourRecBtn->setChecked(false);
+            logMessage("Contour stream init failed");
+            return;
+        }
+        logMessage(QString("Contour stream → %1").arg(m_contourFile.fileName()));
+    } else if (m_contourFile.isOpen()) {
+        m_contourFile.close();
+        logMessage("Contour stream stopped");
+    }
+}
+
+/**
+ * @brief writeContours appends the last extracted contours to the stream.
+ * Coordinates are processed-frame pixels.
+ * @param meta metadata of the frame the contours belong to
+ */
+void NDVIApp::writeContours(const FrameMeta &meta)
+{
+    for (float level : m_isolines.levels()) {
+        QJsonArray lines;
+        for (const Isoline &line : m_lastIsolines) {
+            if (line.level != level) continue;
+            QJsonArray coords;
+            for (const cv::Point2f &p : line.points) {
+                coords.append(QJsonArray{ p.x, p.y });
+            }
+            if (line.closed && !line.points.empty()) {
+                coords.append(QJsonArray{ line.points.front().x, line.points.front().y });
+            }
+            lines.append(coords);
+        }
+        QJsonObject geometry;
+        geometry["type"] = "MultiLineString";
+        geometry["coordinates"] = lines;
+        QJsonObject props;
+        props["seq"] = meta.sequence;
+        props["t_us"] = meta.timestampUs;
+        props["level"] = level;
+        QJsonObject feature;
+        feature["type"] = "Feature";
+        feature["properties"] = props;
+        feature["geometry"] = geometry;
+        m_contourFile.write(QJsonDocument(feature).toJson(QJsonDocument::Compact));
+        m_contourFile.write("\n");
+    }
+}
+
+/**
+ * @brief toggleKeyframeMode restricts recording and the contour stream to
+ * keyframes. Each activation starts a new run from the current frame.
+ * @param checked true to enable
+ */
+void NDVIApp::toggleKeyframeMode(bool checked)
+{
+    if (checked) {
+        m_keyframes.reset();
+        logMessage(QString("Keyframes at %1% overlap")
+                       .arg(int(m_keyframes.overlap() * 100.0f + 0.5f)));
+    } else {
+        logMessage(QString("Keyframes off (%1 of %2 frames kept)")
+                       .arg(m_keyframes.keyframes()).arg(m_keyframes.frames()));
+    }
+}
+
+/**
+ * @brief toggleMosaic starts a new mosaic canvas or closes the current one.
+ * Keyframes are selected while the mosaic is open even if Key is off.
+ * @param checked true to start
+ */
+void NDVIApp::toggleMosaic(bool checked)
+{
+    if (checked) {
+        if (!m_mosaic.open(m_mosaicPath)) {
+            m_mosaicBtn->setChecked(false);
+            logMessage("Mosaic init failed");
+            return;
+        }
+        m_keyframes.reset();
+        m_mosaicOrigin = cv::Point2d();
+        logMessage(QString("Mosaic started → %1").arg(m_mosaicPath));
+    } else if (m_mosaic.isOpen()) {
+        cv::Rect b = m_mosaic.bounds();
+        logMessage(QString("Mosaic stopped (%1x%2 px, %3 tiles)")
+                       .arg(b.width).arg(b.height).arg(m_mosaic.tileCount()));
+        m_mosaic.close();
+    }
+}
+
+/**
+ * @brief renderMosaic draws the canvas around the current view at display
+ * resolution: three frame widths across, centred on the live frame, whose
+ * outline is drawn on top.
+ * @param frameSize size of the processed frame
+ * @param outSize display size
+ * @param display receives the coloured BGR view
+ */
+void NDVIApp::renderMosaic(const cv::Size &frameSize, const cv::Size &outSize, cv::Mat &display)
+{
+    const cv::Point2d live = m_mosaicOrigin - m_keyframes.displacement();
+    const int viewW = 3 * frameSize.width;
+    const int viewH = std::max(1, viewW * outSize.height / std::max(outSize.width, 1));
+    const cv::Point2d centre = live + cv::Point2d(frameSize.width, frameSize.height) * 0.5;
+    const cv::Rect view(cvRound(centre.x - viewW * 0.5), cvRound(centre.y - viewH * 0.5),
+                        viewW, viewH);
+
+    cv::Mat ndvi, mask;
+    m_mosaic.render(view, outSize, ndvi, mask);
+    m_kernel.colourise(ndvi, mask, m_lut, display);
+
+    const double s = double(outSize.width) / viewW;
+    cv::Point tl(cvRound((live.x - view.x) * s), cvRound((live.y - view.y) * s));
+    cv::Point br(cvRound((live.x + frameSize.width - view.x) * s),
+                 cvRound((live.y + frameSize.height - view.y) * s));
+    cv::rectangle(display, tl, br, cv::Scalar(0, 255, 0), 1);
+    cv::putText(display, QString("MOSAIC %1 tiles, %2 mapped").arg(m_mosaic.tileCount())
+                             .arg(m_mosaic.residentCount()).toStdString(),
+                cv::Point(10, outSize.height - 12), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                cv::Scalar(0, 255, 0), 1);
+}
+
+/**
+ * @brief processOrthomosaic runs the out-of-core tiled NDVI job on an ENVI
+ * raster in a background thread, with the current gains, window, mask
+ * thresholds and palette. Clicking again while it runs cancels it.
+ */
+void NDVIApp::processOrthomosaic()
+{
+    if (m_orthoThread) {
+        m_orthoJob->cancel();
+        logMessage("Ortho: cancelling");
+        return;
+    }
+    QString input = QFileDialog::getOpenFileName(this, "Orthomosaic", QString(),
+                                                 "ENVI header (*.hdr);;All files (*)");
+    if (input.isEmpty()) {
+        return;
+    }
+    QString outDir = QFileDialog::getExistingDirectory(this, "Output directory");
+    if (outDir.isEmpty()) {
+        return;
+    }
+
+    if (m_lut.empty()) {
+        m_lut = paletteLUT("NDVI Classic");
+    }
+    NDVIKernel kernel = m_kernel;
+    kernel.configure(m_minSlider->value() / 100.0f, m_maxSlider->value() / 100.0f);
+    kernel.setMaskThresholds(m_satSpin->value(), m_minSignalSpin->value());
+    m_orthoJob = std::make_shared<TiledBatchProcessor>(kernel, m_lut);
+    m_orthoJob->setTileSize(m_orthoTileSize);
+    m_orthoJob->setBands(m_orthoNirBand, m_orthoVisBand);
+    m_orthoJob->setShift(m_orthoShift);
+    m_orthoJob->setProgress([this](int done, int total) {
+        // Log every 10%, on the GUI thread
+        if (done * 10 / total != (done - 1) * 10 / total) {
+            QMetaObject::invokeMethod(this, [this, done, total]() {
+                logMessage(QString("Ortho: %1/%2 tiles").arg(done).arg(total));
+            }, Qt::QueuedConnection);
+        }
+    });
+
+    std::shared_ptr<TiledBatchProcessor> job = m_orthoJob;
+    m_orthoThread = QThread::create([job, input, outDir]() { job->run(input, outDir); });
+    connect(m_orthoThread, &QThread::finished, this, [this, outDir]() {
+        if (m_orthoJob->error().isEmpty()) {
+            const TileStats &t = m_orthoJob->totals();
+            logMessage(QString("Ortho done → %1 (mean %2, %3 Mpx/s)")
+                           .arg(outDir)
+                           .arg(t.ndvi.mean(), 0, 'f', 3)
+                           .arg(t.ndvi.total / 1e6 / std::max(m_orthoJob->seconds(), 1e-6), 0, 'f', 1));
+        } else {
+            logMessage(QString("Ortho failed: %1").arg(m_orthoJob->error()));
+        }
+        m_orthoThread->deleteLater();
+        m_orthoThread = nullptr;
+        m_orthoJob.reset();
+        m_orthoBtn->setText("Ortho");
+    });
+    m_orthoThread->start();
+    m_orthoBtn->setText("Cancel");
+    logMessage(QString("Ortho: %1").arg(input));
+}
+
 /**
  * @brief takeSnapshot saves the processed view as PNG.
  */
@@ -766,9 +1807,343 @@ void NDVIApp::toggleRecording(bool checked)
     }
 }
 
+/**
+ * @brief toggleRawDump starts/stops dumping raw camera frames, metadata
+ * and parameter changes. Stateful stages restart with the dump so that
+ * replaying it from the first frame reproduces the session.
+ */
+void NDVIApp::toggleRawDump(bool checked)
+{
+    if (checked) {
+        const QString filename = timestampedFilename("dump", ".rzdump");
+        if (!m_dump.open(filename)) {
+            m_dumpBtn->setChecked(false);
+            logMessage(QString("Dump init failed: %1").arg(m_dump.error()));
+            return;
+        }
+        m_dumpParams = QJsonObject();
+        resetPipelineState();
+        logMessage(QString("Raw dump started → %1").arg(filename));
+    } else if (m_dump.isOpen()) {
+        const qint64 frames = m_dump.framesWritten();
+        const qint64 dropped = m_dump.dropped();
+        m_dump.close();
+        logMessage(QString("Raw dump stopped (%1 frames, %2 dropped)").arg(frames).arg(dropped));
+    }
+}
+
+/**
+ * @brief toggleTrace starts a timeline trace, or stops it and writes it
+ * as Chrome trace-event JSON.
+ * @param checked true to start, false to stop and write
+ */
+void NDVIApp::toggleTrace(bool checked)
+{
+    if (!TraceRecorder::available()) {
+        if (checked) {
+            m_traceBtn->setChecked(false);
+            logMessage("Tracing not built (RAZIEL_TRACING=OFF)");
+        }
+        return;
+    }
+    if (checked) {
+        TraceRecorder::setEnabled(true);
+        logMessage("Trace started");
+    } else if (TraceRecorder::isEnabled()) {
+        TraceRecorder::setEnabled(false);
+        const QString filename = timestampedFilename("trace", ".json");
+        if (TraceRecorder::dump(filename)) {
+            logMessage(QString("Trace saved → %1").arg(filename));
+        } else {
+            logMessage("Trace save failed");
+        }
+    }
+}
+
+/**
+ * @brief togglePerfCounters turns the per-stage hardware counters on or
+ * off; where perf events are unavailable the box unticks with the reason.
+ * @param checked true to count
+ */
+void NDVIApp::togglePerfCounters(bool checked)
+{
+    if (!checked) {
+        if (PerfCounters::isEnabled()) {
+            PerfCounters::setEnabled(false);
+            logMessage("Hardware counters off");
+        }
+        return;
+    }
+    if (!PerfCounters::setEnabled(true)) {
+        m_perfChk->setChecked(false);
+        logMessage("Hardware counters unavailable: " + PerfCounters::unavailableReason());
+        return;
+    }
+    QStringList events;
+    for (int e = 0; e < PerfCounters::EVENT_COUNT; ++e) {
+        if (PerfCounters::events() & (1u << e)) {
+            events << PerfCounters::name(PerfCounters::Event(e));
+        }
+    }
+    logMessage("Hardware counters on: " + events.join(", "));
+}
+
+/**
+ * @brief toggleLatency starts a glass-to-glass measurement, or stops it,
+ * logs the distributions and writes the per-frame stage marks as CSV.
+ * The synthetic feed is measured from its stamps; cameras from the flash
+ * marker window, which the camera must see.
+ * @param checked true to start, false to stop and report
+ */
+void NDVIApp::toggleLatency(bool checked)
+{
+    if (checked) {
+        const bool synthetic = m_camBox->currentText() == "Synthetic";
+        m_probe.start(synthetic ? LatencyProbe::Stamp : LatencyProbe::Flash);
+        if (synthetic) {
+            logMessage(m_captureThread && !m_feedStamped
+                       ? "Latency: restart the synthetic feed to stamp its frames"
+                       : "Latency: measuring from synthetic frame stamps");
+            return;
+        }
+        if (!m_flashWindow) {
+            m_flashWindow = new QLabel(this, Qt::Window | Qt::WindowStaysOnTopHint);
+            m_flashWindow->setWindowTitle("Latency marker");
+            m_flashWindow->setAutoFillBackground(true);
+            m_flashWindow->resize(320, 320);
+        }
+        m_flashBright = true;  // the first flip turns it dark
+        onFlashTimer();
+        m_flashWindow->show();
+        logMessage("Latency: point the camera (or the ROI) at the marker window");
+        return;
+    }
+    if (m_probe.mode() == LatencyProbe::Off) {
+        return;
+    }
+    m_flashTimer->stop();
+    if (m_flashWindow) {
+        m_flashWindow->hide();
+    }
+    m_probe.stop();
+    for (const QString &line : m_probe.report()) {
+        logMessage("Latency: " + line);
+    }
+    if (m_probe.samples() > 0) {
+        const QString filename = timestampedFilename("latency", ".csv");
+        if (m_probe.writeCsv(filename)) {
+            logMessage(QString("Latency marks → %1").arg(filename));
+        } else {
+            logMessage("Latency CSV write failed");
+        }
+    }
+}
+
+/**
+ * @brief onFlashTimer flips the marker and arms the detector on the dark
+ * to bright edge. The period is jittered so it cannot lock to the frame rate.
+ */
+void NDVIApp::onFlashTimer()
+{
+    m_flashBright = !m_flashBright;
+    QPalette pal = m_flashWindow->palette();
+    pal.setColor(QPalette::Window, m_flashBright ? Qt::white : Qt::black);
+    m_flashWindow->setPalette(pal);
+    m_flashWindow->repaint();
+    if (m_flashBright) {
+        m_probe.flash(steadyMicros());
+    } else {
+        m_probe.unflash();
+    }
+    const int jitter = int(QRandomGenerator::global()->bounded(m_flashPeriodMs * 3 / 5 + 1));
+    m_flashTimer->start(m_flashPeriodMs * 7 / 10 + jitter);
+}
+
+/**
+ * @brief resetPipelineState restarts the stages that carry state between
+ * frames.
+ */
+void NDVIApp::resetPipelineState()
+{
+    m_temporal.reset();
+    m_quality.reset();
+    m_keyframes.reset();
+    m_droppedFrames = 0;
+    m_dropRun = 0;
+    m_trackSeed = true;
+    m_lastProcessTime = 0.0;
+    m_lastTime = 0.0;
+    m_fps = 0.0f;
+}
+
+/**
+ * @brief pipelineParams snapshots everything that changes processing: the
+ * controls, the stage tunables the settings file sets and the loaded lens
+ * and dual-rig calibration.
+ */
+QJsonObject NDVIApp::pipelineParams() const
+{
+    QJsonObject obj;
+    obj["min"] = m_minSlider->value();
+    obj["max"] = m_maxSlider->value();
+    obj["palette"] = m_paletteBox->currentText();
+    obj["zoom"] = m_zoomSlider->value();
+    obj["panX"] = m_panXSlider->value();
+    obj["panY"] = m_panYSlider->value();
+    obj["undistort"] = m_undistortChk->isChecked();
+    obj["temporal"] = m_temporalBox->currentText();
+    obj["guided"] = m_guidedChk->isChecked();
+    obj["qualityGate"] = m_gateBox->currentText();
+    obj["satLevel"] = m_satSpin->value();
+    obj["minSignal"] = m_minSignalSpin->value();
+    obj["gainRed"] = m_kernel.gains().red;
+    obj["gainBlue"] = m_kernel.gains().blue;
+    obj["blend"] = m_blendChk->isChecked();
+    obj["alpha"] = m_alphaSlider->value();
+    obj["roi"] = m_roiToggle->isChecked();
+    obj["track"] = m_trackChk->isChecked();
+    obj["roiLeft"] = m_roiLeft->value();
+    obj["roiRight"] = m_roiRight->value();
+    obj["roiTop"] = m_roiTop->value();
+    obj["roiBottom"] = m_roiBottom->value();
+
+    obj["temporalAlpha"] = m_temporal.alpha();
+    obj["temporalWindow"] = m_temporal.window();
+    obj["motionThreshold"] = m_temporal.motionThreshold();
+    obj["guidedRadius"] = m_guided.radius();
+    obj["guidedEps"] = m_guided.eps();
+    obj["qualityBlurRatio"] = m_quality.blurRatio();
+    obj["qualityMaxDark"] = m_quality.maxDark();
+    obj["qualityMaxBright"] = m_quality.maxBright();
+    QJsonArray levels;
+    for (float level : m_isolines.levels()) {
+        levels.append(level);
+    }
+    obj["contourLevels"] = levels;
+    obj["contourDownsample"] = m_isolines.downsample();
+    obj["keyframeOverlap"] = m_keyframes.overlap();
+    obj["trackRadius"] = m_tracker.searchRadius();
+    obj["trackMinScore"] = m_tracker.minScore();
+
+    // Calibration, null when none is loaded
+    QJsonValue intrinsics;
+    if (m_geometry.hasIntrinsics()) {
+        QJsonObject k;
+        k["cameraMatrix"] = matToJson(m_geometry.cameraMatrix());
+        k["distCoeffs"] = matToJson(m_geometry.distCoeffs());
+        k["width"] = m_geometry.calibSize().width;
+        k["height"] = m_geometry.calibSize().height;
+        intrinsics = k;
+    }
+    obj["intrinsics"] = intrinsics;
+    obj["homography"] = m_registration.isCalibrated()
+        ? QJsonValue(matToJson(cv::Mat(m_registration.homography()))) : QJsonValue();
+    return obj;
+}
+
+/**
+ * @brief applyPipelineParams restores a snapshot taken by pipelineParams().
+ */
+void NDVIApp::applyPipelineParams(const QJsonObject &params)
+{
+    m_minSlider->setValue(params["min"].toInt(m_minSlider->value()));
+    m_maxSlider->setValue(params["max"].toInt(m_maxSlider->value()));
+    int idx = m_paletteBox->findText(params["palette"].toString());
+    if (idx >= 0) m_paletteBox->setCurrentIndex(idx);
+    m_zoomSlider->setValue(params["zoom"].toInt(m_zoomSlider->value()));
+    m_panXSlider->setValue(params["panX"].toInt(m_panXSlider->value()));
+    m_panYSlider->setValue(params["panY"].toInt(m_panYSlider->value()));
+    m_undistortChk->setChecked(params["undistort"].toBool(m_undistortChk->isChecked()));
+    idx = m_temporalBox->findText(params["temporal"].toString());
+    if (idx >= 0) m_temporalBox->setCurrentIndex(idx);
+    m_guidedChk->setChecked(params["guided"].toBool(m_guidedChk->isChecked()));
+    idx = m_gateBox->findText(params["qualityGate"].toString());
+    if (idx >= 0) m_gateBox->setCurrentIndex(idx);
+    m_satSpin->setValue(params["satLevel"].toInt(m_satSpin->value()));
+    m_minSignalSpin->setValue(params["minSignal"].toInt(m_minSignalSpin->value()));
+    if (params.contains("gainRed") && params.contains("gainBlue")) {
+        BandGains gains;
+        gains.red = float(params["gainRed"].toDouble());
+        gains.blue = float(params["gainBlue"].toDouble());
+        m_kernel.setGains(gains);
+    }
+    m_blendChk->setChecked(params["blend"].toBool(m_blendChk->isChecked()));
+    m_alphaSlider->setValue(params["alpha"].toInt(m_alphaSlider->value()));
+    m_roiToggle->setChecked(params["roi"].toBool(m_roiToggle->isChecked()));
+    m_trackChk->setChecked(params["track"].toBool(m_trackChk->isChecked()));
+    m_roiLeft->setValue(params["roiLeft"].toInt(m_roiLeft->value()));
+    m_roiRight->setValue(params["roiRight"].toInt(m_roiRight->value()));
+    m_roiTop->setValue(params["roiTop"].toInt(m_roiTop->value()));
+    m_roiBottom->setValue(params["roiBottom"].toInt(m_roiBottom->value()));
+
+    if (params["temporalAlpha"].isDouble()) {
+        m_temporal.setAlpha(float(params["temporalAlpha"].toDouble()));
+    }
+    // setWindow() restarts the filter, so only on a real change
+    if (params["temporalWindow"].isDouble() && params["temporalWindow"].toInt() != m_temporal.window()) {
+        m_temporal.setWindow(params["temporalWindow"].toInt());
+    }
+    if (params["motionThreshold"].isDouble()) {
+        m_temporal.setMotionThreshold(float(params["motionThreshold"].toDouble()));
+    }
+    if (params["guidedRadius"].isDouble()) {
+        m_guided.setRadius(params["guidedRadius"].toInt());
+    }
+    if (params["guidedEps"].isDouble()) {
+        m_guided.setEps(float(params["guidedEps"].toDouble()));
+    }
+    if (params["qualityBlurRatio"].isDouble()) {
+        m_quality.setBlurRatio(float(params["qualityBlurRatio"].toDouble()));
+    }
+    if (params["qualityMaxDark"].isDouble()) {
+        m_quality.setMaxDark(float(params["qualityMaxDark"].toDouble()));
+    }
+    if (params["qualityMaxBright"].isDouble()) {
+        m_quality.setMaxBright(float(params["qualityMaxBright"].toDouble()));
+    }
+    if (params["contourLevels"].isArray()) {
+        std::vector<float> levels;
+        for (const QJsonValue &v : params["contourLevels"].toArray()) {
+            if (v.isDouble()) levels.push_back(float(v.toDouble()));
+        }
+        m_isolines.setLevels(levels);
+    }
+    if (params["contourDownsample"].isDouble()) {
+        m_isolines.setDownsample(params["contourDownsample"].toInt());
+    }
+    if (params["keyframeOverlap"].isDouble()) {
+        m_keyframes.setOverlap(float(params["keyframeOverlap"].toDouble()));
+    }
+    if (params["trackRadius"].isDouble()) {
+        m_tracker.setSearchRadius(params["trackRadius"].toInt());
+    }
+    if (params["trackMinScore"].isDouble()) {
+        m_tracker.setMinScore(float(params["trackMinScore"].toDouble()));
+    }
+
+    // Calibration: an object/array installs it, null drops it, absent keeps it
+    if (params["intrinsics"].isObject()) {
+        const QJsonObject k = params["intrinsics"].toObject();
+        m_geometry.setIntrinsics(jsonToMat(k["cameraMatrix"].toArray(), 3),
+                                 jsonToMat(k["distCoeffs"].toArray(), 1),
+                                 cv::Size(k["width"].toInt(), k["height"].toInt()));
+    } else if (params["intrinsics"].isNull()) {
+        m_geometry.clearIntrinsics();
+    }
+    if (params["homography"].isArray()) {
+        const cv::Mat H = jsonToMat(params["homography"].toArray(), 3);
+        if (H.rows == 3 && H.cols == 3) {
+            m_registration.setHomography(cv::Matx33d(H.ptr<double>()));
+        }
+    } else if (params["homography"].isNull()) {
+        m_registration.clear();
+    }
+}
+
 /**
  * @brief autoCalibrate sets sliders to 2nd/98th percentiles of last NDVI,
  * using only the ROI region if enabled and valid, otherwise the full frame.
+ * Pixels flagged in the validity mask are ignored.
  */
 void NDVIApp::autoCalibrate()
 {
@@ -778,33 +2153,33 @@ void NDVIApp::autoCalibrate()
     }
 
     // Determine sample region: ROI if enabled and valid, otherwise full frame
-    cv::Mat sample;
+    cv::Mat sample, sampleMask;
     if (m_roiToggle->isChecked()) {
-        int h = m_lastNDVI.rows;
-        int w = m_lastNDVI.cols;
-        int x0 = int(m_roiLeft->value() / 100.0f * w);
-        int x1 = int(m_roiRight->value() / 100.0f * w);
-        int y0 = int(m_roiTop->value() / 100.0f * h);
-        int y1 = int(m_roiBottom->value() / 100.0f * h);
-        if (x1 > x0 && y1 > y0) {
-            sample = m_lastNDVI(cv::Range(y0, y1), cv::Range(x0, x1));
+        cv::Rect roi = roiRect(m_lastNDVI.size());
+        if (!roi.empty()) {
+            sample = m_lastNDVI(roi);
+            sampleMask = m_lastMask(roi);
             logMessage("AutoCalib: using ROI region");
         } else {
             sample = m_lastNDVI;
+            sampleMask = m_lastMask;
             logMessage("AutoCalib: invalid ROI, using full frame");
         }
     } else {
         sample = m_lastNDVI;
+        sampleMask = m_lastMask;
         logMessage("AutoCalib: using full frame");
     }
 
-    // Flatten and filter out NaNs
+    // Flatten, skipping masked pixels and NaNs
     std::vector<float> vals;
     vals.reserve(sample.total());
     for (int row = 0; row < sample.rows; ++row) {
+        const float *nd = sample.ptr<float>(row);
+        const uchar *mk = sampleMask.ptr<uchar>(row);
         for (int col = 0; col < sample.cols; ++col) {
-            float v = sample.at<float>(row, col);
-            if (v == v) { // not NaN
+            float v = nd[col];
+            if (mk[col] == 0 && v == v) { // valid and not NaN
                 vals.push_back(v);
             }
         }
@@ -828,6 +2203,49 @@ void NDVIApp::autoCalibrate()
     logMessage(QString("AutoCalib %1–%2").arg(p2, 0, 'f', 2).arg(p98, 0, 'f', 2));
 }
 
+/**
+ * @brief calibratePanel solves per-band gains from a reflectance panel
+ * covered by the ROI in the last processed frame; on a dual rig from the
+ * NIR and RGB frames it was computed from. The kernel tables are rebuilt
+ * in place, so capture keeps running.
+ */
+void NDVIApp::calibratePanel()
+{
+    if (m_lastFrame.empty()) {
+        logMessage("PanelCal: no frame yet");
+        return;
+    }
+    cv::Rect roi = roiRect(m_lastFrame.size());
+    if (!m_roiToggle->isChecked() || roi.empty()) {
+        logMessage("PanelCal: enable ROI over the reference panel");
+        return;
+    }
+
+    // A dual rig reads NIR from the NIR camera and visible from RGB red
+    BandGains gains;
+    float reflectance = float(m_panelSpin->value());
+    const bool solved = m_lastNir.empty()
+        ? NDVIKernel::solveGains(m_lastFrame(roi), reflectance, gains)
+        : NDVIKernel::solveGainsDual(m_lastFrame, m_lastNir, m_registration.offsets(),
+                                     m_registration.weights(), roi, reflectance, gains);
+    if (!solved) {
+        logMessage("PanelCal: panel too dark or saturated");
+        return;
+    }
+    m_kernel.setGains(gains);
+    logMessage(QString("PanelCal gains R %1 B %2")
+               .arg(gains.red, 0, 'f', 3).arg(gains.blue, 0, 'f', 3));
+}
+
+/**
+ * @brief resetPanelCalibration restores unit band gains.
+ */
+void NDVIApp::resetPanelCalibration()
+{
+    m_kernel.setGains(BandGains());
+    logMessage("PanelCal reset");
+}
+
 /**
  * @brief chooseCrossColor opens color dialog for crosshair.
  */
@@ -864,6 +2282,46 @@ void NDVIApp::onZoomChanged(int value)
     logMessage(QString("Zoom %1x").arg(value));
 }
 
+/**
+ * @brief loadIntrinsics lets the user pick a camera intrinsics file
+ * (OpenCV YAML/XML) for lens undistortion. Cancelling keeps the loaded
+ * intrinsics; a failed load keeps them too.
+ */
+void NDVIApp::loadIntrinsics()
+{
+    QString path = QFileDialog::getOpenFileName(
+        this, "Camera intrinsics", QString(), "OpenCV calibration (*.yml *.yaml *.xml)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!m_geometry.loadIntrinsics(path.toStdString())) {
+        logMessage(QString("Lens intrinsics load failed: %1").arg(path));
+        return;
+    }
+    m_intrinsicsPath = path;
+    logMessage(QString("Lens intrinsics → %1").arg(path));
+}
+
+/**
+ * @brief registerDual estimates the NIR→RGB homography from the last raw
+ * dual-rig pair (chessboard, else features) and caches it on disk.
+ */
+void NDVIApp::registerDual()
+{
+    if (m_lastRawRgb.empty() || m_lastRawNir.empty()) {
+        logMessage("Register: no dual-rig frames yet");
+        return;
+    }
+    if (!m_registration.estimate(m_lastRawRgb, m_lastRawNir)) {
+        logMessage("Register: no chessboard or feature match");
+        return;
+    }
+    if (!m_registration.save(m_homographyPath.toStdString())) {
+        logMessage("Register: homography cache not written");
+    }
+    logMessage("Register: homography updated");
+}
+
 /**
  * @brief logMessage appends a timestamped entry to the log view.
  */
@@ -892,8 +2350,9 @@ void NDVIApp::setPixmap(QLabel *label, const cv::Mat &bgr)
 
 /**
  * @brief updatePreview draws the colourbar and histogram panels.
+ * The histogram only counts pixels that are valid in the mask.
  */
-void NDVIApp::updatePreview(float vmin, float vmax, const cv::Mat &ndvi)
+void NDVIApp::updatePreview(float vmin, float vmax, const cv::Mat &ndvi, const cv::Mat &mask)
 {
     // Colourbar
     int cb_h = 200, cb_w = 40;
@@ -913,20 +2372,23 @@ void NDVIApp::updatePreview(float vmin, float vmax, const cv::Mat &ndvi)
     QImage qcb(cb.data, cb_w, cb_h, cb.step, QImage::Format_BGR888);
     m_colorbarLabel->setPixmap(QPixmap::fromImage(qcb));
 
-    // Histogram
-    cv::Mat mask = ndvi != ndvi; // nan mask
-    cv::Mat valid;
-    ndvi.copyTo(valid, ~mask);
-    std::vector<float> data;
-    data.assign((float*)valid.datastart, (float*)valid.dataend);
-    if (data.empty()) return;
+    // Histogram over valid pixels
     int bins = 50;
     std::vector<int> hist(bins,0);
-    for (float v : data) {
-        int b = int((v - vmin) / (vmax - vmin) * bins);
-        if (b < 0) b = 0; else if (b >= bins) b = bins-1;
-        hist[b]++;
+    int counted = 0;
+    for (int row = 0; row < ndvi.rows; ++row) {
+        const float *nd = ndvi.ptr<float>(row);
+        const uchar *mk = mask.ptr<uchar>(row);
+        for (int col = 0; col < ndvi.cols; ++col) {
+            float v = nd[col];
+            if (mk[col] != 0 || v != v) continue;
+            int b = int((v - vmin) / (vmax - vmin) * bins);
+            if (b < 0) b = 0; else if (b >= bins) b = bins-1;
+            hist[b]++;
+            counted++;
+        }
     }
+    if (counted == 0) return;
     int hp_h = 200, hp_w = 200;
     cv::Mat hi(hp_h, hp_w, CV_8UC3, cv::Scalar(0,0,0));
     int mx = *std::max_element(hist.begin(), hist.end());
@@ -968,5 +2430,16 @@ void NDVIApp::closeEvent(QCloseEvent *event)
     if (m_videoWriter.isOpened()) {
         m_videoWriter.release();
     }
+    m_dump.close();
+    m_traceBtn->setChecked(false);
+    m_latencyBtn->setChecked(false);
+    if (m_contourFile.isOpen()) {
+        m_contourFile.close();
+    }
+    m_mosaic.close();
+    if (m_orthoThread) {
+        m_orthoJob->cancel();
+        m_orthoThread->wait();
+    }
     event->accept();
 }
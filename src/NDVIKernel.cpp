@@ -0,0 +1,345 @@
+//------------------------------------------------------------------------------
+// src/NDVIKernel.cpp
+//------------------------------------------------------------------------------
+
+#include "NDVIKernel.h"
+
+#include <algorithm>
+#include <mutex>
+
+static constexpr float EPSILON = 1e-9f;  // match Python NDVI denominator
+static constexpr int   TABLE_SIZE = 256 * 256;
+static constexpr double MIN_PANEL_LEVEL = 8.0;  // darkest usable panel mean (DN)
+
+/**
+ * @brief sampleNir bilinearly samples the NIR band at a registration map
+ * entry: byte offset of the top-left sample and packed 8-bit weights.
+ */
+static inline int sampleNir(const uchar *nirData, size_t step, int off, int w)
+{
+    int fx = w & 255;
+    int fy = w >> 8;
+    const uchar *p = nirData + off;
+    int top = p[0] * (256 - fx) + p[3] * fx;
+    int bot = p[step] * (256 - fx) + p[step + 3] * fx;
+    return (top * (256 - fy) + bot * fy + (1 << 15)) >> 16;
+}
+
+/**
+ * @brief NDVIKernel constructor builds the tables for unit gains.
+ */
+NDVIKernel::NDVIKernel()
+    : m_gains()
+    , m_vmin(-1.0f)
+    , m_vmax(1.0f)
+    , m_saturation(255)
+    , m_minSignal(8)
+    , m_ndviTable(TABLE_SIZE, 0.0f)
+    , m_indexTable(TABLE_SIZE, 0)
+    , m_flagTable(TABLE_SIZE, 0)
+{
+    rebuildTables();
+}
+
+/**
+ * @brief setGains replaces the band gains and rebuilds the tables.
+ * @param gains new per-band gains
+ */
+void NDVIKernel::setGains(const BandGains &gains)
+{
+    m_gains = gains;
+    rebuildTables();
+}
+
+/**
+ * @brief configure sets the NDVI window; the index table is only rebuilt
+ * when the window actually changes.
+ */
+void NDVIKernel::configure(float vmin, float vmax)
+{
+    if (vmin == m_vmin && vmax == m_vmax) {
+        return;
+    }
+    m_vmin = vmin;
+    m_vmax = vmax;
+    rebuildTables();
+}
+
+/**
+ * @brief setMaskThresholds sets the saturation and low-signal levels.
+ */
+void NDVIKernel::setMaskThresholds(int saturation, int minSignal)
+{
+    if (saturation == m_saturation && minSignal == m_minSignal) {
+        return;
+    }
+    m_saturation = saturation;
+    m_minSignal = minSignal;
+    rebuildTables();
+}
+
+/**
+ * @brief rebuildTables tabulates NDVI, palette index and validity flags
+ * for every (R,B) pair.
+ */
+void NDVIKernel::rebuildTables()
+{
+    for (int r = 0; r < 256; ++r) {
+        float nir = m_gains.red * r;
+        for (int b = 0; b < 256; ++b) {
+            float vis = m_gains.blue * b;
+            // NDVI = (R - B) / (R + B + epsilon)
+            float v = (nir - vis) / (nir + vis + EPSILON);
+            m_ndviTable[(r << 8) | b] = v;
+
+            uchar flags = 0;
+            if (r >= m_saturation || b >= m_saturation) flags |= MASK_SATURATED;
+            if (r + b < m_minSignal) flags |= MASK_LOW_SIGNAL;
+            m_flagTable[(r << 8) | b] = flags;
+        }
+    }
+
+    for (int i = 0; i < TABLE_SIZE; ++i) {
+        float norm = 0.0f;
+        if (m_vmax > m_vmin) {
+            norm = (m_ndviTable[i] - m_vmin) / (m_vmax - m_vmin);
+            norm = std::min(std::max(norm, 0.0f), 1.0f);
+        }
+        m_indexTable[i] = cv::saturate_cast<uchar>(norm * 255.0f);
+    }
+}
+
+/**
+ * @brief run is the shared fused kernel body. fetch(y, x, src) returns the
+ * (R << 8) | B table key for pixel (x, y), or -1 if it has no valid sample.
+ * Valid-pixel statistics are reduced per stripe, so the mean and masked
+ * fraction need no extra pass over the NDVI plane.
+ */
+template <typename BandFetch>
+void NDVIKernel::run(const cv::Mat &frame, const cv::Mat &lut, cv::Mat &coloured,
+                     cv::Mat &ndviOut, cv::Mat &maskOut, NDVIStats *stats,
+                     BandFetch fetch) const
+{
+    CV_Assert(frame.type() == CV_8UC3);
+    CV_Assert(lut.type() == CV_8UC3 && lut.total() == 256 && lut.isContinuous());
+
+    coloured.create(frame.size(), CV_8UC3);
+    ndviOut.create(frame.size(), CV_32F);
+    maskOut.create(frame.size(), CV_8U);
+
+    const float *ndviTab = m_ndviTable.data();
+    const uchar *idxTab = m_indexTable.data();
+    const uchar *flagTab = m_flagTable.data();
+    const uchar *lutPtr = lut.ptr<uchar>(0);
+    const int cols = frame.cols;
+
+    NDVIStats total;
+    std::mutex statsMutex;
+
+    cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range &range) {
+        double sum = 0.0;
+        int valid = 0;
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar *src = frame.ptr<uchar>(y);
+            uchar *dst = coloured.ptr<uchar>(y);
+            float *nd = ndviOut.ptr<float>(y);
+            uchar *mk = maskOut.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x, src += 3, dst += 3) {
+                int key = fetch(y, x, src);
+                if (key < 0) {
+                    nd[x] = 0.0f;
+                    mk[x] = MASK_UNREGISTERED;
+                    dst[0] = dst[1] = dst[2] = 0;
+                    continue;
+                }
+                float v = ndviTab[key];
+                uchar f = flagTab[key];
+                nd[x] = v;
+                mk[x] = f;
+                if (f == 0) {
+                    sum += v;
+                    ++valid;
+                }
+                const uchar *c = lutPtr + 3 * idxTab[key];
+                dst[0] = c[0];
+                dst[1] = c[1];
+                dst[2] = c[2];
+            }
+        }
+        std::lock_guard<std::mutex> lock(statsMutex);
+        total.sum += sum;
+        total.valid += valid;
+    });
+
+    if (stats) {
+        total.total = frame.rows * frame.cols;
+        *stats = total;
+    }
+}
+
+/**
+ * @brief apply runs the fused index + colourise + mask kernel on a
+ * single-sensor frame (NIR in R, visible in B).
+ */
+void NDVIKernel::apply(const cv::Mat &frame, const cv::Mat &lut,
+                       cv::Mat &coloured, cv::Mat &ndviOut,
+                       cv::Mat &maskOut, NDVIStats *stats) const
+{
+    run(frame, lut, coloured, ndviOut, maskOut, stats,
+        [](int, int, const uchar *src) { return (src[2] << 8) | src[0]; });
+}
+
+/**
+ * @brief applyDual runs the fused kernel for a dual-camera rig. The NIR
+ * value is bilinearly sampled from the NIR frame with 8-bit fixed-point
+ * weights, so registration costs no separate warp pass.
+ */
+void NDVIKernel::applyDual(const cv::Mat &rgb, const cv::Mat &nir,
+                           const cv::Mat &nirOffsets, const cv::Mat &nirWeights,
+                           const cv::Mat &lut, cv::Mat &coloured, cv::Mat &ndviOut,
+                           cv::Mat &maskOut, NDVIStats *stats) const
+{
+    CV_Assert(nir.type() == CV_8UC3);
+    CV_Assert(nirOffsets.type() == CV_32S && nirOffsets.size() == rgb.size());
+    CV_Assert(nirWeights.type() == CV_16U && nirWeights.size() == rgb.size());
+
+    const uchar *nirData = nir.data;
+    const size_t step = nir.step[0];
+
+    run(rgb, lut, coloured, ndviOut, maskOut, stats,
+        [&](int y, int x, const uchar *src) {
+            int off = nirOffsets.ptr<int>(y)[x];
+            if (off < 0) {
+                return -1;
+            }
+            int nirVal = sampleNir(nirData, step, off, nirWeights.ptr<ushort>(y)[x]);
+            return (nirVal << 8) | src[2];
+        });
+}
+
+/**
+ * @brief colourise maps a float NDVI plane through the palette. Used when a
+ * stage between the index kernel and colourisation rewrites the NDVI plane.
+ */
+void NDVIKernel::colourise(const cv::Mat &ndvi, const cv::Mat &mask, const cv::Mat &lut,
+                           cv::Mat &coloured, NDVIStats *stats) const
+{
+    CV_Assert(ndvi.type() == CV_32F && mask.type() == CV_8U && mask.size() == ndvi.size());
+    CV_Assert(lut.type() == CV_8UC3 && lut.total() == 256 && lut.isContinuous());
+
+    coloured.create(ndvi.size(), CV_8UC3);
+    const uchar *lutPtr = lut.ptr<uchar>(0);
+    const float vmin = m_vmin;
+    const float scale = m_vmax > m_vmin ? 255.0f / (m_vmax - m_vmin) : 0.0f;
+    const int cols = ndvi.cols;
+
+    NDVIStats total;
+    std::mutex statsMutex;
+
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range &range) {
+        double sum = 0.0;
+        int valid = 0;
+        for (int y = range.start; y < range.end; ++y) {
+            const float *nd = ndvi.ptr<float>(y);
+            const uchar *mk = mask.ptr<uchar>(y);
+            uchar *dst = coloured.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x, dst += 3) {
+                if (mk[x] & MASK_UNREGISTERED) {
+                    dst[0] = dst[1] = dst[2] = 0;
+                    continue;
+                }
+                float t = std::min(std::max((nd[x] - vmin) * scale, 0.0f), 255.0f);
+                const uchar *c = lutPtr + 3 * cv::saturate_cast<uchar>(t);
+                dst[0] = c[0];
+                dst[1] = c[1];
+                dst[2] = c[2];
+                if (mk[x] == 0) {
+                    sum += nd[x];
+                    ++valid;
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(statsMutex);
+        total.sum += sum;
+        total.valid += valid;
+    });
+
+    if (stats) {
+        total.total = ndvi.rows * ndvi.cols;
+        *stats = total;
+    }
+}
+
+/**
+ * @brief solveGains derives band gains from a reference panel region.
+ * Saturated pixels are excluded; each gain maps the panel mean DN onto
+ * the known reflectance.
+ */
+bool NDVIKernel::solveGains(const cv::Mat &panel, float reflectance, BandGains &gains)
+{
+    if (panel.empty() || panel.type() != CV_8UC3 || reflectance <= 0.0f) {
+        return false;
+    }
+
+    double sumR = 0.0, sumB = 0.0;
+    size_t used = 0;
+    for (int y = 0; y < panel.rows; ++y) {
+        const uchar *p = panel.ptr<uchar>(y);
+        for (int x = 0; x < panel.cols; ++x, p += 3) {
+            if (p[0] == 255 || p[2] == 255) {
+                continue;
+            }
+            sumB += p[0];
+            sumR += p[2];
+            ++used;
+        }
+    }
+    // Require at least half of the panel to be unsaturated
+    if (used == 0 || used * 2 < panel.total()) {
+        return false;
+    }
+    double meanR = sumR / used;
+    double meanB = sumB / used;
+    if (meanR < MIN_PANEL_LEVEL || meanB < MIN_PANEL_LEVEL) {
+        return false;
+    }
+
+    gains.red  = float(reflectance * 255.0 / meanR);
+    gains.blue = float(reflectance * 255.0 / meanB);
+    return true;
+}
+
+/**
+ * @brief solveGainsDual lays the bands out as applyDual reads them (NIR
+ * camera sample where the NIR band is read, RGB red where the visible band
+ * is read) and solves on that; unregistered pixels count as saturated.
+ */
+bool NDVIKernel::solveGainsDual(const cv::Mat &rgb, const cv::Mat &nir,
+                                const cv::Mat &nirOffsets, const cv::Mat &nirWeights,
+                                const cv::Rect &roi, float reflectance, BandGains &gains)
+{
+    if (rgb.type() != CV_8UC3 || nir.type() != CV_8UC3
+        || nirOffsets.size() != rgb.size() || nirWeights.size() != rgb.size()
+        || (roi & cv::Rect(0, 0, rgb.cols, rgb.rows)) != roi || roi.empty()) {
+        return false;
+    }
+    const uchar *nirData = nir.data;
+    const size_t step = nir.step[0];
+    cv::Mat panel(roi.size(), CV_8UC3);
+    for (int y = 0; y < roi.height; ++y) {
+        const uchar *src = rgb.ptr<uchar>(roi.y + y) + 3 * roi.x;
+        const int *off = nirOffsets.ptr<int>(roi.y + y) + roi.x;
+        const ushort *wt = nirWeights.ptr<ushort>(roi.y + y) + roi.x;
+        uchar *p = panel.ptr<uchar>(y);
+        for (int x = 0; x < roi.width; ++x, src += 3, p += 3) {
+            p[1] = 0;
+            if (off[x] < 0) {
+                p[0] = p[2] = 255;
+                continue;
+            }
+            p[0] = src[2];
+            p[2] = uchar(sampleNir(nirData, step, off[x], wt[x]));
+        }
+    }
+    return solveGains(panel, reflectance, gains);
+}
@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------
+// src/Palette.cpp
+//------------------------------------------------------------------------------
+
+#include "Palette.h"
+
+/**
+ * @brief makePaletteLUT builds a 256×1×3 CV_8UC3 lookup table from three colors.
+ */
+cv::Mat makePaletteLUT(const QColor &c1, const QColor &c2, const QColor &c3)
+{
+    // Build a CV_32F colormap via interpolation, then convert
+    cv::Mat lutF(256, 1, CV_32FC3);
+    for (int i = 0; i < 256; ++i) {
+        float t = i / 255.0f;
+        QColor c;
+        if (t < 0.5f) {
+            float u = t * 2.0f;
+            c = QColor::fromRgbF(
+                c1.redF()    + u * (c2.redF()   - c1.redF()),
+                c1.greenF()  + u * (c2.greenF() - c1.greenF()),
+                c1.blueF()   + u * (c2.blueF()  - c1.blueF())
+            );
+        } else {
+            float u = (t - 0.5f) * 2.0f;
+            c = QColor::fromRgbF(
+                c2.redF()    + u * (c3.redF()   - c2.redF()),
+                c2.greenF()  + u * (c3.greenF() - c2.greenF()),
+                c2.blueF()   + u * (c3.blueF()  - c2.blueF())
+            );
+        }
+        lutF.at<cv::Vec3f>(i,0) =
+            cv::Vec3f(c.redF(), c.greenF(), c.blueF());
+    }
+    cv::Mat lut8;
+    lutF.convertTo(lut8, CV_8UC3, 255.0);
+    return lut8;
+}
+
+/**
+ * @brief paletteLUT returns a named palette.
+ */
+cv::Mat paletteLUT(const QString &name)
+{
+    if (name == "NDVI Classic") {
+        return makePaletteLUT(Qt::white, Qt::darkRed, Qt::green);
+    } else if (name == "Infrared") {
+        return makePaletteLUT(Qt::black, Qt::red, Qt::white);
+    } else if (name == "Thermal") {
+        return makePaletteLUT(Qt::blue, Qt::yellow, Qt::red);
+    } else if (name == "Grayscale") {
+        return makePaletteLUT(Qt::black, Qt::gray, Qt::white);
+    }
+    return cv::Mat();
+}
+
+/**
+ * @brief paletteNames lists the named palettes, default first.
+ */
+QStringList paletteNames()
+{
+    return {"NDVI Classic", "Infrared", "Thermal", "Grayscale"};
+}
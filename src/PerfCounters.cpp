@@ -0,0 +1,299 @@
+//------------------------------------------------------------------------------
+// src/PerfCounters.cpp
+//------------------------------------------------------------------------------
+
+#include "PerfCounters.h"
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+
+struct ThreadGroup;
+
+/**
+ * @brief Pool lists the groups of OpenCV worker threads; any thread may
+ * read them, since a counter fd is not tied to the thread that reads it.
+ */
+struct Pool
+{
+    std::mutex mutex;
+    std::vector<ThreadGroup *> groups;
+};
+
+Pool &pool()
+{
+    // Never destroyed: OpenCV may stop its workers after static destructors
+    static Pool *p = new Pool;
+    return *p;
+}
+
+/**
+ * @brief ThreadGroup is the counter group of one thread, cycles leading.
+ */
+struct ThreadGroup
+{
+    int  fds[PerfCounters::EVENT_COUNT]  = { -1, -1, -1, -1 };
+    int  slot[PerfCounters::EVENT_COUNT] = { -1, -1, -1, -1 };  // index in a group read
+    int  count = 0;
+    bool tried = false;
+    bool pooled = false;  // listed in pool()
+
+    ~ThreadGroup()
+    {
+        if (pooled) {
+            Pool &p = pool();
+            std::lock_guard<std::mutex> lock(p.mutex);
+            p.groups.erase(std::remove(p.groups.begin(), p.groups.end(), this), p.groups.end());
+        }
+        close();
+    }
+
+    void close()
+    {
+        for (int &fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    int openEvent(quint32 type, quint64 config, int leader)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;  // allowed up to perf_event_paranoid 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+                         | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return int(syscall(__NR_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+    }
+
+    /**
+     * @brief open opens the group once. Cycles and instructions are
+     * required; LLC read misses fall back to the generic cache-miss event,
+     * and either cache or branch misses may be missing.
+     */
+    bool open(std::atomic<int> &error)
+    {
+        tried = true;
+        const quint64 llcReadMiss = PERF_COUNT_HW_CACHE_LL
+                                  | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                  | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        for (int e = 0; e < PerfCounters::EVENT_COUNT; ++e) {
+            int fd = -1;
+            switch (e) {
+            case PerfCounters::Cycles:
+                fd = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+                break;
+            case PerfCounters::Instructions:
+                fd = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fds[0]);
+                break;
+            case PerfCounters::LlcMisses:
+                fd = openEvent(PERF_TYPE_HW_CACHE, llcReadMiss, fds[0]);
+                if (fd < 0) {
+                    fd = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, fds[0]);
+                }
+                break;
+            case PerfCounters::BranchMisses:
+                fd = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, fds[0]);
+                break;
+            }
+            if (fd < 0) {
+                if (e <= PerfCounters::Instructions) {
+                    error.store(errno, std::memory_order_relaxed);
+                    close();
+                    count = 0;
+                    return false;
+                }
+                continue;
+            }
+            fds[e] = fd;
+            slot[e] = count++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief read reads the whole group in one syscall. Totals are scaled
+     * by enabled/running time in case the kernel time-shared the counters.
+     */
+    bool read(PerfCounters::Sample &sample) const
+    {
+        if (count == 0) {
+            return false;
+        }
+        // nr, time enabled, time running, then one value per opened event
+        quint64 buf[3 + PerfCounters::EVENT_COUNT];
+        const ssize_t want = ssize_t(sizeof(quint64)) * (3 + count);
+        if (::read(fds[PerfCounters::Cycles], buf, sizeof(buf)) < want || buf[2] == 0) {
+            return false;
+        }
+        const double scale = buf[2] < buf[1] ? double(buf[1]) / double(buf[2]) : 1.0;
+        for (int e = 0; e < PerfCounters::EVENT_COUNT; ++e) {
+            const int s = slot[e];
+            sample.value[e] = s >= 0 ? quint64(double(buf[3 + s]) * scale) : 0;
+        }
+        return true;
+    }
+};
+
+thread_local ThreadGroup t_group;
+
+/**
+ * @brief joinPool opens the OpenCV workers' groups and lists them: enough
+ * short sleeping stripes run that every worker takes one.
+ */
+void joinPool()
+{
+    const ThreadGroup *caller = &t_group;
+    const int threads = std::max(cv::getNumThreads(), 1);
+    cv::parallel_for_(cv::Range(0, threads * 4), [caller](const cv::Range &) {
+        PerfCounters::Sample sample;
+        if (&t_group != caller && !t_group.pooled && PerfCounters::read(sample)) {
+            Pool &p = pool();
+            std::lock_guard<std::mutex> lock(p.mutex);
+            p.groups.push_back(&t_group);
+            t_group.pooled = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }, threads * 4);
+}
+
+#endif
+
+} // namespace
+
+/**
+ * @brief setEnabled probes the calling thread's counters before turning
+ * counting on, then opens those of the OpenCV workers.
+ */
+bool PerfCounters::setEnabled(bool on)
+{
+    if (on) {
+        Sample probe;
+        if (!read(probe)) {
+            s_enabled.store(false, std::memory_order_relaxed);
+            return false;
+        }
+#if defined(__linux__)
+        joinPool();
+        unsigned mask = 0;
+        for (int e = 0; e < EVENT_COUNT; ++e) {
+            mask |= t_group.slot[e] >= 0 ? 1u << e : 0u;
+        }
+        s_events.store(mask, std::memory_order_relaxed);
+#endif
+    }
+    s_enabled.store(on, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief read opens the calling thread's group on first use and reads it.
+ */
+bool PerfCounters::read(Sample &sample)
+{
+#if defined(__linux__)
+    if (!t_group.tried) {
+        t_group.open(s_error);
+    }
+    return t_group.read(sample);
+#else
+    Q_UNUSED(sample);
+    s_error.store(ENOSYS, std::memory_order_relaxed);
+    return false;
+#endif
+}
+
+/**
+ * @brief readWithPool adds the pool groups to the calling thread's totals.
+ * A worker that exits between two reads makes the sum step back; callers
+ * already clamp such deltas at zero.
+ */
+bool PerfCounters::readWithPool(Sample &sample)
+{
+    if (!read(sample)) {
+        return false;
+    }
+#if defined(__linux__)
+    Pool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    for (const ThreadGroup *g : p.groups) {
+        Sample worker;
+        if (g != &t_group && g->read(worker)) {
+            for (int e = 0; e < EVENT_COUNT; ++e) {
+                sample.value[e] += worker.value[e];
+            }
+        }
+    }
+#endif
+    return true;
+}
+
+/**
+ * @brief poolThreads returns the number of listed OpenCV workers.
+ */
+int PerfCounters::poolThreads()
+{
+#if defined(__linux__)
+    Pool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return int(p.groups.size());
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief unavailableReason maps the open errno to advice.
+ */
+QString PerfCounters::unavailableReason()
+{
+    const int error = s_error.load(std::memory_order_relaxed);
+    switch (error) {
+    case 0:
+        return QString();
+    case EACCES:
+    case EPERM:
+        return QString("not permitted; lower /proc/sys/kernel/perf_event_paranoid to 2 "
+                       "or grant CAP_PERFMON");
+    case ENOENT:
+    case ENODEV:
+    case EOPNOTSUPP:
+        return QString("no hardware counters (virtual machine or unsupported CPU)");
+    case ENOSYS:
+        return QString("perf events are not supported on this system");
+    default:
+        return QString::fromLocal8Bit(std::strerror(error));
+    }
+}
+
+/**
+ * @brief name returns the display name of an event.
+ */
+const char *PerfCounters::name(Event event)
+{
+    static const char *NAMES[EVENT_COUNT] = {
+        "cycles", "instructions", "llc-misses", "branch-misses"
+    };
+    return event >= 0 && event < EVENT_COUNT ? NAMES[event] : "?";
+}
@@ -0,0 +1,134 @@
+//------------------------------------------------------------------------------
+// src/RawDumpSource.cpp
+//------------------------------------------------------------------------------
+
+#include "RawDumpSource.h"
+#include "RawDumpWriter.h"
+
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <cstring>
+
+using namespace RawDump;
+
+/**
+ * @brief RawDumpSource constructor.
+ */
+RawDumpSource::RawDumpSource(const QString &path)
+    : m_path(path)
+    , m_file(path)
+    , m_dataStart(0)
+    , m_params()
+    , m_hasParams(false)
+{}
+
+/**
+ * @brief open checks the file header.
+ */
+bool RawDumpSource::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("cannot open %1").arg(m_path);
+        return false;
+    }
+    DumpFileHeader header;
+    if (m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+        || std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0
+        || header.version != VERSION) {
+        m_error = QString("%1 is not a raw dump").arg(m_path);
+        return false;
+    }
+    m_dataStart = m_file.pos();
+    return true;
+}
+
+/**
+ * @brief read returns the next frame (the RGB frame of a pair).
+ */
+bool RawDumpSource::read(cv::Mat &frame, FrameMeta &meta)
+{
+    cv::Mat nir;
+    return readDual(frame, nir, meta);
+}
+
+/**
+ * @brief readDual reads records up to the next frame, keeping the latest
+ * parameter snapshot on the way for takeParams().
+ */
+bool RawDumpSource::readDual(cv::Mat &rgb, cv::Mat &nir, FrameMeta &meta)
+{
+    for (;;) {
+        DumpRecordHeader rh;
+        if (m_file.read(reinterpret_cast<char *>(&rh), sizeof(rh)) != qint64(sizeof(rh))
+            || rh.type == RECORD_END) {
+            return false;
+        }
+        if (rh.type == RECORD_PARAMS) {
+            m_params = QJsonDocument::fromJson(m_file.read(qint64(rh.size))).object();
+            m_hasParams = true;
+            continue;
+        }
+        if (rh.type != RECORD_FRAME) {
+            // Unknown record from a newer writer: skip it
+            if (!m_file.seek(m_file.pos() + qint64(rh.size))) return false;
+            continue;
+        }
+        DumpFrameHeader fh;
+        if (m_file.read(reinterpret_cast<char *>(&fh), sizeof(fh)) != qint64(sizeof(fh))) {
+            return false;
+        }
+        meta = FrameMeta();
+        meta.sequence = fh.sequence;
+        meta.timestampUs = fh.timestampUs;
+        meta.pairSkewUs = fh.pairSkewUs;
+        meta.throttled = (fh.flags & FRAME_THROTTLED) != 0;
+        nir.release();
+        return readImage(rgb) && (fh.images < 2 || readImage(nir));
+    }
+}
+
+/**
+ * @brief readImage reads one image header and its pixels into a new matrix.
+ */
+bool RawDumpSource::readImage(cv::Mat &img)
+{
+    DumpImageHeader ih;
+    if (m_file.read(reinterpret_cast<char *>(&ih), sizeof(ih)) != qint64(sizeof(ih))
+        || ih.rows <= 0 || ih.cols <= 0) {
+        return false;
+    }
+    // A fresh matrix per frame: the pipeline may keep the previous one
+    img = cv::Mat(ih.rows, ih.cols, ih.type);
+    const qint64 bytes = qint64(img.total() * img.elemSize());
+    return m_file.read(reinterpret_cast<char *>(img.data), bytes) == bytes;
+}
+
+/**
+ * @brief takeParams returns the snapshot recorded before the last frame, once.
+ */
+bool RawDumpSource::takeParams(QJsonObject &params)
+{
+    if (!m_hasParams) {
+        return false;
+    }
+    params = m_params;
+    m_hasParams = false;
+    return true;
+}
+
+/**
+ * @brief rewind seeks back to the first record.
+ */
+bool RawDumpSource::rewind()
+{
+    m_hasParams = false;
+    return m_file.seek(m_dataStart);
+}
+
+/**
+ * @brief description returns the file name.
+ */
+QString RawDumpSource::description() const
+{
+    return QFileInfo(m_path).fileName();
+}
@@ -0,0 +1,278 @@
+//------------------------------------------------------------------------------
+// src/RawDumpWriter.cpp
+//------------------------------------------------------------------------------
+
+#include "RawDumpWriter.h"
+
+#include <QJsonDocument>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+using namespace RawDump;
+
+static constexpr size_t STAGING_BYTES = size_t(8) << 20;  // one sequential write
+
+/**
+ * @brief RawDumpWriter constructor.
+ */
+RawDumpWriter::RawDumpWriter()
+    : m_file()
+    , m_thread()
+    , m_mutex()
+    , m_ready()
+    , m_queue()
+    , m_queued(0)
+    , m_budget(qint64(512) << 20)
+    , m_stop(false)
+    , m_staging()
+    , m_fill(0)
+    , m_extent(qint64(1) << 30)
+    , m_allocated(0)
+    , m_written(0)
+    , m_frames(0)
+    , m_dropped(0)
+    , m_error()
+{}
+
+/**
+ * @brief Destructor closes the dump.
+ */
+RawDumpWriter::~RawDumpWriter()
+{
+    close();
+}
+
+/**
+ * @brief open writes the file header and starts the I/O thread.
+ */
+bool RawDumpWriter::open(const QString &path)
+{
+    close();
+    m_error.clear();
+    m_file.setFileName(path);
+    // Unbuffered: the staging buffer already batches the writes
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        m_error = QString("cannot create %1").arg(path);
+        return false;
+    }
+    m_staging.resize(STAGING_BYTES);
+    m_fill = 0;
+    m_allocated = 0;
+    m_written = 0;
+    m_frames = 0;
+    m_dropped = 0;
+    m_queued = 0;
+    m_stop = false;
+
+    DumpFileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.reserved = 0;
+    append(&header, sizeof(header));
+    m_thread = std::thread(&RawDumpWriter::ioLoop, this);
+    return true;
+}
+
+/**
+ * @brief close stops the I/O thread after the queue drains.
+ */
+void RawDumpWriter::close()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_ready.notify_all();
+    }
+    m_thread.join();
+    flush();
+    // Trim the unused part of the last extent
+    m_file.resize(m_written);
+    m_file.close();
+    m_staging = std::vector<char>();
+}
+
+/**
+ * @brief error describes the last failure.
+ */
+QString RawDumpWriter::error() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+/**
+ * @brief writeFrame queues a frame record, or drops it when over budget.
+ */
+bool RawDumpWriter::writeFrame(const cv::Mat &frame, const cv::Mat &nir,
+                               const FrameMeta &meta, bool throttled)
+{
+    if (!isOpen() || frame.empty()) {
+        return false;
+    }
+    Record r;
+    r.type = RECORD_FRAME;
+    DumpFrameHeader h;
+    h.sequence = meta.sequence;
+    h.timestampUs = meta.timestampUs;
+    h.pairSkewUs = meta.pairSkewUs;
+    h.flags = throttled ? FRAME_THROTTLED : 0;
+    h.images = nir.empty() ? 1 : 2;
+    r.head = QByteArray(reinterpret_cast<const char *>(&h), sizeof(h));
+    r.images[0] = frame;
+    r.images[1] = nir;
+    r.bytes = qint64(sizeof(h));
+    for (quint32 i = 0; i < h.images; ++i) {
+        r.bytes += qint64(sizeof(DumpImageHeader) + r.images[i].total() * r.images[i].elemSize());
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queued + r.bytes > m_budget) {
+        ++m_dropped;
+        return false;
+    }
+    m_queued += r.bytes;
+    m_queue.push_back(std::move(r));
+    m_ready.notify_one();
+    return true;
+}
+
+/**
+ * @brief writeParams queues a parameter snapshot; never dropped.
+ */
+void RawDumpWriter::writeParams(const QJsonObject &params)
+{
+    if (!isOpen()) {
+        return;
+    }
+    Record r;
+    r.type = RECORD_PARAMS;
+    r.head = QJsonDocument(params).toJson(QJsonDocument::Compact);
+    r.bytes = r.head.size();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queued += r.bytes;
+    m_queue.push_back(std::move(r));
+    m_ready.notify_one();
+}
+
+/**
+ * @brief ioLoop packs queued records and flushes whenever the queue runs dry.
+ */
+void RawDumpWriter::ioLoop()
+{
+    for (;;) {
+        Record r;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queue.empty()) {
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+            m_ready.wait(lock, [this]() { return !m_queue.empty() || m_stop; });
+            if (m_queue.empty()) {
+                return;
+            }
+            r = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        pack(r);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued -= r.bytes;
+    }
+}
+
+/**
+ * @brief pack serialises one record into the staging buffer.
+ */
+void RawDumpWriter::pack(const Record &record)
+{
+    DumpRecordHeader rh;
+    rh.type = record.type;
+    rh.reserved = 0;
+    rh.size = quint64(record.bytes);
+    append(&rh, sizeof(rh));
+    append(record.head.constData(), size_t(record.head.size()));
+    if (record.type != RECORD_FRAME) {
+        return;
+    }
+    for (const cv::Mat &img : record.images) {
+        if (img.empty()) {
+            continue;
+        }
+        DumpImageHeader ih;
+        ih.rows = img.rows;
+        ih.cols = img.cols;
+        ih.type = img.type();
+        ih.reserved = 0;
+        append(&ih, sizeof(ih));
+        const size_t rowBytes = img.cols * img.elemSize();
+        if (img.isContinuous()) {
+            append(img.data, rowBytes * size_t(img.rows));
+        } else {
+            for (int y = 0; y < img.rows; ++y) {
+                append(img.ptr(y), rowBytes);
+            }
+        }
+    }
+    ++m_frames;
+}
+
+/**
+ * @brief append copies into the staging buffer; blocks larger than the
+ * buffer go straight to the file after a flush.
+ */
+void RawDumpWriter::append(const void *data, size_t size)
+{
+    if (m_fill + size > m_staging.size()) {
+        flush();
+    }
+    if (size > m_staging.size()) {
+        reserve(m_written + qint64(size));
+        if (m_file.write(static_cast<const char *>(data), qint64(size)) != qint64(size)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_error = m_file.errorString();
+        }
+        m_written += qint64(size);
+        return;
+    }
+    std::memcpy(m_staging.data() + m_fill, data, size);
+    m_fill += size;
+}
+
+/**
+ * @brief flush writes the staging buffer in one call.
+ */
+void RawDumpWriter::flush()
+{
+    if (m_fill == 0) {
+        return;
+    }
+    reserve(m_written + qint64(m_fill));
+    if (m_file.write(m_staging.data(), qint64(m_fill)) != qint64(m_fill)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = m_file.errorString();
+    }
+    m_written += qint64(m_fill);
+    m_fill = 0;
+}
+
+/**
+ * @brief reserve preallocates whole extents ahead of the write position.
+ */
+void RawDumpWriter::reserve(qint64 end)
+{
+    if (end <= m_allocated) {
+        return;
+    }
+    const qint64 target = (end / m_extent + 1) * m_extent;
+#ifdef Q_OS_LINUX
+    // Real blocks, not a sparse hole; failure only costs the optimisation
+    posix_fallocate(m_file.handle(), off_t(m_allocated), off_t(target - m_allocated));
+#endif
+    m_allocated = target;
+}
@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+// src/ReplaySource.cpp
+//------------------------------------------------------------------------------
+
+#include "ReplaySource.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+/**
+ * @brief ReplaySource constructor.
+ */
+ReplaySource::ReplaySource(const QString &path, double frameRate)
+    : m_path(path)
+    , m_frameRate(frameRate > 0.0 ? frameRate : 30.0)
+    , m_images()
+    , m_video()
+    , m_next(0)
+{}
+
+/**
+ * @brief open lists the image sequence or opens the video.
+ */
+bool ReplaySource::open()
+{
+    m_next = 0;
+    m_images.clear();
+    const QFileInfo info(m_path);
+    if (info.isDir()) {
+        QDir dir(m_path);
+        for (const QString &f : dir.entryList({"*.png", "*.jpg", "*.jpeg", "*.tif", "*.tiff", "*.bmp"},
+                                              QDir::Files, QDir::Name)) {
+            m_images << dir.filePath(f);
+        }
+        if (m_images.isEmpty()) {
+            m_error = QString("no images in %1").arg(m_path);
+            return false;
+        }
+        return true;
+    }
+    if (!m_video.open(m_path.toStdString())) {
+        m_error = QString("cannot open %1").arg(m_path);
+        return false;
+    }
+    const double fps = m_video.get(cv::CAP_PROP_FPS);
+    if (fps > 0.0) {
+        m_frameRate = fps;
+    }
+    return true;
+}
+
+/**
+ * @brief read decodes the next frame and stamps it with its stream time.
+ */
+bool ReplaySource::read(cv::Mat &frame, FrameMeta &meta)
+{
+    meta = FrameMeta();
+    meta.sequence = m_next;
+    if (!m_images.isEmpty()) {
+        if (m_next >= m_images.size()) {
+            return false;
+        }
+        frame = cv::imread(m_images.at(int(m_next)).toStdString(), cv::IMREAD_COLOR);
+        if (frame.empty()) {
+            m_error = QString("cannot read %1").arg(m_images.at(int(m_next)));
+            return false;
+        }
+        meta.timestampUs = qint64(m_next * 1e6 / m_frameRate);
+    } else {
+        if (!m_video.read(frame)) {
+            return false;
+        }
+        // Streams without timestamps report 0; stamp those at the nominal rate
+        const double ms = m_video.get(cv::CAP_PROP_POS_MSEC);
+        meta.timestampUs = ms > 0.0 ? qint64(ms * 1000.0) : qint64(m_next * 1e6 / m_frameRate);
+    }
+    ++m_next;
+    return true;
+}
+
+/**
+ * @brief rewind seeks back to the first frame.
+ */
+bool ReplaySource::rewind()
+{
+    m_next = 0;
+    if (!m_images.isEmpty()) {
+        return true;
+    }
+    if (m_video.set(cv::CAP_PROP_POS_FRAMES, 0.0)) {
+        return true;
+    }
+    m_video.release();
+    return open();
+}
+
+/**
+ * @brief description returns the file or directory name.
+ */
+QString ReplaySource::description() const
+{
+    return QFileInfo(m_path).fileName();
+}
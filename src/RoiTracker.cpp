@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+// src/RoiTracker.cpp
+//------------------------------------------------------------------------------
+
+#include "RoiTracker.h"
+
+#include <algorithm>
+
+static constexpr int MAX_FINE_TEMPLATE = 64;  // template side at the finest level
+static constexpr int MIN_TEMPLATE = 8;        // smallest template side searched
+static constexpr int REFINE_RADIUS = 2;       // per-level refinement half-window
+
+/**
+ * @brief RoiTracker constructor.
+ * @param searchRadius search half-window in full-resolution pixels
+ */
+RoiTracker::RoiTracker(int searchRadius)
+    : m_templates()
+    , m_fine(0)
+    , m_coarse(0)
+    , m_pos()
+    , m_roiSize()
+    , m_frameSize()
+    , m_radius(std::max(searchRadius, 1))
+    , m_minScore(0.5f)
+    , m_score(0.0f)
+    , m_tracking(false)
+    , m_lost(false)
+{}
+
+/**
+ * @brief setSearchRadius sets the search half-window in pixels.
+ */
+void RoiTracker::setSearchRadius(int radius)
+{
+    m_radius = std::max(radius, 1);
+}
+
+/**
+ * @brief setMinScore sets the lost threshold.
+ */
+void RoiTracker::setMinScore(float score)
+{
+    m_minScore = score;
+}
+
+/**
+ * @brief start cuts the templates for the levels to be searched.
+ */
+bool RoiTracker::start(FramePyramid &pyramid, const cv::Rect &roi)
+{
+    stop();
+    cv::Rect box = roi & cv::Rect(cv::Point(), pyramid.size());
+    if (std::min(box.width, box.height) < MIN_TEMPLATE) {
+        return false;
+    }
+
+    // Finest level: template no wider than MAX_FINE_TEMPLATE. Coarsest: the
+    // template keeps MIN_TEMPLATE pixels and the search window 2 pixels.
+    m_fine = 0;
+    while (m_fine + 1 < FramePyramid::MAX_LEVELS
+           && std::max(box.width, box.height) >> m_fine > MAX_FINE_TEMPLATE
+           && std::min(box.width, box.height) >> (m_fine + 1) >= MIN_TEMPLATE) {
+        ++m_fine;
+    }
+    m_coarse = m_fine;
+    while (m_coarse + 1 < FramePyramid::MAX_LEVELS
+           && std::min(box.width, box.height) >> (m_coarse + 1) >= MIN_TEMPLATE
+           && m_radius >> (m_coarse + 1) >= REFINE_RADIUS) {
+        ++m_coarse;
+    }
+
+    m_templates.assign(m_coarse + 1, cv::Mat());
+    for (int l = m_fine; l <= m_coarse; ++l) {
+        const cv::Mat &img = pyramid.level(l);
+        cv::Rect r(box.x >> l, box.y >> l, box.width >> l, box.height >> l);
+        m_templates[l] = img(r & cv::Rect(cv::Point(), img.size())).clone();
+    }
+    m_pos = cv::Point2f(float(box.x), float(box.y));
+    m_roiSize = box.size();
+    m_frameSize = pyramid.size();
+    m_score = 1.0f;
+    m_tracking = true;
+    m_lost = false;
+    return true;
+}
+
+/**
+ * @brief match runs TM_CCOEFF_NORMED over the template placed at tl ±
+ * radius, moving tl to the best position.
+ * @param subpixel if set, receives the parabolic sub-pixel offset of the peak
+ */
+bool RoiTracker::match(const cv::Mat &image, const cv::Mat &templ, cv::Point &tl,
+                       int radius, float &score, cv::Point2f *subpixel)
+{
+    cv::Rect window(tl.x - radius, tl.y - radius,
+                    templ.cols + 2 * radius, templ.rows + 2 * radius);
+    window &= cv::Rect(cv::Point(), image.size());
+    if (window.width < templ.cols || window.height < templ.rows) {
+        return false;
+    }
+    cv::matchTemplate(image(window), templ, m_response, cv::TM_CCOEFF_NORMED);
+    double best;
+    cv::Point loc;
+    cv::minMaxLoc(m_response, nullptr, &best, nullptr, &loc);
+    tl = window.tl() + loc;
+    score = float(best);
+
+    if (subpixel) {
+        *subpixel = cv::Point2f();
+        const cv::Mat &r = m_response;
+        if (loc.x > 0 && loc.x < r.cols - 1) {
+            float a = r.at<float>(loc.y, loc.x - 1);
+            float b = r.at<float>(loc.y, loc.x);
+            float c = r.at<float>(loc.y, loc.x + 1);
+            float d = a - 2.0f * b + c;
+            if (d < 0.0f) subpixel->x = 0.5f * (a - c) / d;
+        }
+        if (loc.y > 0 && loc.y < r.rows - 1) {
+            float a = r.at<float>(loc.y - 1, loc.x);
+            float b = r.at<float>(loc.y, loc.x);
+            float c = r.at<float>(loc.y + 1, loc.x);
+            float d = a - 2.0f * b + c;
+            if (d < 0.0f) subpixel->y = 0.5f * (a - c) / d;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief update searches coarse-to-fine around the previous position.
+ */
+bool RoiTracker::update(FramePyramid &pyramid)
+{
+    if (!m_tracking) {
+        return false;
+    }
+    if (pyramid.size() != m_frameSize) {
+        stop();
+        return false;
+    }
+
+    // Widen the search while lost
+    const int radius = m_lost ? m_radius * 2 : m_radius;
+    const float coarseScale = 1.0f / float(1 << m_coarse);
+    cv::Point tl(cvRound(m_pos.x * coarseScale), cvRound(m_pos.y * coarseScale));
+    float score = 0.0f;
+    cv::Point2f sub;
+    if (!match(pyramid.level(m_coarse), m_templates[m_coarse], tl,
+               std::max(radius >> m_coarse, REFINE_RADIUS), score,
+               m_coarse == m_fine ? &sub : nullptr)) {
+        m_lost = true;
+        return false;
+    }
+    for (int l = m_coarse - 1; l >= m_fine; --l) {
+        tl *= 2;
+        if (!match(pyramid.level(l), m_templates[l], tl, REFINE_RADIUS, score,
+                   l == m_fine ? &sub : nullptr)) {
+            m_lost = true;
+            return false;
+        }
+    }
+    m_score = score;
+    if (score < m_minScore) {
+        m_lost = true;
+        return false;
+    }
+    m_lost = false;
+    const float fineScale = float(1 << m_fine);
+    m_pos = cv::Point2f((tl.x + sub.x) * fineScale, (tl.y + sub.y) * fineScale);
+    return true;
+}
+
+/**
+ * @brief stop drops the template.
+ */
+void RoiTracker::stop()
+{
+    m_templates.clear();
+    m_tracking = false;
+    m_lost = false;
+    m_score = 0.0f;
+}
+
+/**
+ * @brief rect returns the tracked box clipped to the frame.
+ */
+cv::Rect RoiTracker::rect() const
+{
+    if (!m_tracking) {
+        return cv::Rect();
+    }
+    cv::Rect box(cvRound(m_pos.x), cvRound(m_pos.y), m_roiSize.width, m_roiSize.height);
+    return box & cv::Rect(cv::Point(), m_frameSize);
+}
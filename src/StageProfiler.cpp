@@ -0,0 +1,343 @@
+//------------------------------------------------------------------------------
+// src/StageProfiler.cpp
+//------------------------------------------------------------------------------
+
+#include "StageProfiler.h"
+#include "FrameMeta.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief ThreadBlock is the histogram set owned by one thread.
+ */
+struct ThreadBlock
+{
+    std::atomic<quint64> counts[StageProfiler::STAGE_COUNT][StageProfiler::BUCKETS];
+    std::atomic<quint64> totalNs[StageProfiler::STAGE_COUNT];
+    std::atomic<quint64> perf[StageProfiler::STAGE_COUNT][StageProfiler::COUNTER_FIELDS];
+
+    ThreadBlock()
+    {
+        for (auto &stage : counts) {
+            for (auto &c : stage) {
+                c.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (auto &t : totalNs) {
+            t.store(0, std::memory_order_relaxed);
+        }
+        for (auto &stage : perf) {
+            for (auto &p : stage) {
+                p.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Registry owns every block; blocks are never freed, only handed
+ * to the next thread once their owner exits.
+ */
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+    std::vector<ThreadBlock *> free;
+    qint64 startUs = steadyMicros();
+};
+
+Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+/**
+ * @brief ThreadSlot binds a block to the current thread for its lifetime.
+ */
+struct ThreadSlot
+{
+    ThreadBlock *block = nullptr;
+
+    ThreadBlock *get()
+    {
+        if (!block) {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            if (!r.free.empty()) {
+                block = r.free.back();
+                r.free.pop_back();
+            } else {
+                r.blocks.push_back(std::make_unique<ThreadBlock>());
+                block = r.blocks.back().get();
+            }
+        }
+        return block;
+    }
+
+    ~ThreadSlot()
+    {
+        if (block) {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.free.push_back(block);
+        }
+    }
+};
+
+/**
+ * @brief threadBlock returns the calling thread's block.
+ */
+ThreadBlock *threadBlock()
+{
+    thread_local ThreadSlot slot;
+    return slot.get();
+}
+
+/**
+ * @brief add increments a single-writer counter.
+ */
+void add(std::atomic<quint64> &counter, quint64 v)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+int highestBit(quint64 v)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return int(index);
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+} // namespace
+
+/**
+ * @brief bucket maps nanoseconds to a histogram bucket: values below 16
+ * map to themselves, larger ones to 16 linear sub-buckets of their octave.
+ */
+int StageProfiler::bucket(quint64 ns)
+{
+    constexpr quint64 SUB = 1u << SUB_BITS;
+    if (ns < SUB) {
+        return int(ns);
+    }
+    const int e = highestBit(ns);
+    if (e > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+    return ((e - SUB_BITS + 1) << SUB_BITS) + int((ns >> (e - SUB_BITS)) & (SUB - 1));
+}
+
+/**
+ * @brief bucketUpperNs returns the largest value that maps to a bucket.
+ */
+quint64 StageProfiler::bucketUpperNs(int bucket)
+{
+    constexpr int SUB = 1 << SUB_BITS;
+    if (bucket < SUB) {
+        return quint64(bucket);
+    }
+    const int e = (bucket >> SUB_BITS) + SUB_BITS - 1;
+    const quint64 width = quint64(1) << (e - SUB_BITS);
+    return (quint64(SUB + (bucket & (SUB - 1))) << (e - SUB_BITS)) + width - 1;
+}
+
+/**
+ * @brief name returns the display name of a stage.
+ */
+const char *StageProfiler::name(Stage stage)
+{
+    static const char *NAMES[STAGE_COUNT] = {
+        "capture", "decode", "remap", "index", "colourise",
+        "blend", "overlay", "scale", "paint", "encode"
+    };
+    return stage >= 0 && stage < STAGE_COUNT ? NAMES[stage] : "?";
+}
+
+/**
+ * @brief record adds a sample to the calling thread's block. The block has
+ * a single writer, so a relaxed load and store replace an atomic add.
+ */
+void StageProfiler::record(Stage stage, qint64 ns)
+{
+    ThreadBlock *block = threadBlock();
+    const quint64 v = ns > 0 ? quint64(ns) : 0;
+    add(block->counts[stage][bucket(v)], 1);
+    add(block->totalNs[stage], v);
+}
+
+/**
+ * @brief recordCounters adds the deltas; a multiplexed group's scaled
+ * totals may step back slightly, so deltas are clamped at zero.
+ */
+void StageProfiler::recordCounters(Stage stage, const PerfCounters::Sample &begin,
+                                   const PerfCounters::Sample &end, qint64 pixels)
+{
+    std::atomic<quint64> *perf = threadBlock()->perf[stage];
+    add(perf[0], 1);
+    add(perf[1], pixels > 0 ? quint64(pixels) : 0);
+    for (int e = 0; e < PerfCounters::EVENT_COUNT; ++e) {
+        add(perf[2 + e], end.value[e] - std::min(end.value[e], begin.value[e]));
+    }
+}
+
+/**
+ * @brief snapshot sums all blocks, including those of exited threads.
+ */
+StageProfiler::Snapshot StageProfiler::snapshot()
+{
+    Snapshot snap;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    snap.m_sinceUs = r.startUs;
+    for (const std::unique_ptr<ThreadBlock> &block : r.blocks) {
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            quint64 *counts = &snap.m_counts[size_t(s) * BUCKETS];
+            for (int b = 0; b < BUCKETS; ++b) {
+                counts[b] += block->counts[s][b].load(std::memory_order_relaxed);
+            }
+            snap.m_totalNs[size_t(s)] += block->totalNs[s].load(std::memory_order_relaxed);
+            for (int f = 0; f < COUNTER_FIELDS; ++f) {
+                snap.m_perf[size_t(s) * COUNTER_FIELDS + f] +=
+                    block->perf[s][f].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return snap;
+}
+
+/**
+ * @brief Snapshot constructor: empty counts taken now.
+ */
+StageProfiler::Snapshot::Snapshot()
+    : m_counts(size_t(STAGE_COUNT) * BUCKETS, 0)
+    , m_totalNs(STAGE_COUNT, 0)
+    , m_perf(size_t(STAGE_COUNT) * COUNTER_FIELDS, 0)
+    , m_takenUs(steadyMicros())
+    , m_sinceUs(m_takenUs)
+{}
+
+/**
+ * @brief since subtracts an earlier snapshot.
+ */
+StageProfiler::Snapshot StageProfiler::Snapshot::since(const Snapshot &earlier) const
+{
+    Snapshot diff;
+    diff.m_takenUs = m_takenUs;
+    diff.m_sinceUs = earlier.m_takenUs;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        // A block is summed a moment apart from its neighbours, never backwards
+        diff.m_counts[i] = m_counts[i] - std::min(m_counts[i], earlier.m_counts[i]);
+    }
+    for (size_t i = 0; i < m_totalNs.size(); ++i) {
+        diff.m_totalNs[i] = m_totalNs[i] - std::min(m_totalNs[i], earlier.m_totalNs[i]);
+    }
+    for (size_t i = 0; i < m_perf.size(); ++i) {
+        diff.m_perf[i] = m_perf[i] - std::min(m_perf[i], earlier.m_perf[i]);
+    }
+    return diff;
+}
+
+/**
+ * @brief stats computes the count, mean, percentiles and rate of a stage.
+ * Percentiles report the middle of their bucket. Counter rates are over
+ * the samples that had counters.
+ */
+StageStats StageProfiler::Snapshot::stats(Stage stage) const
+{
+    StageStats st;
+    const quint64 *counts = &m_counts[size_t(stage) * BUCKETS];
+    for (int b = 0; b < BUCKETS; ++b) {
+        st.count += counts[b];
+    }
+    if (st.count == 0) {
+        return st;
+    }
+    st.meanUs = m_totalNs[size_t(stage)] / 1000.0 / st.count;
+    const double seconds = (m_takenUs - m_sinceUs) / 1e6;
+    st.fps = seconds > 0.0 ? st.count / seconds : 0.0;
+
+    const quint64 ranks[3] = {
+        (st.count * 50 + 99) / 100, (st.count * 95 + 99) / 100, (st.count * 99 + 99) / 100
+    };
+    double *out[3] = { &st.p50Us, &st.p95Us, &st.p99Us };
+    quint64 seen = 0;
+    int next = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        if (counts[b] == 0) {
+            continue;
+        }
+        seen += counts[b];
+        const quint64 upper = bucketUpperNs(b);
+        const quint64 lower = b > 0 ? bucketUpperNs(b - 1) + 1 : 0;
+        while (next < 3 && seen >= ranks[next]) {
+            *out[next++] = (lower + upper) / 2000.0;
+        }
+        st.maxUs = upper / 1000.0;
+    }
+
+    const quint64 *perf = &m_perf[size_t(stage) * COUNTER_FIELDS];
+    st.counted = perf[0];
+    const quint64 pixels = perf[1];
+    const quint64 *events = perf + 2;
+    const unsigned eventMask = PerfCounters::events();
+    if (st.counted > 0 && events[PerfCounters::Cycles] > 0) {
+        st.ipc = double(events[PerfCounters::Instructions]) / events[PerfCounters::Cycles];
+        if (pixels > 0) {
+            st.cyclesPerPx = double(events[PerfCounters::Cycles]) / pixels;
+            if (eventMask & (1u << PerfCounters::LlcMisses)) {
+                st.llcPerPx = double(events[PerfCounters::LlcMisses]) / pixels;
+            }
+            if (eventMask & (1u << PerfCounters::BranchMisses)) {
+                st.branchPerPx = double(events[PerfCounters::BranchMisses]) / pixels;
+            }
+        }
+    }
+    return st;
+}
+
+/**
+ * @brief report formats "stage n p50/p95/p99 ms fps" lines, plus IPC and
+ * misses per pixel where counted.
+ */
+QStringList StageProfiler::Snapshot::report() const
+{
+    QStringList lines;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        const StageStats st = stats(Stage(s));
+        if (st.count == 0) {
+            continue;
+        }
+        QString line = QString("%1 %2 p50 %3 p95 %4 p99 %5 ms, %6 fps")
+                           .arg(name(Stage(s)), -9).arg(st.count)
+                           .arg(st.p50Us / 1000.0, 0, 'f', 2).arg(st.p95Us / 1000.0, 0, 'f', 2)
+                           .arg(st.p99Us / 1000.0, 0, 'f', 2).arg(st.fps, 0, 'f', 1);
+        if (st.ipc >= 0.0) {
+            line += QString(", IPC %1").arg(st.ipc, 0, 'f', 2);
+        }
+        if (st.cyclesPerPx >= 0.0) {
+            line += QString(", %1 cycles/px").arg(st.cyclesPerPx, 0, 'f', 1);
+        }
+        if (st.llcPerPx >= 0.0) {
+            line += QString(", LLC %1/px").arg(st.llcPerPx, 0, 'f', 4);
+        }
+        if (st.branchPerPx >= 0.0) {
+            line += QString(", br %1/px").arg(st.branchPerPx, 0, 'f', 4);
+        }
+        lines << line;
+    }
+    return lines;
+}
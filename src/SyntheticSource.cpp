@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+// src/SyntheticSource.cpp
+//------------------------------------------------------------------------------
+
+#include "SyntheticSource.h"
+#include "LatencyProbe.h"
+#include "NDVIKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr float EXPOSURE = 320.0f;  // DN per unit reflectance at unit illumination
+static constexpr float SOIL_NIR = 0.28f;   // bare soil reflectance
+static constexpr float SOIL_VIS = 0.20f;
+
+/**
+ * @brief toJson serialises the scene parameters.
+ */
+QJsonObject SceneParams::toJson() const
+{
+    QJsonObject obj;
+    obj["width"] = width;
+    obj["height"] = height;
+    obj["frameRate"] = frameRate;
+    obj["patches"] = patches;
+    obj["gradient"] = gradient;
+    obj["noise"] = noise;
+    obj["saturation"] = saturation;
+    obj["motionX"] = motion.x;
+    obj["motionY"] = motion.y;
+    obj["poolSize"] = poolSize;
+    obj["seed"] = seed;
+    obj["stamp"] = stamp;
+    return obj;
+}
+
+/**
+ * @brief fromJson parses scene parameters, keeping defaults for missing keys.
+ */
+SceneParams SceneParams::fromJson(const QJsonObject &obj)
+{
+    SceneParams p;
+    p.width = obj["width"].toInt(p.width);
+    p.height = obj["height"].toInt(p.height);
+    p.frameRate = obj["frameRate"].toDouble(p.frameRate);
+    p.patches = obj["patches"].toInt(p.patches);
+    p.gradient = float(obj["gradient"].toDouble(p.gradient));
+    p.noise = float(obj["noise"].toDouble(p.noise));
+    p.saturation = float(obj["saturation"].toDouble(p.saturation));
+    p.motion.x = float(obj["motionX"].toDouble(p.motion.x));
+    p.motion.y = float(obj["motionY"].toDouble(p.motion.y));
+    p.poolSize = obj["poolSize"].toInt(p.poolSize);
+    p.seed = obj["seed"].toInt(p.seed);
+    p.stamp = obj["stamp"].toBool(p.stamp);
+    return p;
+}
+
+/**
+ * @brief SyntheticSource constructor.
+ */
+SyntheticSource::SyntheticSource(const SceneParams &params)
+    : m_params(params)
+    , m_scene()
+    , m_truth()
+    , m_truthMask()
+    , m_pool()
+    , m_next(0)
+{
+    m_params.width = std::max(m_params.width, 16);
+    m_params.height = std::max(m_params.height, 16);
+    m_params.poolSize = std::max(m_params.poolSize, 1);
+    m_params.frameRate = m_params.frameRate > 0.0 ? m_params.frameRate : 30.0;
+}
+
+/**
+ * @brief offset returns the top-left corner of pool frame slot in the scene.
+ */
+cv::Point SyntheticSource::offset(int slot) const
+{
+    const int last = m_params.poolSize - 1;
+    const cv::Point base(m_params.motion.x < 0 ? cvRound(-m_params.motion.x * last) : 0,
+                         m_params.motion.y < 0 ? cvRound(-m_params.motion.y * last) : 0);
+    return base + cv::Point(cvRound(m_params.motion.x * slot), cvRound(m_params.motion.y * slot));
+}
+
+/**
+ * @brief open renders the scene and its NDVI, then the frame pool.
+ */
+bool SyntheticSource::open()
+{
+    const SceneParams &p = m_params;
+    const int last = p.poolSize - 1;
+    const int width = p.width + cvRound(std::abs(p.motion.x) * last) + 1;
+    const int height = p.height + cvRound(std::abs(p.motion.y) * last) + 1;
+    cv::RNG rng(uint64(p.seed));
+
+    // Reflectance planes: soil, then vegetation patches of random vigour
+    cv::Mat nir(height, width, CV_32F, cv::Scalar(SOIL_NIR));
+    cv::Mat vis(height, width, CV_32F, cv::Scalar(SOIL_VIS));
+    const int minDim = std::min(width, height);
+    for (int i = 0; i < p.patches; ++i) {
+        const cv::Point centre(rng.uniform(0, width), rng.uniform(0, height));
+        const cv::Size axes(rng.uniform(minDim / 40 + 2, minDim / 8 + 3),
+                            rng.uniform(minDim / 40 + 2, minDim / 8 + 3));
+        const double angle = rng.uniform(0.0, 180.0);
+        const float vigour = rng.uniform(0.2f, 1.0f);
+        cv::ellipse(nir, centre, axes, angle, 0, 360, cv::Scalar(SOIL_NIR + 0.32f * vigour), cv::FILLED);
+        cv::ellipse(vis, centre, axes, angle, 0, 360, cv::Scalar(SOIL_VIS - 0.16f * vigour), cv::FILLED);
+    }
+    // Specular highlights, bright enough to clip in both bands
+    const double highlightArea = double(p.saturation) * width * height;
+    for (double area = 0.0; area < highlightArea;) {
+        const cv::Rect r(rng.uniform(0, width), rng.uniform(0, height),
+                         rng.uniform(2, minDim / 30 + 3), rng.uniform(2, minDim / 30 + 3));
+        const cv::Rect clipped = r & cv::Rect(0, 0, width, height);
+        nir(clipped).setTo(1.0f);
+        vis(clipped).setTo(1.0f);
+        area += clipped.area();
+    }
+
+    // Illuminate, quantise, and derive the expected NDVI from the 8-bit values
+    m_scene.create(height, width, CV_8UC3);
+    m_truth.create(height, width, CV_32F);
+    m_truthMask.create(height, width, CV_8U);
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            const float *n = nir.ptr<float>(y);
+            const float *v = vis.ptr<float>(y);
+            cv::Vec3b *bgr = m_scene.ptr<cv::Vec3b>(y);
+            float *t = m_truth.ptr<float>(y);
+            uchar *m = m_truthMask.ptr<uchar>(y);
+            for (int x = 0; x < width; ++x) {
+                const float light = EXPOSURE * (1.0f - 0.5f * p.gradient + p.gradient * x / width);
+                const int r = cv::saturate_cast<uchar>(n[x] * light);
+                const int b = cv::saturate_cast<uchar>(v[x] * light);
+                bgr[x] = cv::Vec3b(uchar(b), uchar((r + b) / 2), uchar(r));
+                t[x] = r + b > 0 ? float(r - b) / float(r + b) : 0.0f;
+                m[x] = r >= 255 || b >= 255 ? MASK_SATURATED : 0;
+            }
+        }
+    });
+
+    // Pool of shifted frames with independent sensor noise
+    m_pool.assign(size_t(p.poolSize), cv::Mat());
+    cv::parallel_for_(cv::Range(0, p.poolSize), [&](const cv::Range &slots) {
+        for (int s = slots.start; s < slots.end; ++s) {
+            const cv::Mat crop = m_scene(cv::Rect(offset(s), cv::Size(p.width, p.height)));
+            if (p.noise > 0.0f) {
+                cv::Mat noise(p.height, p.width, CV_16SC3);
+                cv::RNG(uint64(p.seed) * 7919u + uint64(s)).fill(noise, cv::RNG::NORMAL, 0.0, p.noise);
+                cv::add(crop, noise, m_pool[size_t(s)], cv::noArray(), CV_8UC3);
+            } else {
+                m_pool[size_t(s)] = crop.clone();
+            }
+        }
+    });
+    m_next = 0;
+    return true;
+}
+
+/**
+ * @brief read hands out the next pool frame.
+ */
+bool SyntheticSource::read(cv::Mat &frame, FrameMeta &meta)
+{
+    if (m_pool.empty()) {
+        return false;
+    }
+    frame = m_pool[size_t(m_next % m_params.poolSize)];
+    if (m_params.stamp) {
+        frame = frame.clone();
+        LatencyProbe::stamp(frame, quint32(steadyMicros()));
+    }
+    meta = FrameMeta();
+    meta.sequence = m_next;
+    meta.timestampUs = qint64(m_next * 1e6 / m_params.frameRate);
+    ++m_next;
+    return true;
+}
+
+/**
+ * @brief rewind restarts the sequence.
+ */
+bool SyntheticSource::rewind()
+{
+    m_next = 0;
+    return true;
+}
+
+/**
+ * @brief truth returns views of the expected NDVI and mask of a frame.
+ */
+void SyntheticSource::truth(qint64 sequence, cv::Mat &ndvi, cv::Mat &mask) const
+{
+    if (m_truth.empty()) {
+        ndvi.release();
+        mask.release();
+        return;
+    }
+    const cv::Rect r(offset(int(sequence % m_params.poolSize)),
+                     cv::Size(m_params.width, m_params.height));
+    ndvi = m_truth(r);
+    mask = m_truthMask(r);
+}
+
+/**
+ * @brief description names the scene size and rate.
+ */
+QString SyntheticSource::description() const
+{
+    return QString("synthetic %1x%2 @ %3 fps").arg(m_params.width).arg(m_params.height)
+                                              .arg(m_params.frameRate, 0, 'f', 1);
+}
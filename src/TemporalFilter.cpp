@@ -0,0 +1,386 @@
+//------------------------------------------------------------------------------
+// src/TemporalFilter.cpp
+//------------------------------------------------------------------------------
+
+#include "TemporalFilter.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static constexpr int BLOCK = 16;  // motion block edge in pixels
+
+/**
+ * @brief absDiffSum returns the sum of |x - scale * est| over n floats.
+ */
+static inline float absDiffSum(const float *x, const float *est, float scale, int n)
+{
+    int i = 0;
+    float total = 0.0f;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 vscale = cv::vx_setall_f32(scale);
+    cv::v_float32 vsum = cv::vx_setzero_f32();
+    for (; i <= n - lanes; i += lanes) {
+        cv::v_float32 d = cv::v_absdiff(cv::vx_load(x + i), cv::v_mul(cv::vx_load(est + i), vscale));
+        vsum = cv::v_add(vsum, d);
+    }
+    total = cv::v_reduce_sum(vsum);
+#endif
+    for (; i < n; ++i) {
+        total += std::abs(x[i] - scale * est[i]);
+    }
+    return total;
+}
+
+/**
+ * @brief emaUpdate blends x into acc in place and writes the estimate back to x.
+ */
+static inline void emaUpdate(float *x, float *acc, float alpha, int n)
+{
+    int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 valpha = cv::vx_setall_f32(alpha);
+    for (; i <= n - lanes; i += lanes) {
+        cv::v_float32 va = cv::vx_load(acc + i);
+        va = cv::v_fma(cv::v_sub(cv::vx_load(x + i), va), valpha, va);
+        cv::v_store(acc + i, va);
+        cv::v_store(x + i, va);
+    }
+#endif
+    for (; i < n; ++i) {
+        acc[i] += alpha * (x[i] - acc[i]);
+        x[i] = acc[i];
+    }
+}
+
+/**
+ * @brief boxUpdate swaps x into the oldest ring slot, updates the running
+ * sum and writes the box average back to x.
+ */
+static inline void boxUpdate(float *x, float *sum, float *oldest, float invN, int n)
+{
+    int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 vinv = cv::vx_setall_f32(invN);
+    for (; i <= n - lanes; i += lanes) {
+        cv::v_float32 vx = cv::vx_load(x + i);
+        cv::v_float32 vs = cv::v_add(cv::vx_load(sum + i), cv::v_sub(vx, cv::vx_load(oldest + i)));
+        cv::v_store(sum + i, vs);
+        cv::v_store(oldest + i, vx);
+        cv::v_store(x + i, cv::v_mul(vs, vinv));
+    }
+#endif
+    for (; i < n; ++i) {
+        sum[i] += x[i] - oldest[i];
+        oldest[i] = x[i];
+        x[i] = sum[i] * invN;
+    }
+}
+
+/**
+ * @brief TemporalFilter constructor, starts disabled.
+ */
+TemporalFilter::TemporalFilter()
+    : m_mode(Off)
+    , m_alpha(0.25f)
+    , m_window(8)
+    , m_motion(0.15f)
+    , m_acc()
+    , m_history()
+    , m_head(0)
+    , m_wraps(0)
+    , m_seen()
+{}
+
+/**
+ * @brief setMode selects the filter and resets its state.
+ */
+void TemporalFilter::setMode(Mode mode)
+{
+    if (mode != m_mode) {
+        m_mode = mode;
+        reset();
+    }
+}
+
+/**
+ * @brief setAlpha sets the EMA weight of the incoming frame.
+ */
+void TemporalFilter::setAlpha(float alpha)
+{
+    m_alpha = std::min(std::max(alpha, 0.01f), 1.0f);
+}
+
+/**
+ * @brief setWindow sets the box length in frames and resets the state.
+ */
+void TemporalFilter::setWindow(int frames)
+{
+    m_window = std::max(frames, 1);
+    reset();
+}
+
+/**
+ * @brief setMotionThreshold sets the block mean |ΔNDVI| that triggers a reset.
+ */
+void TemporalFilter::setMotionThreshold(float threshold)
+{
+    m_motion = threshold;
+}
+
+/**
+ * @brief reset drops the accumulated state.
+ */
+void TemporalFilter::reset()
+{
+    m_acc.release();
+    m_history.clear();
+    m_head = 0;
+    m_wraps = 0;
+    m_seen.release();
+}
+
+/**
+ * @brief initialise seeds the state from the first frame, so the filter
+ * starts at the incoming values instead of ramping up from zero. Masked
+ * pixels are seeded too but left unseen, so their first valid sample
+ * replaces the seed.
+ */
+void TemporalFilter::initialise(const cv::Mat &ndvi, const cv::Mat &mask)
+{
+    if (m_mode == EMA) {
+        ndvi.copyTo(m_acc);
+    } else {
+        m_history.assign(m_window, cv::Mat());
+        for (cv::Mat &h : m_history) {
+            ndvi.copyTo(h);
+        }
+        m_acc = ndvi * float(m_window);
+        m_head = 0;
+        m_wraps = 0;
+    }
+    if (mask.empty()) {
+        m_seen.create(ndvi.size(), CV_8U);
+        m_seen.setTo(255);
+    } else {
+        cv::compare(mask, 0, m_seen, cv::CMP_EQ);
+    }
+}
+
+/**
+ * @brief apply filters the NDVI plane in place.
+ */
+void TemporalFilter::apply(cv::Mat &ndvi, const cv::Mat &mask)
+{
+    if (m_mode == Off || ndvi.empty()) {
+        return;
+    }
+    CV_Assert(ndvi.type() == CV_32F);
+    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == ndvi.size()));
+
+    if (m_acc.empty() || m_acc.size() != ndvi.size()) {
+        initialise(ndvi, mask);
+        return;
+    }
+    if (m_mode == EMA) {
+        applyEMA(ndvi, mask);
+    } else {
+        applyBox(ndvi, mask);
+    }
+}
+
+/**
+ * @brief plainBlock returns true if every pixel of the block is valid and
+ * already seen, so the vector path applies.
+ */
+bool TemporalFilter::plainBlock(const cv::Mat &mask, int y0, int y1, int x0, int n) const
+{
+    for (int y = y0; y < y1; ++y) {
+        const uchar *seen = m_seen.ptr<uchar>(y) + x0;
+        const uchar *m = mask.empty() ? nullptr : mask.ptr<uchar>(y) + x0;
+        for (int i = 0; i < n; ++i) {
+            if (seen[i] == 0 || (m && m[i] != 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief applyEMA runs the block-wise motion check and EMA update.
+ */
+void TemporalFilter::applyEMA(cv::Mat &ndvi, const cv::Mat &mask)
+{
+    const int rows = ndvi.rows;
+    const int cols = ndvi.cols;
+    const int blockRows = (rows + BLOCK - 1) / BLOCK;
+
+    cv::parallel_for_(cv::Range(0, blockRows), [&](const cv::Range &range) {
+        for (int by = range.start; by < range.end; ++by) {
+            int y0 = by * BLOCK;
+            int y1 = std::min(y0 + BLOCK, rows);
+            for (int x0 = 0; x0 < cols; x0 += BLOCK) {
+                int n = std::min(BLOCK, cols - x0);
+                if (plainBlock(mask, y0, y1, x0, n)) {
+                    float diff = 0.0f;
+                    for (int y = y0; y < y1; ++y) {
+                        diff += absDiffSum(ndvi.ptr<float>(y) + x0, m_acc.ptr<float>(y) + x0, 1.0f, n);
+                    }
+                    bool moved = diff > m_motion * n * (y1 - y0);
+                    for (int y = y0; y < y1; ++y) {
+                        float *x = ndvi.ptr<float>(y) + x0;
+                        float *acc = m_acc.ptr<float>(y) + x0;
+                        if (moved) {
+                            std::memcpy(acc, x, n * sizeof(float));
+                        } else {
+                            emaUpdate(x, acc, m_alpha, n);
+                        }
+                    }
+                    continue;
+                }
+
+                // Mixed block: the motion test covers valid, seen pixels only
+                float diff = 0.0f;
+                int count = 0;
+                for (int y = y0; y < y1; ++y) {
+                    const float *x = ndvi.ptr<float>(y) + x0;
+                    const float *acc = m_acc.ptr<float>(y) + x0;
+                    const uchar *seen = m_seen.ptr<uchar>(y) + x0;
+                    const uchar *m = mask.empty() ? nullptr : mask.ptr<uchar>(y) + x0;
+                    for (int i = 0; i < n; ++i) {
+                        if (seen[i] && !(m && m[i])) {
+                            diff += std::abs(x[i] - acc[i]);
+                            ++count;
+                        }
+                    }
+                }
+                bool moved = diff > m_motion * count;
+                for (int y = y0; y < y1; ++y) {
+                    float *x = ndvi.ptr<float>(y) + x0;
+                    float *acc = m_acc.ptr<float>(y) + x0;
+                    uchar *seen = m_seen.ptr<uchar>(y) + x0;
+                    const uchar *m = mask.empty() ? nullptr : mask.ptr<uchar>(y) + x0;
+                    for (int i = 0; i < n; ++i) {
+                        if (m && m[i]) {
+                            continue;
+                        }
+                        if (!seen[i] || moved) {
+                            acc[i] = x[i];
+                            seen[i] = 255;
+                        } else {
+                            acc[i] += m_alpha * (x[i] - acc[i]);
+                            x[i] = acc[i];
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief applyBox runs the block-wise motion check and box update. A reset
+ * block refills every ring slot with the incoming values. A masked pixel
+ * keeps its ring slots and sum untouched, so the sum stays the total of
+ * the ring.
+ */
+void TemporalFilter::applyBox(cv::Mat &ndvi, const cv::Mat &mask)
+{
+    const int rows = ndvi.rows;
+    const int cols = ndvi.cols;
+    const int blockRows = (rows + BLOCK - 1) / BLOCK;
+    const float invN = 1.0f / m_window;
+    cv::Mat &oldest = m_history[m_head];
+
+    cv::parallel_for_(cv::Range(0, blockRows), [&](const cv::Range &range) {
+        for (int by = range.start; by < range.end; ++by) {
+            int y0 = by * BLOCK;
+            int y1 = std::min(y0 + BLOCK, rows);
+            for (int x0 = 0; x0 < cols; x0 += BLOCK) {
+                int n = std::min(BLOCK, cols - x0);
+                const bool plain = plainBlock(mask, y0, y1, x0, n);
+                float diff = 0.0f;
+                int count = 0;
+                if (plain) {
+                    for (int y = y0; y < y1; ++y) {
+                        diff += absDiffSum(ndvi.ptr<float>(y) + x0, m_acc.ptr<float>(y) + x0, invN, n);
+                    }
+                    count = n * (y1 - y0);
+                } else {
+                    for (int y = y0; y < y1; ++y) {
+                        const float *x = ndvi.ptr<float>(y) + x0;
+                        const float *sum = m_acc.ptr<float>(y) + x0;
+                        const uchar *seen = m_seen.ptr<uchar>(y) + x0;
+                        const uchar *m = mask.empty() ? nullptr : mask.ptr<uchar>(y) + x0;
+                        for (int i = 0; i < n; ++i) {
+                            if (seen[i] && !(m && m[i])) {
+                                diff += std::abs(x[i] - invN * sum[i]);
+                                ++count;
+                            }
+                        }
+                    }
+                }
+                bool moved = diff > m_motion * count;
+                for (int y = y0; y < y1; ++y) {
+                    float *x = ndvi.ptr<float>(y) + x0;
+                    float *sum = m_acc.ptr<float>(y) + x0;
+                    if (plain && moved) {
+                        for (cv::Mat &h : m_history) {
+                            std::memcpy(h.ptr<float>(y) + x0, x, n * sizeof(float));
+                        }
+                        for (int i = 0; i < n; ++i) {
+                            sum[i] = x[i] * m_window;
+                        }
+                        continue;
+                    }
+                    if (plain) {
+                        boxUpdate(x, sum, oldest.ptr<float>(y) + x0, invN, n);
+                        continue;
+                    }
+                    float *old = oldest.ptr<float>(y) + x0;
+                    uchar *seen = m_seen.ptr<uchar>(y) + x0;
+                    const uchar *m = mask.empty() ? nullptr : mask.ptr<uchar>(y) + x0;
+                    for (int i = 0; i < n; ++i) {
+                        if (m && m[i]) {
+                            continue;
+                        }
+                        if (!seen[i] || moved) {
+                            for (cv::Mat &h : m_history) {
+                                h.ptr<float>(y)[x0 + i] = x[i];
+                            }
+                            sum[i] = x[i] * m_window;
+                            seen[i] = 255;
+                        } else {
+                            sum[i] += x[i] - old[i];
+                            old[i] = x[i];
+                            x[i] = sum[i] * invN;
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    m_head = (m_head + 1) % m_window;
+    if (m_head == 0 && ++m_wraps >= RESUM_WRAPS) {
+        resum();
+    }
+}
+
+/**
+ * @brief resum rebuilds the box running sum from the ring, dropping the
+ * rounding error the incremental updates have accumulated.
+ */
+void TemporalFilter::resum()
+{
+    m_history[0].copyTo(m_acc);
+    for (int i = 1; i < m_window; ++i) {
+        m_acc += m_history[i];
+    }
+    m_wraps = 0;
+}
@@ -0,0 +1,255 @@
+//------------------------------------------------------------------------------
+// src/TiledBatchProcessor.cpp
+//------------------------------------------------------------------------------
+
+#include "TiledBatchProcessor.h"
+#include "EnviRaster.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief TileJob is one tile travelling from the reader to a worker.
+ */
+struct TileJob
+{
+    int      index;  // tile index in row-major order
+    cv::Rect rect;   // window in image pixels
+    cv::Mat  bgr;    // kernel-layout pixels
+};
+
+/**
+ * @brief histogram adds the valid NDVI of a tile to HIST_BINS bins over [-1, 1].
+ */
+void histogram(const cv::Mat &ndvi, const cv::Mat &mask, std::vector<qint64> &hist)
+{
+    const int bins = TiledBatchProcessor::HIST_BINS;
+    hist.assign(bins, 0);
+    for (int y = 0; y < ndvi.rows; ++y) {
+        const float *nd = ndvi.ptr<float>(y);
+        const uchar *mk = mask.ptr<uchar>(y);
+        for (int x = 0; x < ndvi.cols; ++x) {
+            if (mk[x] != 0) continue;
+            int b = int((nd[x] + 1.0f) * 0.5f * bins);
+            hist[std::min(std::max(b, 0), bins - 1)]++;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief TiledBatchProcessor constructor.
+ */
+TiledBatchProcessor::TiledBatchProcessor(const NDVIKernel &kernel, const cv::Mat &lut)
+    : m_kernel(kernel)
+    , m_lut(lut.clone())
+    , m_tileSize(1024)
+    , m_prefetch(4)
+    , m_workers(0)
+    , m_nirBand(0)
+    , m_visBand(1)
+    , m_shift(0)
+    , m_writeColour(true)
+    , m_writeNdvi(true)
+    , m_progress()
+    , m_cancel(false)
+    , m_error()
+    , m_totals()
+    , m_seconds(0.0)
+{}
+
+void TiledBatchProcessor::setTileSize(int size) { m_tileSize = std::max(size, 64); }
+void TiledBatchProcessor::setPrefetch(int tiles) { m_prefetch = std::max(tiles, 1); }
+void TiledBatchProcessor::setWorkers(int workers) { m_workers = std::max(workers, 0); }
+void TiledBatchProcessor::setShift(int shift) { m_shift = std::min(std::max(shift, 0), 8); }
+
+void TiledBatchProcessor::setOutputs(bool colour, bool ndvi)
+{
+    m_writeColour = colour;
+    m_writeNdvi = ndvi;
+}
+
+void TiledBatchProcessor::setBands(int nirBand, int visBand)
+{
+    m_nirBand = nirBand;
+    m_visBand = visBand;
+}
+
+void TiledBatchProcessor::setProgress(std::function<void(int, int)> progress)
+{
+    m_progress = std::move(progress);
+}
+
+/**
+ * @brief run streams the raster through the reader → queue → workers
+ * pipeline and writes the tiles and the index.
+ */
+bool TiledBatchProcessor::run(const QString &input, const QString &outDir)
+{
+    const int64 start = cv::getTickCount();
+    m_cancel = false;
+    m_error.clear();
+    m_totals = TileStats();
+    if (m_lut.total() != 256 || m_lut.type() != CV_8UC3) {
+        m_error = "palette must be a 256-entry CV_8UC3 table";
+        return false;
+    }
+
+    EnviRaster raster;
+    if (!raster.open(input)) {
+        m_error = raster.error();
+        return false;
+    }
+    if (!QDir().mkpath(outDir)) {
+        m_error = QString("cannot create %1").arg(outDir);
+        return false;
+    }
+    const QDir dir(outDir);
+    const int T = m_tileSize;
+    const int cols = (raster.width() + T - 1) / T;
+    const int rows = (raster.height() + T - 1) / T;
+    const int total = cols * rows;
+    const int workers = m_workers > 0 ? m_workers : std::max(1, QThread::idealThreadCount() / 2);
+
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+    std::deque<TileJob> queue;
+    bool readerDone = false;
+    std::atomic<bool> failed(false);
+    QString failure;
+    std::vector<TileStats> perTile(total);
+    std::atomic<int> done(0);
+
+    // Reader: keeps up to m_prefetch tiles queued ahead of the workers
+    std::thread reader([&]() {
+        for (int i = 0; i < total && !m_cancel && !failed; ++i) {
+            TileJob job;
+            job.index = i;
+            job.rect = cv::Rect((i % cols) * T, (i / cols) * T, T, T)
+                     & cv::Rect(0, 0, raster.width(), raster.height());
+            if (!raster.readTile(job.rect, m_nirBand, m_visBand, m_shift, job.bgr)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+                failure = raster.error();
+                break;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [&]() { return int(queue.size()) < m_prefetch || m_cancel; });
+            queue.push_back(std::move(job));
+            notEmpty.notify_one();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        readerDone = true;
+        notEmpty.notify_all();
+    });
+
+    // Workers: fused kernel, histogram and tile output
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&]() {
+            cv::Mat coloured, ndvi, mask;
+            for (;;) {
+                TileJob job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    notEmpty.wait(lock, [&]() { return !queue.empty() || readerDone; });
+                    if (queue.empty()) {
+                        return;
+                    }
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                    notFull.notify_one();
+                }
+                if (m_cancel || failed) {
+                    continue;  // drain
+                }
+                TileStats &stats = perTile[job.index];
+                m_kernel.apply(job.bgr, m_lut, coloured, ndvi, mask, &stats.ndvi);
+                histogram(ndvi, mask, stats.histogram);
+
+                const QString name = QString("r%1_c%2").arg(job.index / cols).arg(job.index % cols);
+                bool ok = (!m_writeNdvi
+                           || cv::imwrite(dir.filePath("ndvi_" + name + ".tiff").toStdString(), ndvi))
+                       && (!m_writeColour
+                           || cv::imwrite(dir.filePath("colour_" + name + ".png").toStdString(), coloured));
+                if (!ok) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failed = true;
+                    failure = QString("cannot write tile %1").arg(name);
+                    continue;
+                }
+                int n = ++done;
+                if (m_progress) {
+                    m_progress(n, total);
+                }
+            }
+        });
+    }
+
+    reader.join();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    // Deterministic reduction in tile order
+    m_totals.histogram.assign(HIST_BINS, 0);
+    for (const TileStats &t : perTile) {
+        m_totals.ndvi.sum += t.ndvi.sum;
+        m_totals.ndvi.valid += t.ndvi.valid;
+        m_totals.ndvi.total += t.ndvi.total;
+        for (int b = 0; b < int(t.histogram.size()); ++b) {
+            m_totals.histogram[b] += t.histogram[b];
+        }
+    }
+    m_seconds = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+    if (failed || m_cancel) {
+        m_error = failed ? failure : QString("cancelled");
+        return false;
+    }
+
+    // Index: layout, per-tile and total stats
+    QJsonArray tiles;
+    for (int i = 0; i < total; ++i) {
+        QJsonObject t;
+        t["row"] = i / cols;
+        t["col"] = i % cols;
+        t["valid"] = perTile[i].ndvi.valid;
+        t["mean"] = perTile[i].ndvi.mean();
+        tiles.append(t);
+    }
+    QJsonArray hist;
+    for (qint64 c : m_totals.histogram) {
+        hist.append(c);
+    }
+    QJsonObject index;
+    index["source"] = input;
+    index["width"] = raster.width();
+    index["height"] = raster.height();
+    index["tileSize"] = T;
+    index["tileRows"] = rows;
+    index["tileCols"] = cols;
+    index["mean"] = m_totals.ndvi.mean();
+    index["maskedFraction"] = m_totals.ndvi.maskedFraction();
+    index["histogram"] = hist;
+    index["tiles"] = tiles;
+    QFile file(dir.filePath("tiles.json"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_error = "cannot write tiles.json";
+        return false;
+    }
+    file.write(QJsonDocument(index).toJson());
+    return true;
+}
@@ -0,0 +1,277 @@
+//------------------------------------------------------------------------------
+// src/TraceRecorder.cpp
+//------------------------------------------------------------------------------
+
+#include "TraceRecorder.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief TraceEvent is one ring slot. Fields are relaxed atomics so that
+ * a dump may read a ring while its thread keeps writing.
+ */
+struct TraceEvent
+{
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> beginNs{0};
+    std::atomic<qint64> endNs{0};   // flow id for flow events
+    std::atomic<qint64> frame{-1};
+    std::atomic<int>    kind{0};
+};
+
+/**
+ * @brief TraceRing is the event ring of one thread; only that thread
+ * writes it. head counts every event ever written.
+ */
+struct TraceRing
+{
+    TraceEvent events[TraceRecorder::RING_EVENTS];
+    std::atomic<quint64> head{0};
+    quint64 floor = 0;              // first event of the current trace, dump side
+    const char *threadName = nullptr;
+    int tid = 0;
+};
+
+/**
+ * @brief Registry owns every ring. The ring of an exited thread is retired:
+ * its events stay until the next dump or trace start, then it goes to the
+ * free list for the next new thread, so thread churn does not grow memory.
+ */
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    std::vector<TraceRing *> retired;  // owner exited, events not yet dumped
+    std::vector<TraceRing *> free;
+    int nextTid = 0;
+    qint64 originNs = 0;
+
+    /**
+     * @brief recycle frees the retired rings; the caller holds the mutex
+     */
+    void recycle()
+    {
+        free.insert(free.end(), retired.begin(), retired.end());
+        retired.clear();
+    }
+};
+
+Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+/**
+ * @brief RingSlot binds a ring to the current thread for its lifetime.
+ */
+struct RingSlot
+{
+    TraceRing *ring = nullptr;
+
+    ~RingSlot()
+    {
+        if (ring) {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.retired.push_back(ring);
+        }
+    }
+};
+
+thread_local RingSlot t_slot;
+thread_local const char *t_threadName = nullptr;
+thread_local qint64 t_frame = -1;
+
+/**
+ * @brief ring returns the calling thread's ring, taken from the free list
+ * or created on first use. A reused ring starts past its old events.
+ */
+TraceRing *ring()
+{
+    if (!t_slot.ring) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        TraceRing *ring = nullptr;
+        if (!r.free.empty()) {
+            ring = r.free.back();
+            r.free.pop_back();
+            ring->floor = ring->head.load(std::memory_order_relaxed);
+        } else {
+            r.rings.push_back(std::make_unique<TraceRing>());
+            ring = r.rings.back().get();
+            ring->floor = 0;
+        }
+        ring->tid = ++r.nextTid;
+        ring->threadName = t_threadName;
+        t_slot.ring = ring;
+    }
+    return t_slot.ring;
+}
+
+} // namespace
+
+/**
+ * @brief setEnabled starts or stops recording. Starting moves every
+ * ring's floor to its head, so the dump holds this trace only, and frees
+ * the rings of threads that exited during the last one.
+ */
+void TraceRecorder::setEnabled(bool on)
+{
+    if (on) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const std::unique_ptr<TraceRing> &ring : r.rings) {
+            ring->floor = ring->head.load(std::memory_order_acquire);
+        }
+        r.recycle();
+        r.originNs = nowNs();
+    }
+    s_enabled.store(on, std::memory_order_relaxed);
+}
+
+/**
+ * @brief setThreadName names the calling thread.
+ */
+void TraceRecorder::setThreadName(const char *name)
+{
+    t_threadName = name;
+    if (t_slot.ring) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        t_slot.ring->threadName = name;
+    }
+}
+
+/**
+ * @brief setFrame sets the frame tag of the calling thread's events.
+ */
+void TraceRecorder::setFrame(qint64 frame)
+{
+    t_frame = frame;
+}
+
+/**
+ * @brief complete records a slice.
+ */
+void TraceRecorder::complete(const char *name, qint64 beginNs, qint64 endNs)
+{
+    if (isEnabled()) {
+        record(Complete, name, beginNs, endNs);
+    }
+}
+
+/**
+ * @brief flow records a flow start or end at the current time.
+ */
+void TraceRecorder::flow(Kind kind, const char *name, qint64 id)
+{
+    if (isEnabled()) {
+        record(kind, name, nowNs(), id);
+    }
+}
+
+/**
+ * @brief record appends to the ring; the head is published last.
+ */
+void TraceRecorder::record(Kind kind, const char *name, qint64 beginNs, qint64 endNs)
+{
+    TraceRing *r = ring();
+    const quint64 h = r->head.load(std::memory_order_relaxed);
+    TraceEvent &e = r->events[h & (RING_EVENTS - 1)];
+    e.name.store(name, std::memory_order_relaxed);
+    e.beginNs.store(beginNs, std::memory_order_relaxed);
+    e.endNs.store(endNs, std::memory_order_relaxed);
+    e.frame.store(t_frame, std::memory_order_relaxed);
+    e.kind.store(kind, std::memory_order_relaxed);
+    r->head.store(h + 1, std::memory_order_release);
+}
+
+/**
+ * @brief dump writes {"traceEvents": [...]} with microsecond timestamps
+ * relative to the start of the trace, and a thread_name record per ring.
+ * Slots the writer may have reused while they were copied are dropped.
+ * Rings of exited threads are freed once written.
+ */
+bool TraceRecorder::dump(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(3);
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"args\":{\"name\":\"" << QCoreApplication::applicationName() << "\"}}";
+
+    struct Copy { const char *name; qint64 begin, end, frame; int kind; };
+    std::vector<Copy> copies;
+    for (const std::unique_ptr<TraceRing> &ring : reg.rings) {
+        const quint64 head = ring->head.load(std::memory_order_acquire);
+        quint64 first = head > quint64(RING_EVENTS) ? head - RING_EVENTS : 0;
+        first = std::max(first, ring->floor);
+        copies.clear();
+        for (quint64 i = first; i < head; ++i) {
+            const TraceEvent &e = ring->events[i & (RING_EVENTS - 1)];
+            copies.push_back({e.name.load(std::memory_order_relaxed),
+                              e.beginNs.load(std::memory_order_relaxed),
+                              e.endNs.load(std::memory_order_relaxed),
+                              e.frame.load(std::memory_order_relaxed),
+                              e.kind.load(std::memory_order_relaxed)});
+        }
+        // The slot after head may be mid-write, so one more is unsafe
+        const quint64 after = ring->head.load(std::memory_order_acquire);
+        const quint64 safe = after + 1 > quint64(RING_EVENTS) ? after + 1 - RING_EVENTS : 0;
+        const size_t skip = size_t(std::min<quint64>(copies.size(), safe > first ? safe - first : 0));
+        if (skip == copies.size()) {
+            continue;
+        }
+
+        const int tid = ring->tid;
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+            << ",\"args\":{\"name\":\"" << (ring->threadName ? ring->threadName : "thread")
+            << "\"}}";
+        for (size_t i = skip; i < copies.size(); ++i) {
+            const Copy &c = copies[i];
+            if (!c.name) {
+                continue;
+            }
+            const double ts = (c.begin - reg.originNs) / 1000.0;
+            out << ",\n{\"name\":\"" << c.name << "\",\"pid\":" << pid << ",\"tid\":" << tid
+                << ",\"ts\":" << ts;
+            if (c.kind == Complete) {
+                out << ",\"ph\":\"X\",\"cat\":\"stage\",\"dur\":" << (c.end - c.begin) / 1000.0;
+            } else {
+                out << ",\"ph\":\"" << (c.kind == FlowStart ? "s" : "f")
+                    << "\",\"cat\":\"frame\",\"id\":" << c.end;
+                if (c.kind == FlowEnd) {
+                    out << ",\"bp\":\"e\"";
+                }
+            }
+            if (c.frame >= 0) {
+                out << ",\"args\":{\"frame\":" << c.frame << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+    if (file.error() != QFileDevice::NoError) {
+        return false;
+    }
+    reg.recycle();
+    return true;
+}
@@ -0,0 +1,87 @@
+//------------------------------------------------------------------------------
+// src/VideoIndex.cpp
+//------------------------------------------------------------------------------
+
+#include "VideoIndex.h"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+
+/**
+ * @brief build reads the packet stream and records the keyframe packets.
+ */
+bool VideoIndex::build(const QString &path)
+{
+    m_keyframes.clear();
+    m_frames = 0;
+    m_exact = false;
+    m_error.clear();
+
+    cv::VideoCapture cap(path.toStdString(), BACKEND);
+    if (!cap.isOpened()) {
+        m_error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    // CAP_PROP_FORMAT = -1 switches FFmpeg to raw packets: grab() demuxes only
+    if (cap.set(cv::CAP_PROP_FORMAT, -1)) {
+        m_exact = true;
+        while (cap.grab()) {
+            if (cap.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0.0) {
+                m_keyframes.push_back(m_frames);
+            }
+            ++m_frames;
+        }
+    } else {
+        m_frames = qint64(cap.get(cv::CAP_PROP_FRAME_COUNT));
+    }
+    if (m_frames <= 0) {
+        m_error = QString("no frames in %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief shards snaps evenly spaced cut points to the nearest keyframe.
+ * Without a packet count an open range stays open in the last shard.
+ */
+std::vector<VideoShard> VideoIndex::shards(int count, qint64 first, qint64 last) const
+{
+    std::vector<VideoShard> out;
+    const bool toEnd = last < 0 && !m_exact;
+    first = std::max<qint64>(first, 0);
+    last = last < 0 ? m_frames - 1 : std::min(last, m_frames - 1);
+    if (last < first) {
+        return out;
+    }
+    const qint64 length = last - first + 1;
+    count = int(std::max<qint64>(1, std::min<qint64>(count, length)));
+
+    // Cut points strictly inside (first, last]; each must start a GOP
+    std::vector<qint64> cuts;
+    for (int i = 1; i < count; ++i) {
+        qint64 ideal = first + length * i / count;
+        if (!m_keyframes.empty()) {
+            auto it = std::lower_bound(m_keyframes.begin(), m_keyframes.end(), ideal);
+            qint64 best = -1;
+            if (it != m_keyframes.end()) {
+                best = *it;
+            }
+            if (it != m_keyframes.begin() && (best < 0 || ideal - *(it - 1) < best - ideal)) {
+                best = *(it - 1);
+            }
+            ideal = best;
+        }
+        if (ideal > first && ideal <= last && (cuts.empty() || ideal > cuts.back())) {
+            cuts.push_back(ideal);
+        }
+    }
+
+    qint64 start = first;
+    for (qint64 cut : cuts) {
+        out.push_back({ start, cut - 1 });
+        start = cut;
+    }
+    out.push_back({ start, toEnd ? -1 : last });
+    return out;
+}
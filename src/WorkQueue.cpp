@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+// src/WorkQueue.cpp
+//------------------------------------------------------------------------------
+
+#include "WorkQueue.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLockFile>
+#include <QSysInfo>
+
+static const char *STATES[] = { "pending", "claimed", "done", "failed" };
+
+/**
+ * @brief toJson serialises the item.
+ */
+QJsonObject WorkItem::toJson() const
+{
+    QJsonObject obj;
+    obj["id"] = id;
+    obj["input"] = input;
+    obj["first"] = first;
+    obj["last"] = last;
+    obj["attempts"] = attempts;
+    obj["worker"] = worker;
+    return obj;
+}
+
+/**
+ * @brief fromJson parses an item.
+ */
+WorkItem WorkItem::fromJson(const QJsonObject &obj)
+{
+    WorkItem item;
+    item.id = obj["id"].toString();
+    item.input = obj["input"].toString();
+    item.first = qint64(obj["first"].toDouble());
+    item.last = qint64(obj["last"].toDouble(-1));
+    item.attempts = obj["attempts"].toInt();
+    item.worker = obj["worker"].toString();
+    return item;
+}
+
+/**
+ * @brief WorkQueue constructor.
+ */
+WorkQueue::WorkQueue(const QString &dir)
+    : m_dir(dir)
+{}
+
+QString WorkQueue::path(const QString &state, const QString &id) const
+{
+    return m_dir.filePath(state + "/" + id + ".json");
+}
+
+bool WorkQueue::writeJson(const QString &path, const QJsonObject &obj)
+{
+    // Write aside and rename, so readers never see a partial file
+    QFile file(path + ".tmp");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    file.close();
+    QFile::remove(path);
+    return QFile::rename(path + ".tmp", path);
+}
+
+QJsonObject WorkQueue::readJson(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+/**
+ * @brief workerId returns "host:pid".
+ */
+QString WorkQueue::workerId()
+{
+    return QString("%1:%2").arg(QSysInfo::machineHostName()).arg(QCoreApplication::applicationPid());
+}
+
+/**
+ * @brief create empties the queue and enqueues the items.
+ */
+bool WorkQueue::create(const QList<WorkItem> &items, const QJsonObject &job)
+{
+    QLockFile lock(m_dir.filePath(".lock"));
+    if (!m_dir.mkpath(".") || !lock.lock()) {
+        return false;
+    }
+    for (const char *state : STATES) {
+        QDir sub(m_dir.filePath(state));
+        sub.removeRecursively();
+        if (!m_dir.mkpath(state)) {
+            return false;
+        }
+    }
+    if (!writeJson(m_dir.filePath("job.json"), job)) {
+        return false;
+    }
+    for (const WorkItem &item : items) {
+        if (!writeJson(path("pending", item.id), item.toJson())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief job returns the job options.
+ */
+QJsonObject WorkQueue::job() const
+{
+    return readJson(m_dir.filePath("job.json"));
+}
+
+/**
+ * @brief claim moves the first pending item to claimed/.
+ */
+bool WorkQueue::claim(const QString &worker, WorkItem &item)
+{
+    QLockFile lock(m_dir.filePath(".lock"));
+    if (!lock.lock()) {
+        return false;
+    }
+    const QStringList pending = ids("pending");
+    if (pending.isEmpty()) {
+        return false;
+    }
+    item = WorkItem::fromJson(readJson(path("pending", pending.first())));
+    item.attempts++;
+    item.worker = worker;
+    if (!writeJson(path("claimed", item.id), item.toJson())) {
+        return false;
+    }
+    QFile::remove(path("pending", item.id));
+    return true;
+}
+
+/**
+ * @brief heartbeat refreshes the claim's modification time.
+ */
+void WorkQueue::heartbeat(const WorkItem &item)
+{
+    QFile file(path("claimed", item.id));
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+}
+
+/**
+ * @brief complete moves the claim to done/, back to pending/ or to failed/.
+ */
+void WorkQueue::complete(const WorkItem &item, bool ok, const QJsonObject &result, int maxAttempts)
+{
+    QLockFile lock(m_dir.filePath(".lock"));
+    if (!lock.lock()) {
+        return;
+    }
+    // A claim requeued behind our back belongs to someone else now
+    WorkItem current = WorkItem::fromJson(readJson(path("claimed", item.id)));
+    if (current.worker != item.worker) {
+        return;
+    }
+    QJsonObject obj = item.toJson();
+    obj["result"] = result;
+    const QString state = ok ? "done" : item.attempts >= maxAttempts ? "failed" : "pending";
+    writeJson(path(state, item.id), obj);
+    QFile::remove(path("claimed", item.id));
+}
+
+/**
+ * @brief requeue releases stale claims and the claims of a dead worker.
+ */
+int WorkQueue::requeue(qint64 staleMs, const QString &deadWorker, int maxAttempts)
+{
+    QLockFile lock(m_dir.filePath(".lock"));
+    if (!lock.lock()) {
+        return 0;
+    }
+    const QDateTime now = QDateTime::currentDateTime();
+    int released = 0;
+    for (const QString &id : ids("claimed")) {
+        const QString claimed = path("claimed", id);
+        WorkItem item = WorkItem::fromJson(readJson(claimed));
+        const bool dead = !deadWorker.isEmpty() && item.worker == deadWorker;
+        const bool stale = QFileInfo(claimed).lastModified().msecsTo(now) > staleMs;
+        if (!dead && !stale) {
+            continue;
+        }
+        QJsonObject obj = item.toJson();
+        obj["error"] = dead ? "worker exited" : "heartbeat lost";
+        writeJson(path(item.attempts >= maxAttempts ? "failed" : "pending", id), obj);
+        QFile::remove(claimed);
+        ++released;
+    }
+    return released;
+}
+
+/**
+ * @brief count returns the number of items in a state directory.
+ */
+int WorkQueue::count(const QString &state) const
+{
+    return ids(state).size();
+}
+
+/**
+ * @brief ids returns the sorted item ids in a state directory.
+ */
+QStringList WorkQueue::ids(const QString &state) const
+{
+    QStringList names = QDir(m_dir.filePath(state)).entryList({"*.json"}, QDir::Files, QDir::Name);
+    for (QString &n : names) {
+        n.chop(5);
+    }
+    return names;
+}
+
+/**
+ * @brief result returns the stored summary of a done item.
+ */
+QJsonObject WorkQueue::result(const QString &id) const
+{
+    return readJson(path("done", id))["result"].toObject();
+}
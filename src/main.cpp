@@ -3,23 +3,188 @@
 //------------------------------------------------------------------------------
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
 #include <QMetaType>
 #include <QByteArray>
+#include <QTextStream>
 #include "NDVIApp.h"
+#include "BatchRunner.h"
+#include "BatchCoordinator.h"
+#include "Palette.h"
+#include "PerfCounters.h"
+#include "StageProfiler.h"
 
 /**
- * @brief main entry point: create QApplication, show main window.
+ * @brief isHeadless returns true if --batch is on the command line.
+ */
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--batch") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief runBatch parses the command line and runs the headless engine.
+ * @return process exit code
+ */
+static int runBatch(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("RazielNDVIpp");
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Headless NDVI over a video file, an image directory or an ENVI raster.");
+    parser.addHelpOption();
+    const BatchOptions defaults;
+    QCommandLineOption batchOpt("batch", "Run without a GUI.");
+    QCommandLineOption inputOpt({"i", "input"}, "Video file, image directory or ENVI .hdr.", "path");
+    QCommandLineOption outputOpt({"o", "output"}, "Output directory.", "dir");
+    QCommandLineOption paletteOpt("palette", QString("Palette: %1.").arg(paletteNames().join(", ")),
+                                  "name", defaults.palette);
+    QCommandLineOption minOpt("min", "NDVI at palette index 0.", "value", QString::number(defaults.vmin));
+    QCommandLineOption maxOpt("max", "NDVI at palette index 255.", "value", QString::number(defaults.vmax));
+    QCommandLineOption gainRedOpt("gain-red", "NIR (R channel) gain.", "gain", "1");
+    QCommandLineOption gainBlueOpt("gain-blue", "Visible (B channel) gain.", "gain", "1");
+    QCommandLineOption satOpt("sat", "Saturation level.", "level", QString::number(defaults.satLevel));
+    QCommandLineOption minSignalOpt("min-signal", "Minimum R+B.", "level", QString::number(defaults.minSignal));
+    QCommandLineOption ndviOpt("ndvi", "Write float NDVI .tiff per frame.");
+    QCommandLineOption noColourOpt("no-colour", "Do not write coloured output.");
+    QCommandLineOption smoothOpt("smooth", "Edge-preserving NDVI smoothing.");
+    QCommandLineOption decodersOpt("decoders", "Decoder threads (0 = auto).", "n", "0");
+    QCommandLineOption workersOpt("workers", "Processing threads (0 = auto).", "n", "0");
+    QCommandLineOption shardsOpt("shards", "Decode a video as N GOP-aligned shards in parallel (0 = auto).",
+                                 "n", QString::number(defaults.shards));
+    QCommandLineOption manifestOpt("manifest", "Distribute the inputs listed in a manifest.", "file");
+    QCommandLineOption processesOpt("processes", "Local worker processes for --manifest (0 = remote only).",
+                                    "n", "2");
+    QCommandLineOption queueOpt("queue", "Work queue directory (default <output>/queue).", "dir");
+    QCommandLineOption workerOpt("worker", "Process items from --queue until it is empty.");
+    QCommandLineOption attemptsOpt("attempts", "Tries per manifest item.", "n", "3");
+    QCommandLineOption profileOpt("profile", "Print per-stage latency percentiles at the end.");
+    QCommandLineOption traceOpt("trace", "Write a Chrome trace-event timeline of the run.", "file");
+    QCommandLineOption perfOpt("perf", "Add hardware counters (IPC, misses per pixel) to --profile.");
+    parser.addOptions({batchOpt, inputOpt, outputOpt, paletteOpt, minOpt, maxOpt,
+                       gainRedOpt, gainBlueOpt, satOpt, minSignalOpt, ndviOpt,
+                       noColourOpt, smoothOpt, decodersOpt, workersOpt, shardsOpt,
+                       manifestOpt, processesOpt, queueOpt, workerOpt, attemptsOpt, profileOpt,
+                       traceOpt, perfOpt});
+    parser.process(app);
+
+    if (parser.isSet(workerOpt)) {
+        if (!parser.isSet(queueOpt)) {
+            err << "--worker requires --queue\n";
+            return 2;
+        }
+        return BatchCoordinator::runWorker(parser.value(queueOpt));
+    }
+    const bool distributed = parser.isSet(manifestOpt);
+    if ((!distributed && !parser.isSet(inputOpt)) || !parser.isSet(outputOpt)) {
+        err << "--output and one of --input or --manifest are required\n";
+        return 2;
+    }
+    BatchOptions options;
+    options.input = parser.value(inputOpt);
+    options.outDir = parser.value(outputOpt);
+    options.palette = parser.value(paletteOpt);
+    options.vmin = parser.value(minOpt).toFloat();
+    options.vmax = parser.value(maxOpt).toFloat();
+    options.gains.red = parser.value(gainRedOpt).toFloat();
+    options.gains.blue = parser.value(gainBlueOpt).toFloat();
+    options.satLevel = parser.value(satOpt).toInt();
+    options.minSignal = parser.value(minSignalOpt).toInt();
+    options.writeNdvi = parser.isSet(ndviOpt);
+    options.writeColour = !parser.isSet(noColourOpt);
+    options.smooth = parser.isSet(smoothOpt);
+    options.decoders = parser.value(decodersOpt).toInt();
+    options.workers = parser.value(workersOpt).toInt();
+    options.shards = parser.value(shardsOpt).toInt();
+
+    if (distributed) {
+        const QString queueDir = parser.isSet(queueOpt)
+            ? parser.value(queueOpt) : QDir(options.outDir).filePath("queue");
+        BatchCoordinator coordinator(options, queueDir, parser.value(processesOpt).toInt());
+        coordinator.setMaxAttempts(qMax(1, parser.value(attemptsOpt).toInt()));
+        if (!coordinator.start(parser.value(manifestOpt))) {
+            err << "Coordinator failed: " << coordinator.error() << "\n";
+            return 1;
+        }
+        QObject::connect(&coordinator, &BatchCoordinator::finished, &app, [&](bool ok) {
+            if (!ok) {
+                err << "Distributed batch failed: " << coordinator.error() << "\n";
+            }
+            app.exit(ok ? 0 : 1);
+        });
+        return app.exec();
+    }
+
+    if (parser.isSet(traceOpt)) {
+        if (!TraceRecorder::available()) {
+            err << "--trace needs a build with RAZIEL_TRACING=ON\n";
+            return 2;
+        }
+        TraceRecorder::setEnabled(true);
+    }
+    if (parser.isSet(perfOpt) && !PerfCounters::setEnabled(true)) {
+        err << "Hardware counters unavailable: " << PerfCounters::unavailableReason() << "\n";
+    }
+    BatchRunner runner(options);
+    runner.setProgress([&out](qint64 frames) {
+        if (frames % 100 == 0) {
+            out << frames << " frames\n";
+            out.flush();
+        }
+    });
+    const bool ok = runner.run();
+    const BatchReport &r = runner.report();
+    out << QString("%1 frames (%2 failed) in %3 s: %4 frames/s, %5 Mpx/s\n")
+               .arg(r.frames).arg(r.failed).arg(r.seconds, 0, 'f', 2)
+               .arg(r.fps(), 0, 'f', 1).arg(r.pixelsPerSecond() / 1e6, 0, 'f', 1);
+    if (parser.isSet(traceOpt)) {
+        TraceRecorder::setEnabled(false);
+        if (!TraceRecorder::dump(parser.value(traceOpt))) {
+            err << "Cannot write " << parser.value(traceOpt) << "\n";
+        }
+    }
+    if (parser.isSet(profileOpt) || parser.isSet(perfOpt)) {
+        for (const QString &line : StageProfiler::snapshot().report()) {
+            out << line << "\n";
+        }
+    }
+    if (!ok) {
+        err << "Batch failed: " << runner.error() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief main entry point: run headless with --batch, otherwise create
+ * QApplication and show the main window.
  */
 int main(int argc, char *argv[])
 {
+    if (isHeadless(argc, argv)) {
+        return runBatch(argc, argv);
+    }
+
     // Disable OpenCV AVFoundation auth helper
     qputenv("OPENCV_AVFOUNDATION_SKIP_AUTH", QByteArray("1"));
 
     // Register cv::Mat for signal/slot queuing
     qRegisterMetaType<cv::Mat>("cv::Mat");
+    qRegisterMetaType<FrameMeta>("FrameMeta");
     
     QApplication app(argc, argv);
     NDVIApp window;
     window.show();
     return app.exec();
-}
\ No newline at end of file
+}